@@ -40,6 +40,14 @@ BufferPoolManagerInstance::BufferPoolManagerInstance(size_t pool_size, uint32_t
   for (size_t i = 0; i < pool_size_; ++i) {
     free_list_.emplace_back(static_cast<int>(i));
   }
+
+  // Pages that already exist in the database file must not be handed out again.
+  if(disk_manager_ != nullptr){
+    auto num_pages = static_cast<page_id_t>(disk_manager_->GetNumPages());
+    while(next_page_id_ < num_pages){
+      next_page_id_ += num_instances_;
+    }
+  }
 }
 
 BufferPoolManagerInstance::~BufferPoolManagerInstance() {
@@ -53,11 +61,11 @@ bool BufferPoolManagerInstance::FlushPgImp(page_id_t page_id) {
   // Make sure you call DiskManager::WritePage!
   latch_.lock();
   ValidatePageId(page_id);
-  if(page_table_.find(page_id) != page_table_.end()){
+  while(page_table_.find(page_id) != page_table_.end()){
     frame_id_t index = page_table_[page_id];
-    if(pages_[index].is_dirty_){
-      disk_manager_->WritePage(page_id,pages_[index].GetData());
-      pages_[index].is_dirty_ = false;
+    if(pages_[index].is_dirty_ && !WriteBackPage(&pages_[index])){
+      //the latch was released to wait for the log, look the page up again
+      continue;
     }
     latch_.unlock();
     return true;
@@ -69,9 +77,25 @@ bool BufferPoolManagerInstance::FlushPgImp(page_id_t page_id) {
 
 void BufferPoolManagerInstance::FlushAllPgsImp() {
   // You can do it!
+  latch_.lock();
   for(size_t i = 0; i < pool_size_; i++){
-    FlushPgImp(page_table_[i]);
+    //a page whose log had to be flushed first is looked at again
+    while(pages_[i].page_id_ != INVALID_PAGE_ID && pages_[i].is_dirty_ && !WriteBackPage(&pages_[i])){
+    }
   }
+  latch_.unlock();
+}
+
+std::vector<std::pair<page_id_t, lsn_t>> BufferPoolManagerInstance::GetDirtyPageTable() {
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_pages;
+  latch_.lock();
+  for(size_t i = 0; i < pool_size_; i++){
+    if(pages_[i].page_id_ != INVALID_PAGE_ID && (pages_[i].is_dirty_ || pages_[i].pin_count_ > 0)){
+      dirty_pages.emplace_back(pages_[i].page_id_, pages_[i].rec_lsn_);
+    }
+  }
+  latch_.unlock();
+  return dirty_pages;
 }
 
 Page *BufferPoolManagerInstance::NewPgImp(page_id_t *page_id) {
@@ -84,21 +108,11 @@ Page *BufferPoolManagerInstance::NewPgImp(page_id_t *page_id) {
   
   // 2.   Pick a victim page P from either the free list or the replacer. Always pick from the free list first.
   
-  if(!free_list_.empty()){
-    index = free_list_.front();
-    free_list_.pop_front();
-  }else{
-    bool has_replacer = replacer_->Victim(&index);
-    if(!has_replacer){
-      latch_.unlock();
-      return nullptr;
-    }
+  if(!FindCleanVictim(&index)){
+    latch_.unlock();
+    return nullptr;
   }
   *page_id = AllocatePage();
-  if(pages_[index].is_dirty_){
-    disk_manager_->WritePage(pages_[index].page_id_,pages_[index].GetData());
-    pages_[index].is_dirty_ = false;
-  }
     
   page_table_.erase(pages_[index].page_id_);
   
@@ -108,6 +122,7 @@ Page *BufferPoolManagerInstance::NewPgImp(page_id_t *page_id) {
   pages_[index].pin_count_ = 1;
   pages_[index].is_dirty_ = false;
   pages_[index].ResetMemory();
+  ResetRecLSN(&pages_[index]);
   std::pair<page_id_t, frame_id_t> value(*page_id, index);
   page_table_.insert(value);
   // 4.   Set the page ID output parameter. Return a pointer to P.
@@ -131,22 +146,11 @@ Page *BufferPoolManagerInstance::FetchPgImp(page_id_t page_id) {
     // 1.2    If P does not exist, find a replacement page (R) from either the free list or the replacer.
     //        Note that pages are always found from the free list first.
     
-    if(!free_list_.empty()){
-      index = free_list_.front();
-      free_list_.pop_front();
-    }else{
-      bool has_replacer =replacer_->Victim(&index);
-      if(free_list_.empty() && !has_replacer){
-        //no replacer
-        latch_.unlock();
-        return nullptr;
-      }
-    }
-    
     // 2.     If R is dirty, write it back to the disk.
-    if(pages_[index].is_dirty_){
-      disk_manager_->WritePage(pages_[index].page_id_,pages_[index].GetData());
-      pages_[index].is_dirty_ = false;
+    if(!FindCleanVictim(&index)){
+      //no replacer
+      latch_.unlock();
+      return nullptr;
     }
     // 3.     Delete R from the page table and insert P.
     page_table_.erase(pages_[index].page_id_);
@@ -156,10 +160,14 @@ Page *BufferPoolManagerInstance::FetchPgImp(page_id_t page_id) {
     pages_[index].ResetMemory();
     disk_manager_->ReadPage(page_id, pages_[index].GetData());
     pages_[index].page_id_ = page_id;
+    // A page beyond the database file (e.g. one recreated by redo) is in use as well.
+    if(page_id >= next_page_id_){
+      next_page_id_ = page_id + num_instances_;
+    }
     replacer_->Pin(index);
     pages_[index].pin_count_ = 1;
     pages_[index].is_dirty_ = false;
-    
+    ResetRecLSN(&pages_[index]);
     
     latch_.unlock();
     return &pages_[index];
@@ -172,33 +180,31 @@ bool BufferPoolManagerInstance::DeletePgImp(page_id_t page_id) {
   DeallocatePage(page_id);
   // 0.   Make sure you call DeallocatePage!
   // 1.   Search the page table for the requested page (P).
-  if(page_table_.find(page_id) == page_table_.end()){
-    // 1.   If P does not exist, return true.
-    latch_.unlock();
-    return true;
-  }else{
+  while(page_table_.find(page_id) != page_table_.end()){
     // 2.   If P exists, but has a non-zero pin-count, return false. Someone is using the page.
     frame_id_t index = page_table_[page_id];
     if(pages_[index].pin_count_ != 0){
       latch_.unlock();
       return false;
-    }else{
-      // 3.   Otherwise, P can be deleted. Remove P from the page table, reset its metadata and return it to the free list.
-      if(pages_[index].is_dirty_){
-        disk_manager_->WritePage(pages_[index].page_id_,pages_[index].GetData());
-      }
-      page_table_.erase(pages_[index].page_id_);
-      pages_[index].page_id_ = INVALID_PAGE_ID;
-      pages_[index].pin_count_ = 0;
-      pages_[index].is_dirty_ = false;
-      pages_[index].ResetMemory();
-      free_list_.push_back(index);
-      
-      latch_.unlock();
-      return true;
     }
+    // 3.   Otherwise, P can be deleted. Remove P from the page table, reset its metadata and return it to the free list.
+    if(pages_[index].is_dirty_ && !WriteBackPage(&pages_[index])){
+      //the latch was released to wait for the log, look the page up again
+      continue;
+    }
+    page_table_.erase(pages_[index].page_id_);
+    pages_[index].page_id_ = INVALID_PAGE_ID;
+    pages_[index].pin_count_ = 0;
+    pages_[index].is_dirty_ = false;
+    pages_[index].ResetMemory();
+    free_list_.push_back(index);
+    
+    latch_.unlock();
+    return true;
   }
-  
+  // 1.   If P does not exist, return true.
+  latch_.unlock();
+  return true;
 }
 
 bool BufferPoolManagerInstance::UnpinPgImp(page_id_t page_id, bool is_dirty) {
@@ -226,6 +232,76 @@ bool BufferPoolManagerInstance::UnpinPgImp(page_id_t page_id, bool is_dirty) {
   }
 }
 
+bool BufferPoolManagerInstance::FindVictim(frame_id_t *frame_id) {
+  if (!free_list_.empty()) {
+    *frame_id = free_list_.front();
+    free_list_.pop_front();
+    return true;
+  }
+  if (!enable_logging || log_manager_ == nullptr) {
+    return replacer_->Victim(frame_id);
+  }
+
+  lsn_t persistent_lsn = log_manager_->GetPersistentLSN();
+  auto durable = [&](frame_id_t frame) {
+    return !pages_[frame].is_dirty_ ||
+           (pages_[frame].GetLSN() <= persistent_lsn && pages_[frame].log_owner_ == INVALID_TXN_ID);
+  };
+  bool passed_over = false;
+  bool found = replacer_->VictimWithPreference(frame_id, [&](frame_id_t frame) {
+    bool is_durable = durable(frame);
+    passed_over |= !is_durable;
+    return is_durable;
+  });
+  if (!found) {
+    return false;
+  }
+  if (!durable(*frame_id)) {
+    num_log_forces_++;
+  } else if (passed_over) {
+    num_log_forces_avoided_++;
+  }
+  if (passed_over) {
+    log_manager_->RequestFlush();
+  }
+  return true;
+}
+
+bool BufferPoolManagerInstance::FindCleanVictim(frame_id_t *frame_id) {
+  while (FindVictim(frame_id)) {
+    if (!pages_[*frame_id].is_dirty_ || WriteBackPage(&pages_[*frame_id])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool BufferPoolManagerInstance::WriteBackPage(Page *page) {
+  // WAL: the log records describing the page's changes must be on disk before the page itself. Records that a
+  // transaction has only staged so far are appended first.
+  if (enable_logging && log_manager_ != nullptr &&
+      (page->log_owner_ != INVALID_TXN_ID || page->GetLSN() > log_manager_->GetPersistentLSN())) {
+    // An unpinned page, e.g. a victim, stays in the replacer while latch_ is released, like any other unpinned page.
+    if (page->pin_count_ == 0) {
+      replacer_->Unpin(static_cast<frame_id_t>(page - pages_));
+    }
+    latch_.unlock();
+    log_manager_->AppendStagedLog(page);
+    log_manager_->WaitForPersistentLSN(page->GetLSN());
+    latch_.lock();
+    return false;
+  }
+  disk_manager_->WritePage(page->GetPageId(), page->GetData());
+  page->is_dirty_ = false;
+  ResetRecLSN(page);
+  return true;
+}
+
+void BufferPoolManagerInstance::ResetRecLSN(Page *page) {
+  // Any change made from now on gets a log record with at least the next LSN.
+  page->rec_lsn_ = log_manager_ != nullptr ? log_manager_->GetNextLSN() : INVALID_LSN;
+}
+
 page_id_t BufferPoolManagerInstance::AllocatePage() {
   const page_id_t next_page_id = next_page_id_;
   next_page_id_ += num_instances_;
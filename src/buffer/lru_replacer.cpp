@@ -12,6 +12,7 @@
 
 #include "buffer/lru_replacer.h"
 #include <iostream>
+#include <iterator>
 
 namespace bustub {
 
@@ -38,6 +39,27 @@ bool LRUReplacer::Victim(frame_id_t *frame_id) {
   }
 }
 
+bool LRUReplacer::VictimWithPreference(frame_id_t *frame_id, const std::function<bool(frame_id_t)> &prefer) {
+  locker.lock();
+  if(dll.empty()){
+    locker.unlock();
+    return false;
+  }
+  //walk from the least recently used end, fall back to it if no frame is preferred
+  auto victim = std::prev(dll.end());
+  for(auto it = dll.rbegin(); it != dll.rend(); ++it){
+    if(prefer(*it)){
+      victim = std::prev(it.base());
+      break;
+    }
+  }
+  *frame_id = *victim;
+  dll.erase(victim);
+  hashmap.erase(*frame_id);
+  locker.unlock();
+  return true;
+}
+
 void LRUReplacer::Pin(frame_id_t frame_id) {
   locker.lock();
   if(hashmap.find(frame_id) != hashmap.end()){
@@ -38,6 +38,15 @@ size_t ParallelBufferPoolManager::GetPoolSize() {
   return num_of_bpm*parallel_buffer_pool_manager[0]->GetPoolSize();
 }
 
+std::vector<std::pair<page_id_t, lsn_t>> ParallelBufferPoolManager::GetDirtyPageTable() {
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_pages;
+  for(size_t i = 0; i < num_of_bpm; i++){
+    auto instance_dirty_pages = parallel_buffer_pool_manager[i]->GetDirtyPageTable();
+    dirty_pages.insert(dirty_pages.end(), instance_dirty_pages.begin(), instance_dirty_pages.end());
+  }
+  return dirty_pages;
+}
+
 BufferPoolManager *ParallelBufferPoolManager::GetBufferPoolManager(page_id_t page_id) {
   // Get BufferPoolManager responsible for handling given page id. You can use this method in your other methods.
   size_t index = page_id % num_of_bpm;
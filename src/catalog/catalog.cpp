@@ -0,0 +1,407 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// catalog.cpp
+//
+// Identification: src/catalog/catalog.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "catalog/catalog.h"
+
+#include <algorithm>
+#include <mutex>  // NOLINT
+#include <sstream>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "common/exception.h"
+#include "concurrency/transaction_manager.h"
+#include "storage/index/generic_key.h"
+#include "storage/page/table_page.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+namespace {
+
+/** Columns of the catalog table */
+enum CatalogColumn : uint32_t { KIND, OID, NAME, TABLE_NAME, PAGE_ID, KEY_SIZE, KEY_TYPE_SIZE, DEFINITION, INDEX_TYPE };
+
+/** A table's columns, one "type length name" line per column. */
+std::string SerializeColumns(const Schema &schema) {
+  std::ostringstream os;
+  for (const auto &column : schema.GetColumns()) {
+    os << static_cast<int>(column.GetType()) << ' ' << column.GetLength() << ' ' << column.GetName() << '\n';
+  }
+  return os.str();
+}
+
+Schema DeserializeColumns(const std::string &definition) {
+  std::vector<Column> columns;
+  std::istringstream is(definition);
+  int type;
+  uint32_t length;
+  std::string name;
+  while (is >> type >> length) {
+    is.get();
+    std::getline(is, name);
+    if (static_cast<TypeId>(type) == TypeId::VARCHAR) {
+      columns.emplace_back(name, TypeId::VARCHAR, length);
+    } else {
+      columns.emplace_back(name, static_cast<TypeId>(type));
+    }
+  }
+  return Schema(columns);
+}
+
+template <size_t KeySize>
+std::unique_ptr<Index> NewIndexOfSize(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *bpm,
+                                      IndexType index_type, page_id_t *index_page_id) {
+  using KeyType = GenericKey<KeySize>;
+  using KeyComparator = GenericComparator<KeySize>;
+  if (index_type == IndexType::BPlusTreeIndex) {
+    auto tree = std::make_unique<BPlusTreeIndex<KeyType, RID, KeyComparator>>(std::move(metadata), bpm, *index_page_id);
+    *index_page_id = tree->GetHeaderPageId();
+    return tree;
+  }
+  auto hash_table = std::make_unique<ExtendibleHashTableIndex<KeyType, RID, KeyComparator>>(
+      std::move(metadata), bpm, HashFunction<KeyType>(), *index_page_id);
+  *index_page_id = hash_table->GetDirectoryPageId();
+  return hash_table;
+}
+
+}  // namespace
+
+const Schema &Catalog::CatalogSchema() {
+  static const Schema schema{std::vector<Column>{
+      Column{"kind", TypeId::INTEGER}, Column{"oid", TypeId::INTEGER}, Column{"name", TypeId::VARCHAR, 64},
+      Column{"table_name", TypeId::VARCHAR, 64}, Column{"page_id", TypeId::INTEGER},
+      Column{"key_size", TypeId::INTEGER}, Column{"key_type_size", TypeId::INTEGER},
+      Column{"definition", TypeId::VARCHAR, 256}, Column{"index_type", TypeId::INTEGER}}};
+  return schema;
+}
+
+void Catalog::Bootstrap(Transaction *txn) {
+  catalog_table_ = std::make_unique<TableHeap>(bpm_, lock_manager_, log_manager_, txn);
+  BUSTUB_ASSERT(catalog_table_->GetFirstPageId() == HEADER_PAGE_ID, "The database is not empty.");
+  Tuple header(std::vector<Value>{ValueFactory::GetIntegerValue(CATALOG_HEADER_ROW),
+                                  ValueFactory::GetIntegerValue(CATALOG_MAGIC), ValueFactory::GetVarcharValue(""),
+                                  ValueFactory::GetVarcharValue(""), ValueFactory::GetIntegerValue(INVALID_PAGE_ID),
+                                  ValueFactory::GetIntegerValue(CATALOG_VERSION), ValueFactory::GetIntegerValue(0),
+                                  ValueFactory::GetVarcharValue(""), ValueFactory::GetIntegerValue(0)},
+               &CatalogSchema());
+  RID rid;
+  catalog_table_->InsertTuple(header, &rid, txn);
+  BUSTUB_ASSERT(rid == RID(HEADER_PAGE_ID, 0), "The header row is the first row of the catalog table.");
+  // Creating the first page is not logged, so it has to be on disk right away.
+  bpm_->FlushPage(HEADER_PAGE_ID);
+}
+
+bool Catalog::CheckHeader() {
+  auto *page = static_cast<TablePage *>(bpm_->FetchPage(HEADER_PAGE_ID));
+  BUSTUB_ASSERT(page != nullptr, "The header page cannot be fetched.");
+  page->RLatch();
+  Tuple header;
+  bool found = page->ReadTuple(RID(HEADER_PAGE_ID, 0), &header);
+  page->RUnlatch();
+  bpm_->UnpinPage(HEADER_PAGE_ID, false);
+
+  // Only the fixed-size columns are read, they lie within the tuple if it is at least as long as the schema says.
+  const Schema &catalog_schema = CatalogSchema();
+  auto get_int = [&](CatalogColumn column) { return header.GetValue(&catalog_schema, column).GetAs<int32_t>(); };
+  if (!found || header.GetLength() < catalog_schema.GetLength() || get_int(KIND) != CATALOG_HEADER_ROW ||
+      get_int(OID) != CATALOG_MAGIC) {
+    throw Exception("The database file has no BusTub catalog.");
+  }
+  if (get_int(KEY_SIZE) != CATALOG_VERSION) {
+    throw Exception("The catalog format version " + std::to_string(get_int(KEY_SIZE)) + " is not supported.");
+  }
+  return get_int(KEY_TYPE_SIZE) != 0;
+}
+
+void Catalog::SetCleanShutdown(Transaction *txn, bool clean) {
+  Tuple header(std::vector<Value>{ValueFactory::GetIntegerValue(CATALOG_HEADER_ROW),
+                                  ValueFactory::GetIntegerValue(CATALOG_MAGIC), ValueFactory::GetVarcharValue(""),
+                                  ValueFactory::GetVarcharValue(""), ValueFactory::GetIntegerValue(INVALID_PAGE_ID),
+                                  ValueFactory::GetIntegerValue(CATALOG_VERSION),
+                                  ValueFactory::GetIntegerValue(clean ? 1 : 0), ValueFactory::GetVarcharValue(""),
+                                  ValueFactory::GetIntegerValue(0)},
+               &CatalogSchema());
+  catalog_table_->UpdateTuple(header, RID(HEADER_PAGE_ID, 0), txn);
+  bpm_->FlushPage(HEADER_PAGE_ID);
+}
+
+void Catalog::Open(Transaction *txn) {
+  std::scoped_lock lock(write_latch_);
+  bool clean = CheckHeader();
+  auto snapshot = std::make_unique<Snapshot>(*GetSnapshot());
+  catalog_table_ = std::make_unique<TableHeap>(bpm_, lock_manager_, log_manager_, HEADER_PAGE_ID);
+
+  const Schema &catalog_schema = CatalogSchema();
+  std::vector<Tuple> index_rows;
+  for (auto it = catalog_table_->Begin(txn); it != catalog_table_->End(); ++it) {
+    auto get_int = [&](CatalogColumn column) { return it->GetValue(&catalog_schema, column).GetAs<int32_t>(); };
+    auto get_string = [&](CatalogColumn column) { return it->GetValue(&catalog_schema, column).ToString(); };
+    if (get_int(KIND) == CATALOG_HEADER_ROW) {
+      continue;
+    }
+    if (get_int(KIND) == CATALOG_INDEX_ROW) {
+      // Indexes refer to their table by name, so they are opened once all tables are known.
+      index_rows.push_back(*it);
+      continue;
+    }
+
+    auto table_oid = static_cast<table_oid_t>(get_int(OID));
+    std::string table_name = get_string(NAME);
+    auto table = std::make_unique<TableHeap>(bpm_, lock_manager_, log_manager_, get_int(PAGE_ID));
+    table->SetTableOid(table_oid);
+    auto table_info = std::make_unique<TableInfo>(DeserializeColumns(get_string(DEFINITION)), table_name,
+                                                  std::move(table), table_oid);
+    snapshot->tables_.emplace(table_oid, table_info.get());
+    tables_.emplace(table_oid, std::move(table_info));
+    snapshot->table_names_.emplace(table_name, table_oid);
+    snapshot->index_names_.emplace(table_name, std::unordered_map<std::string, index_oid_t>{});
+    next_table_oid_ = std::max<table_oid_t>(next_table_oid_, table_oid + 1);
+  }
+
+  for (const auto &row : index_rows) {
+    auto get_int = [&](CatalogColumn column) { return row.GetValue(&catalog_schema, column).GetAs<int32_t>(); };
+    auto get_string = [&](CatalogColumn column) { return row.GetValue(&catalog_schema, column).ToString(); };
+    auto index_oid = static_cast<index_oid_t>(get_int(OID));
+    std::string index_name = get_string(NAME);
+    std::string table_name = get_string(TABLE_NAME);
+    auto table_oid = snapshot->table_names_.find(table_name);
+    BUSTUB_ASSERT(table_oid != snapshot->table_names_.end(), "Broken Invariant");
+    TableInfo *table_info = snapshot->tables_[table_oid->second];
+
+    std::vector<uint32_t> key_attrs;
+    std::istringstream is(get_string(DEFINITION));
+    uint32_t key_attr;
+    while (is >> key_attr) {
+      key_attrs.push_back(key_attr);
+    }
+    auto meta = std::make_unique<IndexMetadata>(index_name, table_name, &table_info->schema_, key_attrs);
+    Schema key_schema = *meta->GetKeySchema();
+    auto index_type = static_cast<IndexType>(get_int(INDEX_TYPE));
+    // Index pages are not logged, so what is on disk may be stale unless the database was shut down cleanly. The
+    // index is then rebuilt from its table, which recovery has brought up to date, and its row is pointed at the
+    // new pages.
+    page_id_t index_page_id = clean ? get_int(PAGE_ID) : INVALID_PAGE_ID;
+    auto index = NewIndex(std::move(meta), index_type, get_int(KEY_TYPE_SIZE), &index_page_id);
+    if (!clean) {
+      PopulateIndex(txn, index.get(), table_info->table_.get(), table_info->schema_, key_schema, key_attrs);
+      std::vector<Value> values;
+      for (uint32_t column = 0; column < catalog_schema.GetColumnCount(); column++) {
+        values.push_back(row.GetValue(&catalog_schema, column));
+      }
+      values[PAGE_ID] = ValueFactory::GetIntegerValue(index_page_id);
+      catalog_table_->UpdateTuple(Tuple(values, &catalog_schema), row.GetRid(), txn);
+    }
+    auto index_info = std::make_unique<IndexInfo>(key_schema, index_name, std::move(index), index_oid, table_name,
+                                                  get_int(KEY_SIZE), index_type);
+    snapshot->indexes_.emplace(index_oid, index_info.get());
+    indexes_.emplace(index_oid, std::move(index_info));
+    snapshot->index_names_[table_name].emplace(index_name, index_oid);
+    next_index_oid_ = std::max<index_oid_t>(next_index_oid_, index_oid + 1);
+  }
+  if (clean) {
+    // From now on the index pages on disk may fall behind their tables again.
+    SetCleanShutdown(txn, false);
+  }
+  Publish(std::move(snapshot));
+}
+
+void Catalog::Close(Transaction *txn) {
+  std::scoped_lock lock(write_latch_);
+  SetCleanShutdown(txn, true);
+  bpm_->FlushAllPages();
+}
+
+void Catalog::PopulateIndex(Transaction *txn, Index *index, TableHeap *heap, const Schema &schema,
+                            const Schema &key_schema, const std::vector<uint32_t> &key_attrs) {
+  // The page chain can only be followed one page at a time, so collect it first.
+  std::vector<page_id_t> page_ids;
+  for (page_id_t page_id = heap->GetFirstPageId(); page_id != INVALID_PAGE_ID;) {
+    page_ids.push_back(page_id);
+    auto *page = static_cast<TablePage *>(bpm_->FetchPage(page_id));
+    page->RLatch();
+    page_id = page->GetNextPageId();
+    page->RUnlatch();
+    bpm_->UnpinPage(page_ids.back(), false);
+  }
+
+  std::atomic<size_t> next_page{0};
+  auto worker = [&] {
+    std::vector<std::pair<Tuple, RID>> entries;
+    for (size_t i = next_page.fetch_add(1); i < page_ids.size(); i = next_page.fetch_add(1)) {
+      auto *page = static_cast<TablePage *>(bpm_->FetchPage(page_ids[i]));
+      page->RLatch();
+      RID rid;
+      Tuple tuple;
+      for (bool found = page->GetFirstTupleRid(&rid); found; found = page->GetNextTupleRid(rid, &rid)) {
+        if (page->ReadTuple(rid, &tuple)) {
+          entries.emplace_back(tuple.KeyFromTuple(schema, key_schema, key_attrs), rid);
+        }
+      }
+      page->RUnlatch();
+      bpm_->UnpinPage(page_ids[i], false);
+
+      for (const auto &[key, key_rid] : entries) {
+        index->InsertEntry(key, key_rid, txn);
+      }
+      entries.clear();
+    }
+  };
+
+  const size_t num_threads = std::min<size_t>(index_build_threads_, page_ids.size());
+  if (num_threads <= 1) {
+    worker();
+    return;
+  }
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < num_threads; i++) {
+    threads.emplace_back(worker);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+void Catalog::BuildIndex(Transaction *txn, Index *index, TableHeap *heap, const Schema &schema,
+                         const Schema &key_schema, const std::vector<uint32_t> &key_attrs) {
+  // The caller started the change log, so a change that the scan misses is applied afterwards.
+  TableChangeLog *change_log = heap->GetChangeLog();
+  PopulateIndex(txn, index, heap, schema, key_schema, key_attrs);
+
+  // Catch up without blocking writers, so that the final round under the latch is short.
+  for (int round = 0; round < MAX_CATCH_UP_ROUNDS; round++) {
+    auto changes = change_log->TakeChanges();
+    ApplyChanges(txn, index, changes, schema, key_schema, key_attrs);
+    if (changes.size() <= CATCH_UP_CHANGES) {
+      break;
+    }
+  }
+}
+
+void Catalog::FinishBuild(Transaction *txn, Index *index, TableHeap *heap, const std::unordered_set<txn_id_t> &writers,
+                          const Schema &schema, const Schema &key_schema, const std::vector<uint32_t> &key_attrs) {
+  TableChangeLog *change_log = heap->GetChangeLog();
+  for (txn_id_t txn_id : writers) {
+    if (txn != nullptr && txn_id == txn->GetTransactionId()) {
+      continue;
+    }
+    // A transaction leaves the map only after its rollback, so its undo is in the change log by then.
+    while (TransactionManager::IsRunning(txn_id)) {
+      ApplyChanges(txn, index, change_log->TakeChanges(), schema, key_schema, key_attrs);
+      std::this_thread::sleep_for(FINISH_BUILD_INTERVAL);
+    }
+  }
+  // Writers that maintain the index themselves may also be recorded, applying their changes again is harmless.
+  change_log->Lock();
+  ApplyChanges(txn, index, change_log->TakeChangesLocked(), schema, key_schema, key_attrs);
+  change_log->StopLocked();
+  change_log->Unlock();
+}
+
+bool Catalog::HoldsDataLocks(Transaction *txn) {
+  if (txn == nullptr) {
+    return false;
+  }
+  // The rows of the catalog table are not tracked per table, nobody waits for them.
+  auto table_row_locks = txn->GetTableRowLockSet();
+  return !txn->GetTableLockSet()->empty() || !txn->GetPageLockSet()->empty() ||
+         std::any_of(table_row_locks->begin(), table_row_locks->end(),
+                     [](const auto &table_rows) { return !table_rows.second.empty(); });
+}
+
+void Catalog::ApplyChanges(Transaction *txn, Index *index, const std::vector<TableChangeLog::Change> &changes,
+                           const Schema &schema, const Schema &key_schema, const std::vector<uint32_t> &key_attrs) {
+  // In log order, so the last change of a tuple wins. Changes that the scan has already seen are no-ops.
+  for (const auto &change : changes) {
+    Tuple key = change.tuple_.KeyFromTuple(schema, key_schema, key_attrs);
+    if (change.insert_) {
+      index->InsertEntry(key, change.rid_, txn);
+    } else {
+      index->DeleteEntry(key, change.rid_, txn);
+    }
+  }
+}
+
+void Catalog::PersistTable(Transaction *txn, TableInfo *table_info) {
+  Tuple row(std::vector<Value>{ValueFactory::GetIntegerValue(CATALOG_TABLE_ROW),
+                               ValueFactory::GetIntegerValue(table_info->oid_),
+                               ValueFactory::GetVarcharValue(table_info->name_),
+                               ValueFactory::GetVarcharValue(table_info->name_),
+                               ValueFactory::GetIntegerValue(table_info->table_->GetFirstPageId()),
+                               ValueFactory::GetIntegerValue(0), ValueFactory::GetIntegerValue(0),
+                               ValueFactory::GetVarcharValue(SerializeColumns(table_info->schema_)),
+                               ValueFactory::GetIntegerValue(0)},
+            &CatalogSchema());
+  RID rid;
+  catalog_table_->InsertTuple(row, &rid, txn);
+  // Reopening must not depend on redo, so the new row and the page it points at are on disk before the table is used.
+  // Later pages of the table are protected by the log.
+  FlushCatalogTable();
+  bpm_->FlushPage(table_info->table_->GetFirstPageId());
+}
+
+void Catalog::FlushCatalogTable() {
+  page_id_t page_id = catalog_table_->GetFirstPageId();
+  while (page_id != INVALID_PAGE_ID) {
+    auto *page = static_cast<TablePage *>(bpm_->FetchPage(page_id));
+    BUSTUB_ASSERT(page != nullptr, "A page of the catalog table cannot be fetched.");
+    page->RLatch();
+    page_id_t next_page_id = page->GetNextPageId();
+    page->RUnlatch();
+    bpm_->FlushPage(page_id);
+    bpm_->UnpinPage(page_id, false);
+    page_id = next_page_id;
+  }
+}
+
+void Catalog::PersistIndex(Transaction *txn, IndexInfo *index_info, size_t key_type_size, page_id_t index_page_id) {
+  std::ostringstream key_attrs;
+  for (auto key_attr : index_info->index_->GetKeyAttrs()) {
+    key_attrs << key_attr << ' ';
+  }
+  Tuple row(std::vector<Value>{ValueFactory::GetIntegerValue(CATALOG_INDEX_ROW),
+                               ValueFactory::GetIntegerValue(index_info->index_oid_),
+                               ValueFactory::GetVarcharValue(index_info->name_),
+                               ValueFactory::GetVarcharValue(index_info->table_name_),
+                               ValueFactory::GetIntegerValue(index_page_id),
+                               ValueFactory::GetIntegerValue(index_info->key_size_),
+                               ValueFactory::GetIntegerValue(key_type_size),
+                               ValueFactory::GetVarcharValue(key_attrs.str()),
+                               ValueFactory::GetIntegerValue(static_cast<int32_t>(index_info->index_type_))},
+            &CatalogSchema());
+  RID rid;
+  catalog_table_->InsertTuple(row, &rid, txn);
+  // Reopening must not depend on redo. The index itself is rebuilt on reopen unless it was closed cleanly.
+  FlushCatalogTable();
+}
+
+std::unique_ptr<Index> Catalog::NewIndex(std::unique_ptr<IndexMetadata> &&metadata, IndexType index_type,
+                                         size_t key_type_size, page_id_t *index_page_id) {
+  switch (key_type_size) {
+    case 4:
+      return NewIndexOfSize<4>(std::move(metadata), bpm_, index_type, index_page_id);
+    case 8:
+      return NewIndexOfSize<8>(std::move(metadata), bpm_, index_type, index_page_id);
+    case 16:
+      return NewIndexOfSize<16>(std::move(metadata), bpm_, index_type, index_page_id);
+    case 32:
+      return NewIndexOfSize<32>(std::move(metadata), bpm_, index_type, index_page_id);
+    case 64:
+      return NewIndexOfSize<64>(std::move(metadata), bpm_, index_type, index_page_id);
+    default:
+      UNREACHABLE("Unsupported index key size.");
+  }
+}
+
+}  // namespace bustub
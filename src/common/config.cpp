@@ -18,6 +18,12 @@ std::atomic<bool> enable_logging(false);
 
 std::chrono::duration<int64_t> log_timeout = std::chrono::seconds(1);
 
+std::chrono::milliseconds async_commit_window = std::chrono::milliseconds(10);
+
+std::atomic<bool> enable_compact_log(false);
+
 std::chrono::milliseconds cycle_detection_interval = std::chrono::milliseconds(50);
 
+std::chrono::milliseconds version_gc_interval = std::chrono::milliseconds(100);
+
 }  // namespace bustub
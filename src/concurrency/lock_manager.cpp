@@ -12,31 +12,579 @@
 
 #include "concurrency/lock_manager.h"
 
+#include <algorithm>
+#include <functional>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
+#include "common/util/hash_util.h"
+#include "concurrency/transaction_manager.h"
+
 namespace bustub {
 
+LockManager::LockManager(DeadlockMode deadlock_mode) : deadlock_mode_(deadlock_mode) {
+  if (deadlock_mode_ == DeadlockMode::DETECTION) {
+    enable_cycle_detection_ = true;
+    cycle_detection_thread_ = std::thread(&LockManager::RunCycleDetection, this);
+  }
+}
+
+LockManager::~LockManager() {
+  if (cycle_detection_thread_.joinable()) {
+    enable_cycle_detection_ = false;
+    cycle_detection_thread_.join();
+  }
+}
+
+void LockManager::LockRequestQueue::Append(LockRequest *request) {
+  request->prev_ = tail_;
+  request->next_ = nullptr;
+  if (tail_ == nullptr) {
+    head_ = request;
+  } else {
+    tail_->next_ = request;
+  }
+  tail_ = request;
+}
+
+void LockManager::LockRequestQueue::Remove(LockRequest *request) {
+  if (request->prev_ == nullptr) {
+    head_ = request->next_;
+  } else {
+    request->prev_->next_ = request->next_;
+  }
+  if (request->next_ == nullptr) {
+    tail_ = request->prev_;
+  } else {
+    request->next_->prev_ = request->prev_;
+  }
+}
+
+LockManager::LockRequest *LockManager::LockRequestQueue::Find(txn_id_t txn_id) const {
+  for (LockRequest *request = head_; request != nullptr; request = request->next_) {
+    if (request->txn_id_ == txn_id) {
+      return request;
+    }
+  }
+  return nullptr;
+}
+
+LockManager::LockRequest *LockManager::LockRequestPool::Allocate(txn_id_t txn_id, LockMode lock_mode) {
+  if (free_list_ == nullptr) {
+    chunks_.emplace_back(new LockRequest[CHUNK_SIZE]);
+    LockRequest *chunk = chunks_.back().get();
+    for (size_t i = 0; i < CHUNK_SIZE; i++) {
+      chunk[i].next_ = i + 1 < CHUNK_SIZE ? &chunk[i + 1] : nullptr;
+    }
+    free_list_ = chunk;
+  }
+  LockRequest *request = free_list_;
+  free_list_ = request->next_;
+  request->txn_id_ = txn_id;
+  request->lock_mode_ = lock_mode;
+  request->granted_ = false;
+  request->prev_ = nullptr;
+  request->next_ = nullptr;
+  return request;
+}
+
+void LockManager::LockRequestPool::Free(LockRequest *request) {
+  request->next_ = free_list_;
+  free_list_ = request;
+}
+
+size_t LockManager::LockTargetHash::operator()(const LockTarget &target) const {
+  return HashUtil::CombineHashes(static_cast<hash_t>(target.granularity_), static_cast<hash_t>(target.id_));
+}
+
+bool LockManager::AreCompatible(LockMode a, LockMode b) {
+  // The compatibility matrix of multi-granularity locking, indexed by the lock modes.
+  static constexpr bool COMPATIBLE[6][6] = {
+      // IS     IX     S      SIX    X      INC
+      {true, true, true, true, false, false},      // IS
+      {true, true, false, false, false, false},    // IX
+      {true, false, true, false, false, false},    // S
+      {true, false, false, false, false, false},   // SIX
+      {false, false, false, false, false, false},  // X
+      {false, false, false, false, false, true}};  // INC
+  return COMPATIBLE[static_cast<int>(a)][static_cast<int>(b)];
+}
+
+bool LockManager::Covers(LockMode held, LockMode wanted) {
+  switch (held) {
+    case LockMode::EXCLUSIVE:
+      return true;
+    case LockMode::SHARED_INTENTION_EXCLUSIVE:
+      return wanted != LockMode::EXCLUSIVE && wanted != LockMode::INCREMENT;
+    case LockMode::SHARED:
+      return wanted == LockMode::SHARED || wanted == LockMode::INTENTION_SHARED;
+    case LockMode::INTENTION_EXCLUSIVE:
+      return wanted == LockMode::INTENTION_EXCLUSIVE || wanted == LockMode::INTENTION_SHARED;
+    case LockMode::INTENTION_SHARED:
+      return wanted == LockMode::INTENTION_SHARED;
+    case LockMode::INCREMENT:
+      return wanted == LockMode::INCREMENT;
+  }
+  return false;
+}
+
+LockMode LockManager::Combine(LockMode a, LockMode b) {
+  if (Covers(a, b)) {
+    return a;
+  }
+  if (Covers(b, a)) {
+    return b;
+  }
+  // Incrementing and doing anything else with a row takes an EXCLUSIVE lock.
+  if (a == LockMode::INCREMENT || b == LockMode::INCREMENT) {
+    return LockMode::EXCLUSIVE;
+  }
+  // Only SHARED and INTENTION_EXCLUSIVE do not cover each other.
+  return LockMode::SHARED_INTENTION_EXCLUSIVE;
+}
+
+LockManager::LockTablePartition *LockManager::GetPartition(const LockTarget &target) {
+  return &partitions_[LockTargetHash{}(target) % LOCK_TABLE_PARTITIONS];
+}
+
+void LockManager::AbortTransaction(Transaction *txn, AbortReason reason) {
+  txn->SetState(TransactionState::ABORTED);
+  throw TransactionAbortException(txn->GetTransactionId(), reason);
+}
+
+void LockManager::Wound(Transaction *txn, LockMode lock_mode, LockRequestQueue *queue) {
+  bool wounded = false;
+  for (LockRequest *request = queue->head_; request != nullptr; request = request->next_) {
+    if (request->txn_id_ <= txn->GetTransactionId() || AreCompatible(lock_mode, request->lock_mode_)) {
+      continue;
+    }
+    // A wounded transaction that waits notices it below, one that holds the lock releases it when it is aborted.
+    Transaction *younger = TransactionManager::GetTransaction(request->txn_id_);
+    if (younger->GetState() != TransactionState::COMMITTED && younger->GetState() != TransactionState::ABORTED) {
+      younger->SetState(TransactionState::ABORTED);
+      wounded = true;
+    }
+  }
+  if (wounded) {
+    queue->cv_.notify_all();
+  }
+}
+
+bool LockManager::Blocks(const LockRequest *other, bool other_before, const LockRequest *request, bool upgrading) {
+  return (other->granted_ || (other_before && !upgrading)) && !AreCompatible(request->lock_mode_, other->lock_mode_);
+}
+
+bool LockManager::IsGrantable(const LockRequestQueue &queue, const LockRequest *request, bool upgrading) {
+  bool before = true;
+  for (const LockRequest *other = queue.head_; other != nullptr; other = other->next_) {
+    if (other == request) {
+      before = false;
+      continue;
+    }
+    if (Blocks(other, before, request, upgrading)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool LockManager::WaitForGrant(std::unique_lock<std::mutex> *lock, Transaction *txn, const LockTarget &target,
+                               LockRequestQueue *queue, LockRequest *request, bool upgrading) {
+  bool granted = true;
+  while (!IsGrantable(*queue, request, upgrading)) {
+    if (txn->GetState() == TransactionState::ABORTED) {
+      granted = false;
+      break;
+    }
+    UpdateWaitsFor(target, *queue);
+    queue->cv_.wait_for(*lock, WOUND_CHECK_INTERVAL);
+  }
+  RemoveWaitsFor(txn->GetTransactionId());
+  if (!granted || txn->GetState() == TransactionState::ABORTED) {
+    return false;
+  }
+  request->granted_ = true;
+  return true;
+}
+
+void LockManager::RemoveRequest(LockTablePartition *partition, const LockTarget &target, LockRequestQueue *queue,
+                                LockRequest *request) {
+  queue->Remove(request);
+  partition->pool_.Free(request);
+  // Every waiter has a request in the queue, so nobody waits on an empty queue's condition variable.
+  if (queue->IsEmpty()) {
+    partition->lock_table_.erase(target);
+  } else {
+    UpdateWaitsFor(target, *queue);
+    queue->cv_.notify_all();
+  }
+}
+
+void LockManager::UpdateWaitsFor(const LockTarget &target, const LockRequestQueue &queue) {
+  if (deadlock_mode_ != DeadlockMode::DETECTION) {
+    return;
+  }
+  // Recomputed for the whole queue, as a request that leaves or changes its mode may unblock or block the others.
+  std::scoped_lock lock(waits_for_latch_);
+  for (const LockRequest *request = queue.head_; request != nullptr; request = request->next_) {
+    if (request->granted_) {
+      continue;
+    }
+    bool upgrading = queue.upgrading_ == request->txn_id_;
+    std::vector<txn_id_t> blockers;
+    bool before = true;
+    for (const LockRequest *other = queue.head_; other != nullptr; other = other->next_) {
+      if (other == request) {
+        before = false;
+      } else if (Blocks(other, before, request, upgrading)) {
+        blockers.push_back(other->txn_id_);
+      }
+    }
+    std::sort(blockers.begin(), blockers.end());
+    waits_for_[request->txn_id_] = {target, std::move(blockers)};
+  }
+}
+
+void LockManager::RemoveWaitsFor(txn_id_t txn_id) {
+  if (deadlock_mode_ != DeadlockMode::DETECTION) {
+    return;
+  }
+  std::scoped_lock lock(waits_for_latch_);
+  waits_for_.erase(txn_id);
+}
+
+LockMode LockManager::Acquire(Transaction *txn, const LockTarget &target, LockMode lock_mode) {
+  LockTablePartition *partition = GetPartition(target);
+  std::unique_lock lock(partition->latch_);
+  LockRequestQueue *queue = &partition->lock_table_[target];
+  LockRequest *request = queue->Find(txn->GetTransactionId());
+
+  if (request == nullptr) {
+    request = partition->pool_.Allocate(txn->GetTransactionId(), lock_mode);
+    queue->Append(request);
+    if (deadlock_mode_ == DeadlockMode::PREVENTION) {
+      Wound(txn, lock_mode, queue);
+    }
+    if (!WaitForGrant(&lock, txn, target, queue, request, false)) {
+      RemoveRequest(partition, target, queue, request);
+      lock.unlock();
+      AbortTransaction(txn, AbortReason::DEADLOCK);
+    }
+    return lock_mode;
+  }
+
+  LockMode held_mode = request->lock_mode_;
+  if (Covers(held_mode, lock_mode)) {
+    return held_mode;
+  }
+  if (queue->upgrading_ != INVALID_TXN_ID) {
+    lock.unlock();
+    AbortTransaction(txn, AbortReason::UPGRADE_CONFLICT);
+  }
+
+  // The request keeps its place in the queue and waits for the other granted requests to be released.
+  queue->upgrading_ = txn->GetTransactionId();
+  request->lock_mode_ = Combine(held_mode, lock_mode);
+  request->granted_ = false;
+  if (deadlock_mode_ == DeadlockMode::PREVENTION) {
+    Wound(txn, request->lock_mode_, queue);
+  }
+  bool granted = WaitForGrant(&lock, txn, target, queue, request, true);
+  queue->upgrading_ = INVALID_TXN_ID;
+  if (!granted) {
+    // The transaction still holds its old lock until it is aborted.
+    request->lock_mode_ = held_mode;
+    request->granted_ = true;
+    UpdateWaitsFor(target, *queue);
+    queue->cv_.notify_all();
+    lock.unlock();
+    AbortTransaction(txn, AbortReason::DEADLOCK);
+  }
+  return request->lock_mode_;
+}
+
+std::optional<LockMode> LockManager::Release(Transaction *txn, const LockTarget &target, bool shrink) {
+  LockTablePartition *partition = GetPartition(target);
+  std::scoped_lock lock(partition->latch_);
+  auto it = partition->lock_table_.find(target);
+  if (it == partition->lock_table_.end()) {
+    return std::nullopt;
+  }
+  LockRequest *request = it->second.Find(txn->GetTransactionId());
+  if (request == nullptr) {
+    return std::nullopt;
+  }
+  LockMode lock_mode = request->lock_mode_;
+  RemoveRequest(partition, target, &it->second, request);
+
+  // Releasing an intention lock does not end the growing phase, nor does releasing a shared lock early under
+  // READ_COMMITTED.
+  shrink = shrink && (lock_mode == LockMode::EXCLUSIVE || lock_mode == LockMode::SHARED_INTENTION_EXCLUSIVE ||
+                      lock_mode == LockMode::INCREMENT ||
+                      (lock_mode == LockMode::SHARED && txn->GetIsolationLevel() != IsolationLevel::READ_COMMITTED));
+  if (shrink && txn->GetState() == TransactionState::GROWING) {
+    txn->SetState(TransactionState::SHRINKING);
+  }
+  return lock_mode;
+}
+
+bool LockManager::CanLock(Transaction *txn, LockMode lock_mode) {
+  if (txn->GetState() == TransactionState::ABORTED) {
+    return false;
+  }
+  bool reads = lock_mode == LockMode::SHARED || lock_mode == LockMode::INTENTION_SHARED ||
+               lock_mode == LockMode::SHARED_INTENTION_EXCLUSIVE;
+  if (reads && txn->GetIsolationLevel() == IsolationLevel::READ_UNCOMMITTED) {
+    AbortTransaction(txn, AbortReason::LOCKSHARED_ON_READ_UNCOMMITTED);
+  }
+  if (txn->GetState() == TransactionState::SHRINKING) {
+    AbortTransaction(txn, AbortReason::LOCK_ON_SHRINKING);
+  }
+  if (txn->IsReadOnly() && lock_mode != LockMode::SHARED && lock_mode != LockMode::INTENTION_SHARED) {
+    AbortTransaction(txn, AbortReason::WRITE_ON_READ_ONLY);
+  }
+  return true;
+}
+
 bool LockManager::LockShared(Transaction *txn, const RID &rid) {
+  if (!CanLock(txn, LockMode::SHARED)) {
+    return false;
+  }
+  // A read-only transaction never holds an exclusive lock, so its shared locks never take part in an upgrade.
+  if (txn->IsSharedLocked(rid) || (!txn->IsReadOnly() && txn->IsExclusiveLocked(rid))) {
+    return true;
+  }
+  // Reading a row that the transaction increments excludes the other incrementers.
+  if (!txn->IsReadOnly() && txn->IsIncrementLocked(rid)) {
+    return LockExclusive(txn, rid);
+  }
+  Acquire(txn, {Granularity::ROW, rid.Get()}, LockMode::SHARED);
   txn->GetSharedLockSet()->emplace(rid);
   return true;
 }
 
 bool LockManager::LockExclusive(Transaction *txn, const RID &rid) {
+  if (!CanLock(txn, LockMode::EXCLUSIVE)) {
+    return false;
+  }
+  if (txn->IsExclusiveLocked(rid)) {
+    return true;
+  }
+  Acquire(txn, {Granularity::ROW, rid.Get()}, LockMode::EXCLUSIVE);
+  txn->GetSharedLockSet()->erase(rid);
+  txn->GetIncrementLockSet()->erase(rid);
   txn->GetExclusiveLockSet()->emplace(rid);
   return true;
 }
 
-bool LockManager::LockUpgrade(Transaction *txn, const RID &rid) {
-  txn->GetSharedLockSet()->erase(rid);
-  txn->GetExclusiveLockSet()->emplace(rid);
+bool LockManager::LockIncrement(Transaction *txn, const RID &rid) {
+  if (!CanLock(txn, LockMode::INCREMENT)) {
+    return false;
+  }
+  if (txn->IsIncrementLocked(rid) || txn->IsExclusiveLocked(rid)) {
+    return true;
+  }
+  // A shared lock is upgraded to EXCLUSIVE.
+  if (Acquire(txn, {Granularity::ROW, rid.Get()}, LockMode::INCREMENT) == LockMode::EXCLUSIVE) {
+    txn->GetSharedLockSet()->erase(rid);
+    txn->GetExclusiveLockSet()->emplace(rid);
+  } else {
+    txn->GetIncrementLockSet()->emplace(rid);
+  }
   return true;
 }
 
+bool LockManager::LockUpgrade(Transaction *txn, const RID &rid) {
+  if (!CanLock(txn, LockMode::EXCLUSIVE)) {
+    return false;
+  }
+  if (txn->IsExclusiveLocked(rid)) {
+    return true;
+  }
+  if (!txn->IsSharedLocked(rid)) {
+    return false;
+  }
+  return LockExclusive(txn, rid);
+}
+
 bool LockManager::Unlock(Transaction *txn, const RID &rid) {
+  // Under READ_COMMITTED, an increment lock on a row the transaction did not increment was only taken to read it.
+  bool shrink = !(txn->IsIncrementLocked(rid) && txn->GetIsolationLevel() == IsolationLevel::READ_COMMITTED &&
+                  txn->GetDeltaSet()->count(rid) == 0);
   txn->GetSharedLockSet()->erase(rid);
   txn->GetExclusiveLockSet()->erase(rid);
+  txn->GetIncrementLockSet()->erase(rid);
+  for (auto &[oid, rows] : *txn->GetTableRowLockSet()) {
+    rows.erase(rid);
+  }
+  return Release(txn, {Granularity::ROW, rid.Get()}, shrink).has_value();
+}
+
+bool LockManager::LockTable(Transaction *txn, LockMode lock_mode, table_oid_t oid) {
+  if (!CanLock(txn, lock_mode)) {
+    return false;
+  }
+  auto table_locks = txn->GetTableLockSet();
+  auto it = table_locks->find(oid);
+  if (it != table_locks->end() && Covers(it->second, lock_mode)) {
+    return true;
+  }
+  (*table_locks)[oid] = Acquire(txn, {Granularity::TABLE, oid}, lock_mode);
   return true;
 }
 
+bool LockManager::LockPage(Transaction *txn, LockMode lock_mode, table_oid_t oid, page_id_t page_id) {
+  if (!CanLock(txn, lock_mode)) {
+    return false;
+  }
+  // Reading a page needs at least INTENTION_SHARED on the table, writing it INTENTION_EXCLUSIVE.
+  auto table_locks = txn->GetTableLockSet();
+  auto table_it = table_locks->find(oid);
+  bool writes = lock_mode == LockMode::EXCLUSIVE || lock_mode == LockMode::INTENTION_EXCLUSIVE ||
+                lock_mode == LockMode::SHARED_INTENTION_EXCLUSIVE;
+  if (table_it == table_locks->end() ||
+      !Covers(table_it->second, writes ? LockMode::INTENTION_EXCLUSIVE : LockMode::INTENTION_SHARED)) {
+    AbortTransaction(txn, AbortReason::TABLE_LOCK_NOT_PRESENT);
+  }
+  auto page_locks = txn->GetPageLockSet();
+  auto it = page_locks->find(page_id);
+  if (it != page_locks->end() && Covers(it->second, lock_mode)) {
+    return true;
+  }
+  (*page_locks)[page_id] = Acquire(txn, {Granularity::PAGE, page_id}, lock_mode);
+  return true;
+}
+
+bool LockManager::UnlockTable(Transaction *txn, table_oid_t oid) {
+  txn->GetTableLockSet()->erase(oid);
+  return Release(txn, {Granularity::TABLE, oid}).has_value();
+}
+
+bool LockManager::UnlockPage(Transaction *txn, page_id_t page_id) {
+  txn->GetPageLockSet()->erase(page_id);
+  return Release(txn, {Granularity::PAGE, page_id}).has_value();
+}
+
+void LockManager::TrackRowLock(Transaction *txn, table_oid_t oid, const RID &rid) {
+  if (!txn->IsSharedLocked(rid) && !txn->IsExclusiveLocked(rid) && !txn->IsIncrementLocked(rid)) {
+    return;
+  }
+  auto &rows = (*txn->GetTableRowLockSet())[oid];
+  rows.emplace(rid);
+  if (rows.size() > escalation_threshold_) {
+    Escalate(txn, oid);
+  }
+}
+
+void LockManager::Escalate(Transaction *txn, table_oid_t oid) {
+  auto table_rows = txn->GetTableRowLockSet();
+  const auto &rows = (*table_rows)[oid];
+  bool exclusive = std::any_of(rows.begin(), rows.end(), [&](const RID &rid) {
+    return txn->IsExclusiveLocked(rid) || txn->IsIncrementLocked(rid);
+  });
+  if (!LockTable(txn, exclusive ? LockMode::EXCLUSIVE : LockMode::SHARED, oid)) {
+    return;
+  }
+  // The table lock covers the rows now, so dropping their locks is not the start of the shrinking phase.
+  for (const RID &rid : rows) {
+    txn->GetSharedLockSet()->erase(rid);
+    txn->GetExclusiveLockSet()->erase(rid);
+    txn->GetIncrementLockSet()->erase(rid);
+    Release(txn, {Granularity::ROW, rid.Get()}, false);
+  }
+  table_rows->erase(oid);
+  num_escalations_++;
+}
+
+size_t LockManager::GetLockTableMemory() {
+  // Estimated from the layout of the unordered map: one node per queue and one pointer per bucket.
+  size_t bytes = 0;
+  for (auto &partition : partitions_) {
+    std::scoped_lock lock(partition.latch_);
+    bytes += partition.pool_.GetAllocatedBytes() +
+             partition.lock_table_.size() * (sizeof(std::pair<LockTarget, LockRequestQueue>) + sizeof(void *)) +
+             partition.lock_table_.bucket_count() * sizeof(void *);
+  }
+  return bytes;
+}
+
+std::vector<std::pair<txn_id_t, txn_id_t>> LockManager::GetEdgeList() {
+  std::scoped_lock lock(waits_for_latch_);
+  std::vector<std::pair<txn_id_t, txn_id_t>> edges;
+  for (const auto &[txn_id, waiter] : waits_for_) {
+    for (txn_id_t blocker : waiter.blockers_) {
+      edges.emplace_back(txn_id, blocker);
+    }
+  }
+  return edges;
+}
+
+bool LockManager::HasCycle(txn_id_t *txn_id) {
+  std::scoped_lock lock(waits_for_latch_);
+  return FindCycle(txn_id);
+}
+
+bool LockManager::FindCycle(txn_id_t *txn_id) {
+  // Only waiting transactions have outgoing edges, so a cycle is made of waiting transactions only.
+  std::unordered_set<txn_id_t> visited;
+  std::vector<txn_id_t> path;
+  std::unordered_set<txn_id_t> on_path;
+  std::function<bool(txn_id_t)> dfs = [&](txn_id_t current) {
+    visited.emplace(current);
+    path.push_back(current);
+    on_path.emplace(current);
+    auto it = waits_for_.find(current);
+    if (it != waits_for_.end()) {
+      for (txn_id_t next : it->second.blockers_) {
+        if (on_path.count(next) > 0) {
+          // The cycle is the part of the path from next on, its youngest transaction is the victim.
+          *txn_id = *std::max_element(std::find(path.begin(), path.end(), next), path.end());
+          return true;
+        }
+        if (visited.count(next) == 0 && dfs(next)) {
+          return true;
+        }
+      }
+    }
+    path.pop_back();
+    on_path.erase(current);
+    return false;
+  };
+  for (const auto &[start, waiter] : waits_for_) {
+    if (visited.count(start) == 0 && dfs(start)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void LockManager::RunCycleDetection() {
+  while (enable_cycle_detection_) {
+    std::this_thread::sleep_for(cycle_detection_interval);
+    std::vector<LockTarget> victims;
+    {
+      std::scoped_lock lock(waits_for_latch_);
+      txn_id_t victim;
+      while (FindCycle(&victim)) {
+        // The victim stops waiting once it sees that it was aborted, which breaks the cycle.
+        Transaction *txn = TransactionManager::GetTransaction(victim);
+        txn->SetState(TransactionState::ABORTED);
+        victims.push_back(waits_for_[victim].target_);
+        waits_for_.erase(victim);
+        num_deadlocks_++;
+      }
+    }
+    // Wake the victims up without waiting for their next check, the graph latch comes after the partition latches.
+    for (const LockTarget &target : victims) {
+      LockTablePartition *partition = GetPartition(target);
+      std::scoped_lock lock(partition->latch_);
+      auto it = partition->lock_table_.find(target);
+      if (it != partition->lock_table_.end()) {
+        it->second.cv_.notify_all();
+      }
+    }
+  }
+}
+
 }  // namespace bustub
@@ -12,34 +12,159 @@
 
 #include "concurrency/transaction_manager.h"
 
+#include <algorithm>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 
 #include "catalog/catalog.h"
 #include "storage/table/table_heap.h"
 
 namespace bustub {
 
-std::unordered_map<txn_id_t, Transaction *> TransactionManager::txn_map = {};
-std::shared_mutex TransactionManager::txn_map_mutex = {};
+std::array<TransactionManager::TxnMapShard, TransactionManager::TXN_MAP_SHARDS> TransactionManager::txn_map = {};
 
-Transaction *TransactionManager::Begin(Transaction *txn, IsolationLevel isolation_level) {
-  // Acquire the global transaction latch in shared mode.
-  global_txn_latch_.RLock();
+TransactionManager::~TransactionManager() {
+  StopGarbageCollection();
+  for (Transaction *txn : txn_pool_) {
+    delete txn;
+  }
+}
+
+void TransactionManager::Register(std::unordered_map<txn_id_t, Transaction *> *txns, Transaction *txn, TxnNode *node) {
+  if (node->empty()) {
+    (*txns)[txn->GetTransactionId()] = txn;
+    return;
+  }
+  node->key() = txn->GetTransactionId();
+  node->mapped() = txn;
+  auto result = txns->insert(std::move(*node));
+  if (!result.inserted) {
+    // Transaction ids are only unique per transaction manager, the last transaction with the id wins as before.
+    result.position->second = txn;
+    *node = std::move(result.node);
+  }
+}
+
+void TransactionManager::Unregister(std::unordered_map<txn_id_t, Transaction *> *txns, Transaction *txn,
+                                    TxnNode *node) {
+  auto it = txns->find(txn->GetTransactionId());
+  if (it != txns->end() && it->second == txn) {
+    *node = txns->extract(it);
+  }
+}
+
+Transaction *TransactionManager::NewTransaction(IsolationLevel isolation_level, bool read_only) {
+  Transaction *txn = nullptr;
+  {
+    std::scoped_lock lock(txn_pool_latch_);
+    if (!txn_pool_.empty()) {
+      txn = txn_pool_.back();
+      txn_pool_.pop_back();
+    }
+  }
+  if (txn != nullptr) {
+    txn->Reset(next_txn_id_++, isolation_level, read_only);
+    return txn;
+  }
+  return new Transaction(next_txn_id_++, isolation_level, read_only);
+}
+
+void TransactionManager::AddToTxnMap(Transaction *txn) {
+  TxnMapShard &shard = GetTxnMapShard(txn->GetTransactionId());
+  std::unique_lock lock(shard.latch_);
+  Register(&shard.txns_, txn, &txn->registry_node_);
+}
+
+void TransactionManager::RemoveFromTxnMap(Transaction *txn) {
+  TxnMapShard &shard = GetTxnMapShard(txn->GetTransactionId());
+  std::unique_lock lock(shard.latch_);
+  Unregister(&shard.txns_, txn, &txn->registry_node_);
+}
 
+Transaction *TransactionManager::Begin(Transaction *txn, IsolationLevel isolation_level) {
   if (txn == nullptr) {
-    txn = new Transaction(next_txn_id_++, isolation_level);
+    txn = NewTransaction(isolation_level, false);
+    txn->SetAsyncCommit(async_commit_);
+    txn->SetLogStaging(log_staging_);
+    txn->SetOptimistic(optimistic_);
+  }
+
+  if (txn->IsReadOnly()) {
+    // A read-only transaction changes no pages and writes no log records, so checkpoints need not wait for it. One
+    // that takes shared locks is registered, so that the lock manager can wound it or pick it as a deadlock victim.
+    if (!txn->ReadsSnapshot()) {
+      AddToTxnMap(txn);
+    }
+  } else {
+    // Acquire the global transaction latch in shared mode.
+    global_txn_latch_.RLock();
+    AddToTxnMap(txn);
+    std::scoped_lock lock(active_txns_latch_);
+    Register(&active_txns_, txn, &txn->active_node_);
+  }
+  if (txn->ReadsSnapshot()) {
+    std::scoped_lock lock(version_latch_);
+    txn->SetReadTs(last_commit_ts_);
+    snapshots_.insert(last_commit_ts_);
+  }
+
+  if (enable_logging && log_manager_ != nullptr && !txn->IsReadOnly()) {
+    if (txn->IsLogStaging()) {
+      log_manager_->StartLogStaging(txn);
+    }
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::BEGIN);
+    log_manager_->AppendLogRecord(txn, &log_record);
   }
-  txn_map_mutex.lock();
-  txn_map[txn->GetTransactionId()] = txn;
-  txn_map_mutex.unlock();
   return txn;
 }
 
+Transaction *TransactionManager::BeginReadOnly(IsolationLevel isolation_level) {
+  return Begin(NewTransaction(isolation_level, true));
+}
+
+void TransactionManager::FinishReadOnly(Transaction *txn) {
+  // There is nothing to apply, roll back or log, only the snapshot or the shared locks to give up.
+  if (txn->ReadsSnapshot()) {
+    std::scoped_lock lock(version_latch_);
+    snapshots_.erase(snapshots_.find(txn->GetReadTs()));
+    return;
+  }
+  ReleaseLocks(txn);
+  RemoveFromTxnMap(txn);
+}
+
 void TransactionManager::Commit(Transaction *txn) {
+  if (txn->IsReadOnly()) {
+    txn->SetState(TransactionState::COMMITTED);
+    FinishReadOnly(txn);
+    return;
+  }
+  // An optimistic transaction takes its locks only now. It is VALIDATING rather than COMMITTED until it holds them
+  // all, so that an older transaction waiting for one of them can still wound it.
+  if (txn->IsOptimistic()) {
+    txn->SetState(TransactionState::VALIDATING);
+    ApplyBufferedWrites(txn);
+  }
   txn->SetState(TransactionState::COMMITTED);
+  // Transactions that increment the same tuples apply their increments one after the other, each up to its COMMIT
+  // record. The log then never has the increments of a transaction between the update and the COMMIT record of
+  // another, so recovery can undo an unfinished transaction's update without losing increments that committed later.
+  std::unique_lock<std::mutex> escrow_lock(escrow_latch_, std::defer_lock);
+  auto delta_set = txn->GetDeltaSet();
+  if (!delta_set->empty()) {
+    escrow_lock.lock();
+    for (const auto &[rid, record] : *delta_set) {
+      record.table_->ApplyDelta(rid, record, txn);
+    }
+    delta_set->clear();
+  }
+  if (!CommitVersions(txn)) {
+    txn->SetState(TransactionState::ABORTED);
+    throw TransactionAbortException(txn->GetTransactionId(), AbortReason::VALIDATION_FAILED);
+  }
 
-  // Perform all deletes before we commit.
+  // Perform all deletes before we commit. The deleted tuples are in the version stores for older snapshots.
   auto write_set = txn->GetWriteSet();
   while (!write_set->empty()) {
     auto &item = write_set->back();
@@ -52,19 +177,54 @@ void TransactionManager::Commit(Transaction *txn) {
   }
   write_set->clear();
 
+  // The transaction is committed once its COMMIT record is durable. The flush thread groups concurrent commits
+  // into a single log write, so we only wait here instead of writing the log ourselves. An asynchronous commit does
+  // not wait at all, the flush thread makes it durable within the async commit window. With log staging, the whole
+  // transaction is appended here, and a read-only one has nothing to wait for.
+  if (enable_logging && log_manager_ != nullptr) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::COMMIT);
+    log_manager_->AppendLogRecord(txn, &log_record);
+    if (txn->IsLogStaging()) {
+      log_manager_->FinishLogStaging(txn);
+    }
+  }
+  if (escrow_lock.owns_lock()) {
+    escrow_lock.unlock();
+  }
+  if (enable_logging && log_manager_ != nullptr) {
+    if (txn->GetPrevLSN() != INVALID_LSN && txn->IsAsyncCommit()) {
+      log_manager_->ScheduleFlush(txn->GetPrevLSN());
+    } else if (txn->GetPrevLSN() != INVALID_LSN) {
+      log_manager_->WaitForPersistentLSN(txn->GetPrevLSN());
+    }
+  }
+
+  {
+    std::scoped_lock lock(active_txns_latch_);
+    Unregister(&active_txns_, txn, &txn->active_node_);
+  }
+
   // Release all the locks.
   ReleaseLocks(txn);
+  // Nobody waits for the transaction anymore, so the lock manager does not look it up again.
+  RemoveFromTxnMap(txn);
   // Release the global transaction latch.
   global_txn_latch_.RUnlock();
 }
 
 void TransactionManager::Abort(Transaction *txn) {
   txn->SetState(TransactionState::ABORTED);
+  if (txn->IsReadOnly()) {
+    FinishReadOnly(txn);
+    return;
+  }
   // Rollback before releasing the lock.
   auto table_write_set = txn->GetWriteSet();
+  std::vector<std::pair<TableHeap *, RID>> written;
   while (!table_write_set->empty()) {
     auto &item = table_write_set->back();
     auto table = item.table_;
+    written.emplace_back(table, item.rid_);
     if (item.wtype_ == WType::DELETE) {
       table->RollbackDelete(item.rid_, txn);
     } else if (item.wtype_ == WType::INSERT) {
@@ -76,6 +236,18 @@ void TransactionManager::Abort(Transaction *txn) {
     table_write_set->pop_back();
   }
   table_write_set->clear();
+  // Once the pages are rolled back, their tuples are the versions before the transaction again.
+  for (const auto &[table, rid] : written) {
+    table->GetVersionStore()->Abort(rid, txn);
+  }
+  txn->GetBufferedWriteSet()->clear();
+  txn->GetReadSet()->clear();
+  // The increments were never applied.
+  txn->GetDeltaSet()->clear();
+  if (txn->ReadsSnapshot()) {
+    std::scoped_lock lock(version_latch_);
+    snapshots_.erase(snapshots_.find(txn->GetReadTs()));
+  }
   // Rollback index updates
   auto index_write_set = txn->GetIndexWriteSet();
   while (!index_write_set->empty()) {
@@ -102,12 +274,165 @@ void TransactionManager::Abort(Transaction *txn) {
   table_write_set->clear();
   index_write_set->clear();
 
+  if (enable_logging && log_manager_ != nullptr) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::ABORT);
+    log_manager_->AppendLogRecord(txn, &log_record);
+    if (txn->IsLogStaging()) {
+      log_manager_->FinishLogStaging(txn);
+    }
+  }
+
+  {
+    std::scoped_lock lock(active_txns_latch_);
+    Unregister(&active_txns_, txn, &txn->active_node_);
+  }
+
   // Release all the locks.
   ReleaseLocks(txn);
+  // Nobody waits for the transaction anymore, so the lock manager does not look it up again.
+  RemoveFromTxnMap(txn);
   // Release the global transaction latch.
   global_txn_latch_.RUnlock();
 }
 
+void TransactionManager::Recycle(Transaction *txn) {
+  assert(txn->GetState() == TransactionState::COMMITTED || txn->GetState() == TransactionState::ABORTED);
+  {
+    std::scoped_lock lock(txn_pool_latch_);
+    if (txn_pool_.size() < TXN_POOL_SIZE) {
+      txn_pool_.push_back(txn);
+      return;
+    }
+  }
+  delete txn;
+}
+
+std::vector<std::tuple<txn_id_t, lsn_t, lsn_t>> TransactionManager::GetActiveTransactions() {
+  std::scoped_lock lock(active_txns_latch_);
+  std::vector<std::tuple<txn_id_t, lsn_t, lsn_t>> active_txns;
+  active_txns.reserve(active_txns_.size());
+  for (const auto &[txn_id, txn] : active_txns_) {
+    active_txns.emplace_back(txn_id, txn->GetPrevLSN(), txn->GetBeginLSN());
+  }
+  return active_txns;
+}
+
+void TransactionManager::ApplyBufferedWrites(Transaction *txn) {
+  auto buffered_writes = txn->GetBufferedWriteSet();
+  // Lock in a fixed order before latching any page, so that optimistic transactions never wait for each other in a
+  // cycle. The lock manager aborts the transaction with an exception if it has to, or refuses the lock once an older
+  // transaction wounded it.
+  if (lock_manager_ != nullptr) {
+    std::vector<RID> rids;
+    rids.reserve(buffered_writes->size());
+    for (const auto &item : *buffered_writes) {
+      rids.push_back(item.rid_);
+    }
+    std::sort(rids.begin(), rids.end(), [](const RID &a, const RID &b) { return a.Get() < b.Get(); });
+    for (const RID &rid : rids) {
+      if (!lock_manager_->LockExclusive(txn, rid)) {
+        throw TransactionAbortException(txn->GetTransactionId(), AbortReason::DEADLOCK);
+      }
+    }
+  }
+  for (const auto &item : *buffered_writes) {
+    bool applied = item.wtype_ == WType::DELETE ? item.table_->MarkDelete(item.rid_, txn)
+                                                 : item.table_->UpdateTuple(item.tuple_, item.rid_, txn);
+    if (!applied || txn->GetState() == TransactionState::ABORTED) {
+      txn->SetState(TransactionState::ABORTED);
+      throw TransactionAbortException(txn->GetTransactionId(), AbortReason::VALIDATION_FAILED);
+    }
+  }
+  buffered_writes->clear();
+}
+
+bool TransactionManager::CommitVersions(Transaction *txn) {
+  std::scoped_lock lock(version_latch_);
+  // Validating under the latch that orders the commits makes sure that nobody commits a change to the read set
+  // between the validation and the commit timestamp.
+  if (txn->IsOptimistic()) {
+    for (const auto &[table, rids] : *txn->GetReadSet()) {
+      for (const RID &rid : rids) {
+        if (!table->GetVersionStore()->IsUnchanged(rid, txn)) {
+          return false;
+        }
+      }
+    }
+  }
+  if (txn->ReadsSnapshot()) {
+    snapshots_.erase(snapshots_.find(txn->GetReadTs()));
+  }
+  auto write_set = txn->GetWriteSet();
+  if (write_set->empty()) {
+    return true;
+  }
+  // New snapshots see the writes only once they are all committed, as they take their timestamp under the latch.
+  timestamp_t commit_ts = last_commit_ts_ + 1;
+  for (const auto &item : *write_set) {
+    item.table_->GetVersionStore()->Commit(item.rid_, txn, commit_ts);
+  }
+  last_commit_ts_ = commit_ts;
+  // Without older snapshots, the versions the transaction replaced can go right away.
+  timestamp_t watermark = GetWatermarkLocked();
+  for (const auto &item : *write_set) {
+    std::shared_ptr<VersionStore> version_store = item.table_->GetVersionStore();
+    version_store->Prune(watermark, item.rid_);
+    version_stores_.emplace(version_store.get(), version_store);
+  }
+  return true;
+}
+
+timestamp_t TransactionManager::GetWatermark() {
+  std::scoped_lock lock(version_latch_);
+  return GetWatermarkLocked();
+}
+
+void TransactionManager::GarbageCollect() {
+  timestamp_t watermark;
+  std::vector<std::shared_ptr<VersionStore>> version_stores;
+  {
+    std::scoped_lock lock(version_latch_);
+    watermark = GetWatermarkLocked();
+    for (auto it = version_stores_.begin(); it != version_stores_.end();) {
+      std::shared_ptr<VersionStore> version_store = it->second.lock();
+      if (version_store == nullptr) {
+        it = version_stores_.erase(it);
+        continue;
+      }
+      version_stores.push_back(std::move(version_store));
+      ++it;
+    }
+  }
+  // The watermark only moves forward, so pruning with a stale one is safe.
+  for (const auto &version_store : version_stores) {
+    version_store->Prune(watermark);
+  }
+  std::scoped_lock lock(version_latch_);
+  for (const auto &version_store : version_stores) {
+    if (version_store->GetNumChains() == 0) {
+      version_stores_.erase(version_store.get());
+    }
+  }
+}
+
+void TransactionManager::StartGarbageCollection() {
+  if (enable_gc_.exchange(true)) {
+    return;
+  }
+  gc_thread_ = std::thread([this] {
+    while (enable_gc_) {
+      std::this_thread::sleep_for(version_gc_interval);
+      GarbageCollect();
+    }
+  });
+}
+
+void TransactionManager::StopGarbageCollection() {
+  if (enable_gc_.exchange(false)) {
+    gc_thread_.join();
+  }
+}
+
 void TransactionManager::BlockAllTransactions() { global_txn_latch_.WLock(); }
 
 void TransactionManager::ResumeTransactions() { global_txn_latch_.WUnlock(); }
@@ -24,9 +24,16 @@ namespace bustub {
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 HASH_TABLE_TYPE::ExtendibleHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
-                                     const KeyComparator &comparator, HashFunction<KeyType> hash_fn)
-    : buffer_pool_manager_(buffer_pool_manager), comparator_(comparator), hash_fn_(std::move(hash_fn)) {
-  //  implement me!
+                                     const KeyComparator &comparator, HashFunction<KeyType> hash_fn,
+                                     page_id_t directory_page_id)
+    : directory_page_id_(directory_page_id),
+      buffer_pool_manager_(buffer_pool_manager),
+      comparator_(comparator),
+      hash_fn_(std::move(hash_fn)) {
+  // An existing hash table is used as it is.
+  if(directory_page_id_ != INVALID_PAGE_ID){
+    return;
+  }
   Page* hash_table_directory_page = buffer_pool_manager_->NewPage(&directory_page_id_);
   HashTableDirectoryPage* page_data = reinterpret_cast<HashTableDirectoryPage*>(hash_table_directory_page->GetData());
   // initialize with 1 bit, 1 buckets
@@ -13,10 +13,57 @@
 
 namespace bustub {
 IndexScanExecutor::IndexScanExecutor(ExecutorContext *exec_ctx, const IndexScanPlanNode *plan)
-    : AbstractExecutor(exec_ctx) {}
+    : AbstractExecutor(exec_ctx), plan_(plan) {}
 
-void IndexScanExecutor::Init() {}
+void IndexScanExecutor::Init() {
+  Catalog *catalog = exec_ctx_->GetCatalog();
+  index_info_ = catalog->GetIndex(plan_->GetIndexOid());
+  table_info_ = catalog->GetTable(index_info_->table_name_);
+  if (!index_info_->index_->IsOrdered()) {
+    throw NotImplementedException("An index scan needs an ordered index, e.g. a B+ tree.");
+  }
+  rids_.clear();
+  std::optional<Tuple> low_key = MakeKey(plan_->GetLowKey());
+  std::optional<Tuple> high_key = MakeKey(plan_->GetHighKey());
+  index_info_->index_->ScanRange(low_key ? &*low_key : nullptr, high_key ? &*high_key : nullptr, &rids_,
+                                 exec_ctx_->GetTransaction());
+  next_ = 0;
+}
 
-bool IndexScanExecutor::Next(Tuple *tuple, RID *rid) { return false; }
+std::optional<Tuple> IndexScanExecutor::MakeKey(const std::vector<const AbstractExpression *> &columns) {
+  if (columns.empty()) {
+    return std::nullopt;
+  }
+  std::vector<Value> values;
+  values.reserve(columns.size());
+  for (const auto *column : columns) {
+    values.push_back(column->Evaluate(nullptr, nullptr));
+  }
+  return Tuple(values, index_info_->index_->GetKeySchema());
+}
+
+bool IndexScanExecutor::Next(Tuple *tuple, RID *rid) {
+  const Schema *schema = &table_info_->schema_;
+  const Schema *output_schema = GetOutputSchema();
+  while (next_ < rids_.size()) {
+    Tuple table_tuple;
+    // The entry may be stale if the tuple was deleted after the index was scanned.
+    if (!table_info_->table_->GetTuple(rids_[next_++], &table_tuple, exec_ctx_->GetTransaction())) {
+      continue;
+    }
+    if (plan_->GetPredicate() != nullptr && !plan_->GetPredicate()->Evaluate(&table_tuple, schema).GetAs<bool>()) {
+      continue;
+    }
+    std::vector<Value> values;
+    values.reserve(output_schema->GetColumnCount());
+    for (const auto &column : output_schema->GetColumns()) {
+      values.push_back(column.GetExpr()->Evaluate(&table_tuple, schema));
+    }
+    *tuple = Tuple(values, output_schema);
+    *rid = table_tuple.GetRid();
+    return true;
+  }
+  return false;
+}
 
 }  // namespace bustub
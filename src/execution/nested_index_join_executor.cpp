@@ -16,10 +16,55 @@ namespace bustub {
 
 NestIndexJoinExecutor::NestIndexJoinExecutor(ExecutorContext *exec_ctx, const NestedIndexJoinPlanNode *plan,
                                              std::unique_ptr<AbstractExecutor> &&child_executor)
-    : AbstractExecutor(exec_ctx) {}
+    : AbstractExecutor(exec_ctx), plan_(plan), child_executor_(std::move(child_executor)) {}
 
-void NestIndexJoinExecutor::Init() {}
+void NestIndexJoinExecutor::Init() {
+  Catalog *catalog = exec_ctx_->GetCatalog();
+  inner_table_info_ = catalog->GetTable(plan_->GetInnerTableOid());
+  index_info_ = catalog->GetIndex(plan_->GetIndexName(), inner_table_info_->name_);
+  // The left side of the predicate computes the probe key from the outer tuple.
+  if (plan_->Predicate() == nullptr) {
+    throw NotImplementedException("A nested index join needs a predicate whose left side is the probe key.");
+  }
+  child_executor_->Init();
+  inner_rids_.clear();
+  next_ = 0;
+}
 
-bool NestIndexJoinExecutor::Next(Tuple *tuple, RID *rid) { return false; }
+bool NestIndexJoinExecutor::Next(Tuple *tuple, RID *rid) {
+  Transaction *txn = exec_ctx_->GetTransaction();
+  const Schema *outer_schema = plan_->OuterTableSchema();
+  const Schema *inner_schema = plan_->InnerTableSchema();
+  while (true) {
+    while (next_ < inner_rids_.size()) {
+      Tuple inner_tuple;
+      if (!inner_table_info_->table_->GetTuple(inner_rids_[next_++], &inner_tuple, txn)) {
+        continue;
+      }
+      if (!plan_->Predicate()->EvaluateJoin(&outer_tuple_, outer_schema, &inner_tuple, inner_schema).GetAs<bool>()) {
+        continue;
+      }
+      std::vector<Value> values;
+      values.reserve(GetOutputSchema()->GetColumnCount());
+      for (const auto &column : GetOutputSchema()->GetColumns()) {
+        values.push_back(column.GetExpr()->EvaluateJoin(&outer_tuple_, outer_schema, &inner_tuple, inner_schema));
+      }
+      *tuple = Tuple(values, GetOutputSchema());
+      *rid = inner_tuple.GetRid();
+      return true;
+    }
+
+    RID outer_rid;
+    if (!child_executor_->Next(&outer_tuple_, &outer_rid)) {
+      return false;
+    }
+    // Both hash tables and B+ trees answer the point lookup, a B+ tree's entries come back in key order.
+    Value probe = plan_->Predicate()->GetChildAt(0)->Evaluate(&outer_tuple_, outer_schema);
+    Tuple key(std::vector<Value>{probe}, index_info_->index_->GetKeySchema());
+    inner_rids_.clear();
+    next_ = 0;
+    index_info_->index_->ScanKey(key, &inner_rids_, txn);
+  }
+}
 
 }  // namespace bustub
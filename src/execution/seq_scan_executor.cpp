@@ -14,10 +14,72 @@
 
 namespace bustub {
 
-SeqScanExecutor::SeqScanExecutor(ExecutorContext *exec_ctx, const SeqScanPlanNode *plan) : AbstractExecutor(exec_ctx) {}
+SeqScanExecutor::SeqScanExecutor(ExecutorContext *exec_ctx, const SeqScanPlanNode *plan)
+    : AbstractExecutor(exec_ctx), plan_(plan) {}
 
-void SeqScanExecutor::Init() {}
+void SeqScanExecutor::Init() {
+  table_info_ = exec_ctx_->GetCatalog()->GetTable(plan_->GetTableOid());
+  Transaction *txn = exec_ctx_->GetTransaction();
+  LockManager *lock_mgr = exec_ctx_->GetLockManager();
+  // A snapshot is read without locks. Rows read for increments are locked one by one, so that concurrent
+  // incrementers share the table.
+  if (lock_mgr != nullptr && txn->GetIsolationLevel() != IsolationLevel::READ_UNCOMMITTED && !txn->ReadsSnapshot()) {
+    LockMode lock_mode =
+        txn->GetIsolationLevel() == IsolationLevel::REPEATABLE_READ ? LockMode::SHARED : LockMode::INTENTION_SHARED;
+    if (row_lock_mode_ == LockMode::INCREMENT) {
+      lock_mode = LockMode::INTENTION_EXCLUSIVE;
+    }
+    if (!lock_mgr->LockTable(txn, lock_mode, table_info_->oid_)) {
+      throw TransactionAbortException(txn->GetTransactionId(), AbortReason::DEADLOCK);
+    }
+  }
+  iterator_.emplace(table_info_->table_->Begin(txn, row_lock_mode_));
+}
 
-bool SeqScanExecutor::Next(Tuple *tuple, RID *rid) { return false; }
+bool SeqScanExecutor::Next(Tuple *tuple, RID *rid) {
+  const Schema *schema = &table_info_->schema_;
+  const Schema *output_schema = GetOutputSchema();
+  for (; *iterator_ != table_info_->table_->End(); ++*iterator_) {
+    const Tuple &table_tuple = **iterator_;
+    bool matches =
+        plan_->GetPredicate() == nullptr || plan_->GetPredicate()->Evaluate(&table_tuple, schema).GetAs<bool>();
+    // The increment lock of a row that is returned is what the increment needs.
+    if (!matches || row_lock_mode_ == LockMode::SHARED) {
+      ReleaseReadLock(table_tuple.GetRid());
+    }
+    if (!matches) {
+      continue;
+    }
+    std::vector<Value> values;
+    values.reserve(output_schema->GetColumnCount());
+    for (const auto &column : output_schema->GetColumns()) {
+      values.push_back(column.GetExpr()->Evaluate(&table_tuple, schema));
+    }
+    *tuple = Tuple(values, output_schema);
+    *rid = table_tuple.GetRid();
+    ++*iterator_;
+    return true;
+  }
+  // The iterator ends early if a row lock could not be taken.
+  Transaction *txn = exec_ctx_->GetTransaction();
+  if (txn->GetState() == TransactionState::ABORTED) {
+    throw TransactionAbortException(txn->GetTransactionId(), AbortReason::DEADLOCK);
+  }
+  return false;
+}
+
+void SeqScanExecutor::ReleaseReadLock(const RID &rid) {
+  Transaction *txn = exec_ctx_->GetTransaction();
+  LockManager *lock_mgr = exec_ctx_->GetLockManager();
+  // Under READ_COMMITTED, a row is only locked while it is read. A row the transaction wrote or incremented stays
+  // locked.
+  if (lock_mgr == nullptr || txn->GetIsolationLevel() != IsolationLevel::READ_COMMITTED ||
+      txn->IsExclusiveLocked(rid)) {
+    return;
+  }
+  if (txn->IsSharedLocked(rid) || (txn->IsIncrementLocked(rid) && txn->GetDeltaSet()->count(rid) == 0)) {
+    lock_mgr->Unlock(txn, rid);
+  }
+}
 
 }  // namespace bustub
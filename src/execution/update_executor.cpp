@@ -9,19 +9,83 @@
 // Copyright (c) 2015-2021, Carnegie Mellon University Database Group
 //
 //===----------------------------------------------------------------------===//
+#include <algorithm>
 #include <memory>
+#include <utility>
 
+#include "execution/executors/seq_scan_executor.h"
 #include "execution/executors/update_executor.h"
 
 namespace bustub {
 
 UpdateExecutor::UpdateExecutor(ExecutorContext *exec_ctx, const UpdatePlanNode *plan,
                                std::unique_ptr<AbstractExecutor> &&child_executor)
-    : AbstractExecutor(exec_ctx) {}
+    : AbstractExecutor(exec_ctx), plan_(plan), child_executor_(std::move(child_executor)) {}
 
-void UpdateExecutor::Init() {}
+void UpdateExecutor::Init() {
+  Catalog *catalog = exec_ctx_->GetCatalog();
+  table_info_ = catalog->GetTable(plan_->TableOid());
 
-bool UpdateExecutor::Next([[maybe_unused]] Tuple *tuple, RID *rid) { return false; }
+  // An update that only adds to columns outside of the indexes commutes with other such updates, so it is applied as
+  // increments that concurrent transactions can hold at the same time. A snapshot or optimistic transaction validates
+  // what it read instead, it updates the tuple.
+  Transaction *txn = exec_ctx_->GetTransaction();
+  deltas_.clear();
+  bool increment = !txn->ReadsSnapshot() && !txn->IsOptimistic();
+  for (const auto &[col_idx, info] : plan_->GetUpdateAttr()) {
+    increment = increment && info.type_ == UpdateType::Add;
+    for (const IndexInfo *index_info : catalog->GetTableIndexes(table_info_->name_)) {
+      const auto &key_attrs = index_info->index_->GetKeyAttrs();
+      increment = increment && std::find(key_attrs.begin(), key_attrs.end(), col_idx) == key_attrs.end();
+    }
+    deltas_.emplace_back(col_idx, info.update_val_);
+  }
+  if (!increment) {
+    deltas_.clear();
+  }
+  // A sequential scan reads the rows under the increment locks. The shared lock of another child would turn the
+  // increment lock into an exclusive one.
+  auto *seq_scan = dynamic_cast<SeqScanExecutor *>(child_executor_.get());
+  if (seq_scan != nullptr && !deltas_.empty()) {
+    seq_scan->SetRowLockMode(LockMode::INCREMENT);
+  }
+  child_executor_->Init();
+}
+
+bool UpdateExecutor::Next([[maybe_unused]] Tuple *tuple, RID *rid) {
+  Transaction *txn = exec_ctx_->GetTransaction();
+  TableHeap *table = table_info_->table_.get();
+  const Schema &schema = table_info_->schema_;
+  Tuple child_tuple;
+  RID child_rid;
+  while (child_executor_->Next(&child_tuple, &child_rid)) {
+    if (!deltas_.empty()) {
+      table->IncrementTuple(child_rid, schema, deltas_, txn);
+      continue;
+    }
+    Tuple old_tuple;
+    if (!table->GetTuple(child_rid, &old_tuple, txn)) {
+      continue;
+    }
+    Tuple new_tuple = GenerateUpdatedTuple(old_tuple);
+    if (!table->UpdateTuple(new_tuple, child_rid, txn)) {
+      continue;
+    }
+    // An index built concurrently picks the update up from the heap unless it is published by now.
+    for (IndexInfo *index_info : exec_ctx_->GetCatalog()->GetTableIndexes(table_info_->name_)) {
+      Index *index = index_info->index_.get();
+      index->DeleteEntry(old_tuple.KeyFromTuple(schema, index_info->key_schema_, index->GetKeyAttrs()), child_rid,
+                         txn);
+      index->InsertEntry(new_tuple.KeyFromTuple(schema, index_info->key_schema_, index->GetKeyAttrs()), child_rid,
+                         txn);
+      IndexWriteRecord write_record(child_rid, table_info_->oid_, WType::UPDATE, new_tuple, index_info->index_oid_,
+                                    exec_ctx_->GetCatalog());
+      write_record.old_tuple_ = old_tuple;
+      txn->GetIndexWriteSet()->push_back(write_record);
+    }
+  }
+  return false;
+}
 
 Tuple UpdateExecutor::GenerateUpdatedTuple(const Tuple &src_tuple) {
   const auto &update_attrs = plan_->GetUpdateAttr();
@@ -15,6 +15,8 @@
 #include <list>
 #include <mutex>  // NOLINT
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "buffer/lru_replacer.h"
 #include "recovery/log_manager.h"
@@ -87,6 +89,13 @@ class BufferPoolManager {
   /** @return size of the buffer pool */
   virtual size_t GetPoolSize() = 0;
 
+  /**
+   * Build the dirty page table, i.e. every page that may be newer than its copy on disk, together with its recLSN.
+   * Pinned pages are included as well, since their users may not have reported them dirty yet.
+   * @return pairs of (page id, recLSN)
+   */
+  virtual std::vector<std::pair<page_id_t, lsn_t>> GetDirtyPageTable() = 0;
+
  protected:
   /**
    * Grading function. Do not modify!
@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <list>
 #include <mutex>  // NOLINT
 #include <unordered_map>
@@ -55,9 +56,18 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   /** @return size of the buffer pool */
   size_t GetPoolSize() override { return pool_size_; }
 
+  /** @return the dirty page table of this instance */
+  std::vector<std::pair<page_id_t, lsn_t>> GetDirtyPageTable() override;
+
   /** @return pointer to all the pages in the buffer pool */
   Page *GetPages() { return pages_; }
 
+  /** @return the number of evictions that had to force the log before writing back their victim */
+  size_t GetNumLogForces() { return num_log_forces_; }
+
+  /** @return the number of evictions that would have forced the log, but found a victim covered by the durable log */
+  size_t GetNumLogForcesAvoided() { return num_log_forces_avoided_; }
+
  protected:
   /**
    * Fetch the requested page from the buffer pool.
@@ -100,6 +110,37 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    */
   void FlushAllPgsImp() override;
 
+  /**
+   * Find a frame for a new page, from the free list or else from the replacer. With logging enabled, the replacer
+   * prefers victims whose changes are already in the durable log, since writing back any other dirty page has to wait
+   * for a log flush. If such pages are passed over, the log flusher is woken up so that they become cheap to evict.
+   * @param[out] frame_id the frame to use
+   * @return false if every frame is pinned
+   */
+  bool FindVictim(frame_id_t *frame_id);
+
+  /**
+   * Find a frame for a new page like FindVictim() and write the victim back if it is dirty.
+   * @param[out] frame_id the frame to use, it holds no page that has to be written back
+   * @return false if every frame is pinned
+   */
+  bool FindCleanVictim(frame_id_t *frame_id);
+
+  /**
+   * Write a dirty page back to disk, the caller holds latch_. If logging is enabled and the page LSN is not
+   * persistent yet, the log is forced first. latch_ is released while waiting for the log, so then the page is not
+   * written and the caller has to look at the frame again, it may hold a different page by now.
+   * @param page the page to be written
+   * @return true if the page was written, false if latch_ was released to wait for the log
+   */
+  bool WriteBackPage(Page *page);
+
+  /**
+   * Reset the recLSN of a page whose in-memory copy now matches the disk.
+   * @param page the clean page
+   */
+  void ResetRecLSN(Page *page);
+
   /**
    * Allocate a page on disk.∂
    * @return the id of the allocated page
@@ -135,7 +176,7 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   /** Pointer to the disk manager. */
   DiskManager *disk_manager_ __attribute__((__unused__));
   /** Pointer to the log manager. */
-  LogManager *log_manager_ __attribute__((__unused__));
+  LogManager *log_manager_;
   /** Page table for keeping track of buffer pool pages. */
   std::unordered_map<page_id_t, frame_id_t> page_table_;
   /** Replacer to find unpinned pages for replacement. */
@@ -144,5 +185,8 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   std::list<frame_id_t> free_list_;
   /** This latch protects shared data structures. We recommend updating this comment to describe what it protects. */
   std::mutex latch_;
+  /** Eviction statistics, see GetNumLogForces() and GetNumLogForcesAvoided(). */
+  std::atomic<size_t> num_log_forces_{0};
+  std::atomic<size_t> num_log_forces_avoided_{0};
 };
 }  // namespace bustub
@@ -40,6 +40,9 @@ class LRUReplacer : public Replacer {
 
   bool Victim(frame_id_t *frame_id) override;
 
+  /** Evict the least recently used frame that is preferred, or the least recently used frame if none is. */
+  bool VictimWithPreference(frame_id_t *frame_id, const std::function<bool(frame_id_t)> &prefer) override;
+
   void Pin(frame_id_t frame_id) override;
 
   void Unpin(frame_id_t frame_id) override;
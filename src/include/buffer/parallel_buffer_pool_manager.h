@@ -41,6 +41,9 @@ class ParallelBufferPoolManager : public BufferPoolManager {
   /** @return size of the buffer pool */
   size_t GetPoolSize() override;
 
+  /** @return the dirty page table of all instances */
+  std::vector<std::pair<page_id_t, lsn_t>> GetDirtyPageTable() override;
+
  protected:
   /**
    * @param page_id id of page
@@ -12,6 +12,8 @@
 
 #pragma once
 
+#include <functional>
+
 #include "common/config.h"
 
 namespace bustub {
@@ -31,6 +33,17 @@ class Replacer {
    */
   virtual bool Victim(frame_id_t *frame_id) = 0;
 
+  /**
+   * Remove a victim frame, preferring frames for which prefer returns true over the replacement policy's first choice.
+   * If no frame is preferred, this is the same as Victim(). Replacers without a notion of preference simply ignore it.
+   * @param[out] frame_id id of frame that was removed
+   * @param prefer predicate on frame ids, called with the candidates in the replacement policy's order
+   * @return true if a victim frame was found, false otherwise
+   */
+  virtual bool VictimWithPreference(frame_id_t *frame_id, const std::function<bool(frame_id_t)> &prefer) {
+    return Victim(frame_id);
+  }
+
   /**
    * Pins a frame, indicating that it should not be victimized until it is unpinned.
    * @param frame_id the id of the frame to pin
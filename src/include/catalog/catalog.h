@@ -12,15 +12,22 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
+#include <thread>  // NOLINT
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include "buffer/buffer_pool_manager.h"
 #include "catalog/schema.h"
 #include "container/hash/hash_function.h"
+#include "storage/index/b_plus_tree_index.h"
 #include "storage/index/extendible_hash_table_index.h"
 #include "storage/index/index.h"
 #include "storage/table/table_heap.h"
@@ -34,6 +41,14 @@ using table_oid_t = uint32_t;
 using column_oid_t = uint32_t;
 using index_oid_t = uint32_t;
 
+/** The kinds of index the catalog can create. The values are stored in the catalog table, only append new kinds. */
+enum class IndexType : int32_t {
+  /** An extendible hash table, for point lookups. */
+  HashTableIndex = 0,
+  /** A B+ tree keyed on (key, RID), so keys may repeat, for point lookups and ordered range scans. */
+  BPlusTreeIndex = 1,
+};
+
 /**
  * The TableInfo class maintains metadata about a table.
  */
@@ -69,15 +84,17 @@ struct IndexInfo {
    * @param index_oid The unique OID for the index
    * @param table_name The name of the table on which the index is created
    * @param key_size The size of the index key, in bytes
+   * @param index_type The kind of index
    */
   IndexInfo(Schema key_schema, std::string name, std::unique_ptr<Index> &&index, index_oid_t index_oid,
-            std::string table_name, size_t key_size)
+            std::string table_name, size_t key_size, IndexType index_type = IndexType::HashTableIndex)
       : key_schema_{std::move(key_schema)},
         name_{std::move(name)},
         index_{std::move(index)},
         index_oid_{index_oid},
         table_name_{std::move(table_name)},
-        key_size_{key_size} {}
+        key_size_{key_size},
+        index_type_{index_type} {}
   /** The schema for the index key */
   Schema key_schema_;
   /** The name of the index */
@@ -90,12 +107,28 @@ struct IndexInfo {
   std::string table_name_;
   /** The size of the index key, in bytes */
   const size_t key_size_;
+  /** The kind of index */
+  const IndexType index_type_;
 };
 
 /**
- * The Catalog is a non-persistent catalog that is designed for
- * use by executors within the DBMS execution engine. It handles
- * table creation, table lookup, index creation, and index lookup.
+ * The Catalog is designed for use by executors within the DBMS
+ * execution engine. It handles table creation, table lookup, index
+ * creation, and index lookup.
+ *
+ * The catalog is safe for concurrent use. Lookups do not take write_latch_: they read an immutable Snapshot of the
+ * lookup maps through an atomically loaded shared_ptr. Table and index creation is serialized by write_latch_; it
+ * copies the current snapshot, adds the new entry and publishes the copy. A replaced snapshot is freed as soon as the
+ * last lookup that still holds it is done. This costs a copy of the maps per creation, which is fine for DDL.
+ *
+ * By default the catalog is not persistent. After Bootstrap() or Open(), every table and index is also recorded as a
+ * row of the catalog table, an ordinary table heap that starts at the header page (HEADER_PAGE_ID). Its first row is a
+ * header that identifies the file and the format version. Rows are inserted by the creating transaction, so they are
+ * protected by the log like any other tuple. The pages of the catalog table are also written back on every DDL, since
+ * the catalog is opened before recovery runs.
+ *
+ * Index pages are not logged. After Close() they are on disk and consistent with their tables, and Open() reopens
+ * the indexes in place. Otherwise, e.g. after a crash, Open() rebuilds them.
  */
 class Catalog {
  public:
@@ -112,7 +145,32 @@ class Catalog {
    * @param log_manager The log manager in use by the system
    */
   Catalog(BufferPoolManager *bpm, LockManager *lock_manager, LogManager *log_manager)
-      : bpm_{bpm}, lock_manager_{lock_manager}, log_manager_{log_manager} {}
+      : bpm_{bpm}, lock_manager_{lock_manager}, log_manager_{log_manager} {
+    Publish(std::make_unique<Snapshot>());
+  }
+
+  /**
+   * Make the catalog persistent in a new, empty database by creating the catalog table, whose first page becomes the
+   * header page.
+   * @param txn The transaction in which the catalog table is created
+   */
+  void Bootstrap(Transaction *txn);
+
+  /**
+   * Reopen the persistent catalog of an existing database. The heaps of its tables are opened where they are on disk.
+   * If the database was closed with Close(), so are the indexes. Otherwise their pages may be stale, and every index
+   * is rebuilt from its table in new pages.
+   * @param txn The transaction in which the catalog table is read and the index rows are updated
+   * @throws Exception if page 0 does not hold a catalog header of the supported version
+   */
+  void Open(Transaction *txn);
+
+  /**
+   * Shut the persistent catalog down cleanly: write back every page and record in the header that the indexes on disk
+   * are up to date. The caller makes sure that nobody writes to the database anymore.
+   * @param txn The transaction in which the header is updated
+   */
+  void Close(Transaction *txn);
 
   /**
    * Create a new table and return its metadata.
@@ -122,7 +180,8 @@ class Catalog {
    * @return A (non-owning) pointer to the metadata for the table
    */
   TableInfo *CreateTable(Transaction *txn, const std::string &table_name, const Schema &schema) {
-    if (table_names_.count(table_name) != 0) {
+    std::scoped_lock lock(write_latch_);
+    if (GetSnapshot()->table_names_.count(table_name) != 0) {
       return NULL_TABLE_INFO;
     }
 
@@ -131,15 +190,23 @@ class Catalog {
 
     // Fetch the table OID for the new table
     const auto table_oid = next_table_oid_.fetch_add(1);
+    table->SetTableOid(table_oid);
 
     // Construct the table information
     auto meta = std::make_unique<TableInfo>(schema, table_name, std::move(table), table_oid);
     auto *tmp = meta.get();
 
+    if (catalog_table_ != nullptr) {
+      PersistTable(txn, tmp);
+    }
+
     // Update the internal tracking mechanisms
     tables_.emplace(table_oid, std::move(meta));
-    table_names_.emplace(table_name, table_oid);
-    index_names_.emplace(table_name, std::unordered_map<std::string, index_oid_t>{});
+    auto snapshot = std::make_unique<Snapshot>(*GetSnapshot());
+    snapshot->tables_.emplace(table_oid, tmp);
+    snapshot->table_names_.emplace(table_name, table_oid);
+    snapshot->index_names_.emplace(table_name, std::unordered_map<std::string, index_oid_t>{});
+    Publish(std::move(snapshot));
 
     return tmp;
   }
@@ -150,16 +217,17 @@ class Catalog {
    * @return A (non-owning) pointer to the metadata for the table
    */
   TableInfo *GetTable(const std::string &table_name) {
-    auto table_oid = table_names_.find(table_name);
-    if (table_oid == table_names_.end()) {
+    auto snapshot = GetSnapshot();
+    auto table_oid = snapshot->table_names_.find(table_name);
+    if (table_oid == snapshot->table_names_.end()) {
       // Table not found
       return NULL_TABLE_INFO;
     }
 
-    auto meta = tables_.find(table_oid->second);
-    BUSTUB_ASSERT(meta != tables_.end(), "Broken Invariant");
+    auto meta = snapshot->tables_.find(table_oid->second);
+    BUSTUB_ASSERT(meta != snapshot->tables_.end(), "Broken Invariant");
 
-    return (meta->second).get();
+    return meta->second;
   }
 
   /**
@@ -168,16 +236,30 @@ class Catalog {
    * @return A (non-owning) pointer to the metadata for the table
    */
   TableInfo *GetTable(table_oid_t table_oid) {
-    auto meta = tables_.find(table_oid);
-    if (meta == tables_.end()) {
+    auto snapshot = GetSnapshot();
+    auto meta = snapshot->tables_.find(table_oid);
+    if (meta == snapshot->tables_.end()) {
       return NULL_TABLE_INFO;
     }
 
-    return (meta->second).get();
+    return meta->second;
   }
 
+  /**
+   * Set the number of threads that populate a new index, see PopulateIndex().
+   * @param num_threads the number of threads, at least 1
+   */
+  void SetIndexBuildThreads(size_t num_threads) { index_build_threads_ = std::max<size_t>(num_threads, 1); }
+
   /**
    * Create a new index, populate existing data of the table and return its metadata.
+   *
+   * The index is built online, writers to the table are not blocked. Writers are expected to maintain the indexes
+   * that GetTableIndexes() returns after they changed the heap, changes before the index shows up there are applied
+   * from the heap's TableChangeLog. Transactions that had written the table when the index was published do not undo
+   * their earlier changes in it when they abort, so this returns only once they have finished. It waits without
+   * write_latch_, so they may run DDL meanwhile, but they might wait for a lock of the creating transaction, which
+   * must not hold any lock on table data. Only one index of a table is built at a time.
    * @param txn The transaction in which the table is being created
    * @param index_name The name of the new index
    * @param table_name The name of the table
@@ -185,57 +267,95 @@ class Catalog {
    * @param key_schema The schema of the key
    * @param key_attrs Key attributes
    * @param keysize Size of the key
-   * @param hash_function The hash function for the index
-   * @return A (non-owning) pointer to the metadata of the new table
+   * @param hash_function The hash function for the index, unused by other kinds of index
+   * @param index_type The kind of index to create
+   * @return A (non-owning) pointer to the metadata of the new index, NULL_INDEX_INFO if it exists already, the table
+   * does not, txn holds locks on table data or another index of the table is being built
    */
   template <class KeyType, class ValueType, class KeyComparator>
   IndexInfo *CreateIndex(Transaction *txn, const std::string &index_name, const std::string &table_name,
                          const Schema &schema, const Schema &key_schema, const std::vector<uint32_t> &key_attrs,
-                         std::size_t keysize, HashFunction<KeyType> hash_function) {
+                         std::size_t keysize, HashFunction<KeyType> hash_function,
+                         IndexType index_type = IndexType::HashTableIndex) {
+    std::unique_lock lock(write_latch_);
+    auto current = GetSnapshot();
+
     // Reject the creation request for nonexistent table
-    if (table_names_.find(table_name) == table_names_.end()) {
+    if (current->table_names_.find(table_name) == current->table_names_.end()) {
       return NULL_INDEX_INFO;
     }
 
     // If the table exists, an entry for the table should already be present in index_names_
-    BUSTUB_ASSERT((index_names_.find(table_name) != index_names_.end()), "Broken Invariant");
+    BUSTUB_ASSERT((current->index_names_.find(table_name) != current->index_names_.end()), "Broken Invariant");
 
     // Determine if the requested index already exists for this table
-    auto &table_indexes = index_names_.find(table_name)->second;
+    const auto &table_indexes = current->index_names_.find(table_name)->second;
     if (table_indexes.find(index_name) != table_indexes.end()) {
       // The requested index already exists for this table
       return NULL_INDEX_INFO;
     }
 
+    // The build waits for the table's writers, which may wait for the locks of txn.
+    if (HoldsDataLocks(txn)) {
+      return NULL_INDEX_INFO;
+    }
+    auto *table_meta = GetTable(table_name);
+    TableChangeLog *change_log = table_meta->table_->GetChangeLog();
+    if (!change_log->Start()) {
+      return NULL_INDEX_INFO;
+    }
+
     // Construct index metdata
     auto meta = std::make_unique<IndexMetadata>(index_name, table_name, &schema, key_attrs);
 
-    // Construct the index, take ownership of metadata
-    // TODO(Kyle): We should update the API for CreateIndex
-    // to allow specification of the index type itself, not
-    // just the key, value, and comparator types
-    auto index = std::make_unique<ExtendibleHashTableIndex<KeyType, ValueType, KeyComparator>>(std::move(meta), bpm_,
-                                                                                               hash_function);
-
-    // Populate the index with all tuples in table heap
-    auto *table_meta = GetTable(table_name);
-    auto *heap = table_meta->table_.get();
-    for (auto tuple = heap->Begin(txn); tuple != heap->End(); ++tuple) {
-      index->InsertEntry(tuple->KeyFromTuple(schema, key_schema, key_attrs), tuple->GetRid(), txn);
+    // Construct the index, take ownership of metadata. The page that identifies the index on disk is recorded in
+    // the catalog table.
+    std::unique_ptr<Index> index;
+    page_id_t index_page_id;
+    if (index_type == IndexType::BPlusTreeIndex) {
+      auto tree = std::make_unique<BPlusTreeIndex<KeyType, ValueType, KeyComparator>>(std::move(meta), bpm_);
+      index_page_id = tree->GetHeaderPageId();
+      index = std::move(tree);
+    } else {
+      auto hash_table = std::make_unique<ExtendibleHashTableIndex<KeyType, ValueType, KeyComparator>>(
+          std::move(meta), bpm_, hash_function);
+      index_page_id = hash_table->GetDirectoryPageId();
+      index = std::move(hash_table);
     }
 
+    // Populate the index with all tuples in table heap. Writers are not blocked, their changes are recorded in the
+    // heap's change log until the transactions that had written the table at publish time have finished.
+    BuildIndex(txn, index.get(), table_meta->table_.get(), schema, key_schema, key_attrs);
+
     // Get the next OID for the new index
     const auto index_oid = next_index_oid_.fetch_add(1);
 
     // Construct index information; IndexInfo takes ownership of the Index itself
-    auto index_info =
-        std::make_unique<IndexInfo>(key_schema, index_name, std::move(index), index_oid, table_name, keysize);
+    auto index_info = std::make_unique<IndexInfo>(key_schema, index_name, std::move(index), index_oid, table_name,
+                                                  keysize, index_type);
     auto *tmp = index_info.get();
 
+    // Writers pause while the last changes are applied, once the index is published new writers maintain it
+    // themselves.
+    change_log->Lock();
+    ApplyChanges(txn, tmp->index_.get(), change_log->TakeChangesLocked(), schema, key_schema, key_attrs);
+
     // Update internal tracking
     indexes_.emplace(index_oid, std::move(index_info));
-    table_indexes.emplace(index_name, index_oid);
+    auto snapshot = std::make_unique<Snapshot>(*current);
+    snapshot->indexes_.emplace(index_oid, tmp);
+    snapshot->index_names_[table_name].emplace(index_name, index_oid);
+    Publish(std::move(snapshot));
+    std::unordered_set<txn_id_t> writers = table_meta->table_->GetVersionStore()->GetUncommittedWriters();
+    writers.insert(change_log->GetWritersLocked().begin(), change_log->GetWritersLocked().end());
+    change_log->Unlock();
+
+    if (catalog_table_ != nullptr) {
+      PersistIndex(txn, tmp, sizeof(KeyType), index_page_id);
+    }
 
+    lock.unlock();
+    FinishBuild(txn, tmp->index_.get(), table_meta->table_.get(), writers, schema, key_schema, key_attrs);
     return tmp;
   }
 
@@ -246,9 +366,10 @@ class Catalog {
    * @return A (non-owning) pointer to the metadata for the index
    */
   IndexInfo *GetIndex(const std::string &index_name, const std::string &table_name) {
-    auto table = index_names_.find(table_name);
-    if (table == index_names_.end()) {
-      BUSTUB_ASSERT((table_names_.find(table_name) == table_names_.end()), "Broken Invariant");
+    auto snapshot = GetSnapshot();
+    auto table = snapshot->index_names_.find(table_name);
+    if (table == snapshot->index_names_.end()) {
+      BUSTUB_ASSERT((snapshot->table_names_.find(table_name) == snapshot->table_names_.end()), "Broken Invariant");
       return NULL_INDEX_INFO;
     }
 
@@ -259,10 +380,10 @@ class Catalog {
       return NULL_INDEX_INFO;
     }
 
-    auto index = indexes_.find(index_meta->second);
-    BUSTUB_ASSERT((index != indexes_.end()), "Broken Invariant");
+    auto index = snapshot->indexes_.find(index_meta->second);
+    BUSTUB_ASSERT((index != snapshot->indexes_.end()), "Broken Invariant");
 
-    return index->second.get();
+    return index->second;
   }
 
   /**
@@ -273,13 +394,13 @@ class Catalog {
    */
   IndexInfo *GetIndex(const std::string &index_name, const table_oid_t table_oid) {
     // Locate the table metadata for the specified table OID
-    auto table_meta = tables_.find(table_oid);
-    if (table_meta == tables_.end()) {
+    auto *table_meta = GetTable(table_oid);
+    if (table_meta == NULL_TABLE_INFO) {
       // Table not found
       return NULL_INDEX_INFO;
     }
 
-    return GetIndex(index_name, table_meta->second->name_);
+    return GetIndex(index_name, table_meta->name_);
   }
 
   /**
@@ -288,12 +409,13 @@ class Catalog {
    * @return A (non-owning) pointer to the metadata for the index
    */
   IndexInfo *GetIndex(index_oid_t index_oid) {
-    auto index = indexes_.find(index_oid);
-    if (index == indexes_.end()) {
+    auto snapshot = GetSnapshot();
+    auto index = snapshot->indexes_.find(index_oid);
+    if (index == snapshot->indexes_.end()) {
       return NULL_INDEX_INFO;
     }
 
-    return index->second.get();
+    return index->second;
   }
 
   /**
@@ -303,26 +425,129 @@ class Catalog {
    * in the event that the table exists but no indexes have been created for it
    */
   std::vector<IndexInfo *> GetTableIndexes(const std::string &table_name) {
+    auto snapshot = GetSnapshot();
     // Ensure the table exists
-    if (table_names_.find(table_name) == table_names_.end()) {
+    if (snapshot->table_names_.find(table_name) == snapshot->table_names_.end()) {
       return std::vector<IndexInfo *>{};
     }
 
-    auto table_indexes = index_names_.find(table_name);
-    BUSTUB_ASSERT((table_indexes != index_names_.end()), "Broken Invariant");
+    auto table_indexes = snapshot->index_names_.find(table_name);
+    BUSTUB_ASSERT((table_indexes != snapshot->index_names_.end()), "Broken Invariant");
 
     std::vector<IndexInfo *> indexes{};
     indexes.reserve(table_indexes->second.size());
     for (const auto &index_meta : table_indexes->second) {
-      auto index = indexes_.find(index_meta.second);
-      BUSTUB_ASSERT((index != indexes_.end()), "Broken Invariant");
-      indexes.push_back(index->second.get());
+      auto index = snapshot->indexes_.find(index_meta.second);
+      BUSTUB_ASSERT((index != snapshot->indexes_.end()), "Broken Invariant");
+      indexes.push_back(index->second);
     }
 
     return indexes;
   }
 
  private:
+  /** The lookup maps, never modified once published. */
+  struct Snapshot {
+    /** Map table identifier -> table metadata. */
+    std::unordered_map<table_oid_t, TableInfo *> tables_;
+    /** Map table name -> table identifiers. */
+    std::unordered_map<std::string, table_oid_t> table_names_;
+    /** Map index identifier -> index metadata. */
+    std::unordered_map<index_oid_t, IndexInfo *> indexes_;
+    /** Map table name -> index names -> index identifiers. */
+    std::unordered_map<std::string, std::unordered_map<std::string, index_oid_t>> index_names_;
+  };
+
+  /** @return the current snapshot of the lookup maps, which stays alive as long as the caller holds it */
+  std::shared_ptr<const Snapshot> GetSnapshot() const { return std::atomic_load(&snapshot_); }
+
+  /** Make snapshot the current one, the caller holds write_latch_ (or is the constructor). */
+  void Publish(std::unique_ptr<Snapshot> snapshot) {
+    std::atomic_store(&snapshot_, std::shared_ptr<const Snapshot>(std::move(snapshot)));
+  }
+
+  /**
+   * Insert the key of every tuple of heap into index. The heap's pages are handed out to index_build_threads_
+   * workers, each worker extracts the keys of a page under its read latch and inserts them once the page is released.
+   * Tuples are read without row locks, the index has to support concurrent inserts.
+   */
+  void PopulateIndex(Transaction *txn, Index *index, TableHeap *heap, const Schema &schema, const Schema &key_schema,
+                     const std::vector<uint32_t> &key_attrs);
+
+  /**
+   * Build index online, with the heap's change log started: populate the index and apply the changes recorded
+   * meanwhile until only a few are left, which the caller applies with the change log locked before publishing the
+   * index.
+   */
+  void BuildIndex(Transaction *txn, Index *index, TableHeap *heap, const Schema &schema, const Schema &key_schema,
+                  const std::vector<uint32_t> &key_attrs);
+
+  /**
+   * Keep applying the changes of a published index's build until the writers, the transactions that had written the
+   * heap at publish time, have finished, then stop the change log. They may have changed the heap before they saw the
+   * index, and a rollback of such a change only reaches the index through the change log. Called without write_latch_.
+   */
+  void FinishBuild(Transaction *txn, Index *index, TableHeap *heap, const std::unordered_set<txn_id_t> &writers,
+                   const Schema &schema, const Schema &key_schema, const std::vector<uint32_t> &key_attrs);
+
+  /** @return true if txn holds table, page or row locks on the data of a table, not counting the catalog table */
+  static bool HoldsDataLocks(Transaction *txn);
+
+  /** Apply changes recorded in a table's change log to index. */
+  void ApplyChanges(Transaction *txn, Index *index, const std::vector<TableChangeLog::Change> &changes,
+                    const Schema &schema, const Schema &key_schema, const std::vector<uint32_t> &key_attrs);
+
+  /** BuildIndex() stops catching up once at most this many changes are left, or after MAX_CATCH_UP_ROUNDS rounds. */
+  static constexpr size_t CATCH_UP_CHANGES = 64;
+  static constexpr int MAX_CATCH_UP_ROUNDS = 8;
+  /** How long FinishBuild() sleeps between catch-up rounds while it waits for running transactions. */
+  static constexpr std::chrono::milliseconds FINISH_BUILD_INTERVAL{1};
+
+  /** Row kinds of the catalog table */
+  static constexpr int32_t CATALOG_TABLE_ROW = 0;
+  static constexpr int32_t CATALOG_INDEX_ROW = 1;
+  /**
+   * The header row keeps the magic number in `oid`, the format version in `key_size` and in `key_type_size` whether
+   * the pages on disk are those of a clean shutdown (1) or of a running database (0).
+   */
+  static constexpr int32_t CATALOG_HEADER_ROW = 2;
+  static constexpr int32_t CATALOG_MAGIC = 0x42757354;
+  static constexpr int32_t CATALOG_VERSION = 1;
+
+  /** @return the schema of the catalog table */
+  static const Schema &CatalogSchema();
+
+  /** Record a new table in the catalog table and make it durable. */
+  void PersistTable(Transaction *txn, TableInfo *table_info);
+
+  /** Write back the pages of the catalog table, so that reopening does not depend on redo. */
+  void FlushCatalogTable();
+
+  /**
+   * Record a new index in the catalog table and make it durable.
+   * @param key_type_size The size of the index's GenericKey type, which selects the template instance on reopen
+   * @param index_page_id The page that identifies the index on disk: the directory page of a hash table or the
+   * header page of a B+ tree
+   */
+  void PersistIndex(Transaction *txn, IndexInfo *index_info, size_t key_type_size, page_id_t index_page_id);
+
+  /**
+   * Throw unless the header row of the catalog table identifies a catalog of the supported version.
+   * @return true if the database was shut down cleanly
+   */
+  bool CheckHeader();
+
+  /** Record in the header row whether the pages on disk are those of a clean shutdown, and write the header back. */
+  void SetCleanShutdown(Transaction *txn, bool clean);
+
+  /**
+   * Create or open an index of the given kind, instantiated for the given key type size.
+   * @param[in,out] index_page_id The page that identifies an existing index on disk to open, or INVALID_PAGE_ID to
+   * create an empty index; the page of the index on output
+   */
+  std::unique_ptr<Index> NewIndex(std::unique_ptr<IndexMetadata> &&metadata, IndexType index_type, size_t key_type_size,
+                                  page_id_t *index_page_id);
+
   [[maybe_unused]] BufferPoolManager *bpm_;
   [[maybe_unused]] LockManager *lock_manager_;
   [[maybe_unused]] LogManager *log_manager_;
@@ -334,9 +559,6 @@ class Catalog {
    */
   std::unordered_map<table_oid_t, std::unique_ptr<TableInfo>> tables_;
 
-  /** Map table name -> table identifiers. */
-  std::unordered_map<std::string, table_oid_t> table_names_;
-
   /** The next table identifier to be used. */
   std::atomic<table_oid_t> next_table_oid_{0};
 
@@ -347,11 +569,19 @@ class Catalog {
    */
   std::unordered_map<index_oid_t, std::unique_ptr<IndexInfo>> indexes_;
 
-  /** Map table name -> index names -> index identifiers. */
-  std::unordered_map<std::string, std::unordered_map<std::string, index_oid_t>> index_names_;
-
   /** The next index identifier to be used. */
   std::atomic<index_oid_t> next_index_oid_{0};
+
+  /** The table that records the tables and indexes, nullptr if the catalog is not persistent. */
+  std::unique_ptr<TableHeap> catalog_table_;
+
+  /** The number of threads that populate a new index. */
+  std::atomic<size_t> index_build_threads_{std::max<size_t>(std::thread::hardware_concurrency(), 1)};
+
+  /** Serializes table and index creation. */
+  std::mutex write_latch_;
+  /** The snapshot that lookups use, only accessed through std::atomic_load() and std::atomic_store(). */
+  std::shared_ptr<const Snapshot> snapshot_;
 };
 
 }  // namespace bustub
@@ -13,6 +13,7 @@
 #include <string>
 
 #include "buffer/buffer_pool_manager_instance.h"
+#include "catalog/catalog.h"
 #include "common/config.h"
 #include "concurrency/lock_manager.h"
 #include "recovery/checkpoint_manager.h"
@@ -37,15 +38,41 @@ class BustubInstance {
     // txn related
     lock_manager_ = new LockManager();
     transaction_manager_ = new TransactionManager(lock_manager_, log_manager_);
+    transaction_manager_->StartGarbageCollection();
 
     // checkpoints
-    checkpoint_manager_ = new CheckpointManager(transaction_manager_, log_manager_, buffer_pool_manager_);
+    checkpoint_manager_ =
+        new CheckpointManager(transaction_manager_, log_manager_, buffer_pool_manager_, disk_manager_);
+
+    // catalog, reopened from the database file unless the database is new
+    catalog_ = new Catalog(buffer_pool_manager_, lock_manager_, log_manager_);
+    Transaction *txn = transaction_manager_->Begin();
+    if (disk_manager_->GetNumPages() == 0) {
+      catalog_->Bootstrap(txn);
+    } else {
+      catalog_->Open(txn);
+    }
+    transaction_manager_->Commit(txn);
+    delete txn;
+  }
+
+  /**
+   * Shut the database down cleanly, so that the next instance reopens the indexes in place instead of rebuilding them.
+   * Deleting the instance without calling Shutdown() leaves the database file as after a crash.
+   */
+  void Shutdown() {
+    Transaction *txn = transaction_manager_->Begin();
+    catalog_->Close(txn);
+    transaction_manager_->Commit(txn);
+    delete txn;
   }
 
   ~BustubInstance() {
     if (enable_logging) {
       log_manager_->StopFlushThread();
     }
+    transaction_manager_->StopGarbageCollection();
+    delete catalog_;
     delete checkpoint_manager_;
     delete log_manager_;
     delete buffer_pool_manager_;
@@ -60,6 +87,7 @@ class BustubInstance {
   TransactionManager *transaction_manager_;
   LogManager *log_manager_;
   CheckpointManager *checkpoint_manager_;
+  Catalog *catalog_;
 };
 
 }  // namespace bustub
@@ -27,6 +27,18 @@ extern std::atomic<bool> enable_logging;
 /** If ENABLE_LOGGING is true, the log should be flushed to disk every LOG_TIMEOUT. */
 extern std::chrono::duration<int64_t> log_timeout;
 
+/** An asynchronously committed transaction's COMMIT record is flushed to disk at most ASYNC_COMMIT_WINDOW later. */
+extern std::chrono::milliseconds async_commit_window;
+
+/**
+ * True if a new log is written in the compact encoding (varint fields, updates as byte-range diffs), false for the
+ * fixed-size encoding. The log's control file records the encoding, so an existing log keeps its own.
+ */
+extern std::atomic<bool> enable_compact_log;
+
+/** The version garbage collector prunes the versions no snapshot can see anymore every VERSION_GC_INTERVAL. */
+extern std::chrono::milliseconds version_gc_interval;
+
 static constexpr int INVALID_PAGE_ID = -1;                                    // invalid page id
 static constexpr int INVALID_TXN_ID = -1;                                     // invalid transaction id
 static constexpr int INVALID_LSN = -1;                                        // invalid log sequence number
@@ -34,6 +46,7 @@ static constexpr int HEADER_PAGE_ID = 0;                                      //
 static constexpr int PAGE_SIZE = 4096;                                        // size of a data page in byte
 static constexpr int BUFFER_POOL_SIZE = 10;                                   // size of buffer pool
 static constexpr int LOG_BUFFER_SIZE = ((BUFFER_POOL_SIZE + 1) * PAGE_SIZE);  // size of a log buffer in byte
+static constexpr int LOG_SEGMENT_SIZE = 16 * LOG_BUFFER_SIZE;                 // size of a log segment file in byte
 static constexpr int BUCKET_SIZE = 50;                                        // size of extendible hash bucket
 
 using frame_id_t = int32_t;    // frame id type
@@ -41,6 +54,7 @@ using page_id_t = int32_t;     // page id type
 using txn_id_t = int32_t;      // transaction id type
 using lsn_t = int32_t;         // log sequence number type
 using slot_offset_t = size_t;  // slot offset type
+using timestamp_t = uint64_t;  // commit timestamp type
 using oid_t = uint16_t;
 
 }  // namespace bustub
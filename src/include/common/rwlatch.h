@@ -12,9 +12,12 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <climits>
 #include <condition_variable>  // NOLINT
-#include <mutex>               // NOLINT
+#include <cstdint>
+#include <mutex>  // NOLINT
 
 #include "common/macros.h"
 
@@ -93,4 +96,99 @@ class ReaderWriterLatch {
   bool writer_entered_{false};
 };
 
+/**
+ * Reader-Writer latch for many readers and rare writers, such as the global transaction latch that every transaction
+ * takes in read mode and checkpoints take in write mode.
+ *
+ * A reader only increments the counter of its thread's reader slot and checks that no writer entered, so readers on
+ * different cores do not share a cache line. A writer announces itself and waits until the slots sum up to zero. A
+ * reader may release the latch on another thread than the one that acquired it, the sum stays right.
+ */
+class ScalableReaderWriterLatch {
+  static constexpr size_t READER_SLOTS = 64;
+
+ public:
+  ScalableReaderWriterLatch() = default;
+  ~ScalableReaderWriterLatch() { std::lock_guard<std::mutex> guard(mutex_); }
+
+  DISALLOW_COPY(ScalableReaderWriterLatch);
+
+  /**
+   * Acquire a write latch.
+   */
+  void WLock() {
+    std::unique_lock<std::mutex> latch(mutex_);
+    reader_.wait(latch, [&] { return !writer_entered_; });
+    writer_entered_ = true;
+    writer_.wait(latch, [&] { return GetReaderCount() == 0; });
+  }
+
+  /**
+   * Release a write latch.
+   */
+  void WUnlock() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    writer_entered_ = false;
+    reader_.notify_all();
+  }
+
+  /**
+   * Acquire a read latch.
+   */
+  void RLock() {
+    std::atomic<int64_t> &count = slots_[GetSlot()].count_;
+    while (true) {
+      // Both sides access the counters and the flag sequentially consistent, so either the writer sees the reader,
+      // or the reader sees the writer.
+      count++;
+      if (!writer_entered_) {
+        return;
+      }
+      count--;
+      std::unique_lock<std::mutex> latch(mutex_);
+      writer_.notify_one();
+      reader_.wait(latch, [&] { return !writer_entered_; });
+    }
+  }
+
+  /**
+   * Release a read latch.
+   */
+  void RUnlock() {
+    slots_[GetSlot()].count_--;
+    if (writer_entered_) {
+      std::lock_guard<std::mutex> guard(mutex_);
+      writer_.notify_one();
+    }
+  }
+
+ private:
+  /** A reader slot, on its own cache line. */
+  struct alignas(64) ReaderSlot {
+    std::atomic<int64_t> count_{0};
+  };
+
+  /** @return the reader slot of the calling thread */
+  static size_t GetSlot() {
+    static std::atomic<size_t> next_slot{0};
+    thread_local size_t slot = next_slot++ % READER_SLOTS;
+    return slot;
+  }
+
+  /** @return the number of readers that hold the latch, or are about to check for a writer */
+  int64_t GetReaderCount() const {
+    int64_t reader_count = 0;
+    for (const ReaderSlot &slot : slots_) {
+      reader_count += slot.count_;
+    }
+    return reader_count;
+  }
+
+  std::array<ReaderSlot, READER_SLOTS> slots_;
+  std::atomic<bool> writer_entered_{false};
+  std::mutex mutex_;
+  std::condition_variable writer_;
+  std::condition_variable reader_;
+};
+
 }  // namespace bustub
@@ -0,0 +1,91 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// varint_util.h
+//
+// Identification: src/include/common/util/varint_util.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstdint>
+
+namespace bustub {
+
+/**
+ * VarintUtil encodes 32 bit integers in 1 to 5 bytes, 7 bits per byte with the high bit set on all but the last byte.
+ * Signed values are zigzag encoded first, so that small negative numbers (e.g. INVALID_LSN) stay small as well.
+ */
+class VarintUtil {
+ public:
+  /** Maximum number of bytes of an encoded value. */
+  static constexpr int MAX_SIZE = 5;
+
+  /** @return the number of bytes needed to encode value */
+  static inline int Size(uint32_t value) {
+    int size = 1;
+    while (value >= 0x80) {
+      value >>= 7;
+      size++;
+    }
+    return size;
+  }
+
+  static inline int SignedSize(int32_t value) { return Size(ZigZag(value)); }
+
+  /**
+   * Encode value at pos.
+   * @return the position right after the encoded value
+   */
+  static inline char *Encode(uint32_t value, char *pos) {
+    while (value >= 0x80) {
+      *pos++ = static_cast<char>(value | 0x80);
+      value >>= 7;
+    }
+    *pos++ = static_cast<char>(value);
+    return pos;
+  }
+
+  static inline char *EncodeSigned(int32_t value, char *pos) { return Encode(ZigZag(value), pos); }
+
+  /**
+   * Decode a value starting at pos without reading at or beyond end.
+   * @return the position right after the decoded value, nullptr if the value is truncated or malformed
+   */
+  static inline const char *Decode(const char *pos, const char *end, uint32_t *value) {
+    uint32_t result = 0;
+    for (int shift = 0; shift < 7 * MAX_SIZE && pos < end; shift += 7) {
+      auto byte = static_cast<uint8_t>(*pos++);
+      result |= static_cast<uint32_t>(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0) {
+        *value = result;
+        return pos;
+      }
+    }
+    return nullptr;
+  }
+
+  static inline const char *DecodeSigned(const char *pos, const char *end, int32_t *value) {
+    uint32_t zigzag;
+    pos = Decode(pos, end, &zigzag);
+    if (pos != nullptr) {
+      *value = UnZigZag(zigzag);
+    }
+    return pos;
+  }
+
+ private:
+  static inline uint32_t ZigZag(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+  }
+
+  static inline int32_t UnZigZag(uint32_t value) {
+    return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+  }
+};
+
+}  // namespace bustub
@@ -13,15 +13,21 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>  // NOLINT
 #include <condition_variable>  // NOLINT
-#include <list>
+#include <map>
 #include <memory>
 #include <mutex>  // NOLINT
+#include <optional>
+#include <thread>  // NOLINT
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "common/config.h"
+#include "common/macros.h"
 #include "common/rid.h"
 #include "concurrency/transaction.h"
 
@@ -31,35 +37,124 @@ class TransactionManager;
 
 /**
  * LockManager handles transactions asking for locks on records.
+ *
+ * Locks are multi-granularity: besides rows, a transaction can lock a whole table or page in SHARED or EXCLUSIVE
+ * mode, or with the intention to lock rows below it (INTENTION_SHARED, INTENTION_EXCLUSIVE, or both
+ * SHARED_INTENTION_EXCLUSIVE). A scan then takes a single table lock instead of one lock per row. The table heap
+ * takes the intention lock on its table before it locks a row, and skips the row locks that a table or page lock of
+ * the transaction already covers.
+ *
+ * A row can also be locked in INCREMENT mode to add to its integer columns. Increments commute, so INCREMENT locks
+ * are compatible with each other and any number of transactions can increment a hot row at the same time, see
+ * TableHeap::IncrementTuple(). They conflict with all the other modes, and a transaction that reads or writes a row it
+ * increments upgrades its lock to EXCLUSIVE.
+ *
+ * When a transaction holds more row locks on one table than the escalation threshold, they are escalated: the
+ * transaction locks the whole table instead and the row locks are dropped, which bounds the lock table's memory.
+ *
+ * The lock table is split into LOCK_TABLE_PARTITIONS partitions by the hash of the locked object, each with its own
+ * latch, so transactions locking different objects rarely contend on a latch. Transactions wait on the condition
+ * variable of the object's queue.
+ *
+ * Deadlocks are either prevented with wound-wait (PREVENTION): an older transaction aborts (wounds) the younger ones
+ * that are in its way, a younger transaction waits for the older ones. Or they are detected (DETECTION): the lock
+ * manager keeps a wait-for graph of the waiting transactions up to date as requests block, are granted and are
+ * released, and a background thread looks for cycles in it every cycle_detection_interval and aborts the youngest
+ * transaction of each cycle.
  */
 class LockManager {
-  enum class LockMode { SHARED, EXCLUSIVE };
+  enum class Granularity : uint8_t { TABLE, PAGE, ROW };
+
+  /** A lockable object, its id is the table oid, the page id or the RID. */
+  struct LockTarget {
+    Granularity granularity_;
+    int64_t id_;
+
+    bool operator==(const LockTarget &other) const {
+      return granularity_ == other.granularity_ && id_ == other.id_;
+    }
+  };
+
+  struct LockTargetHash {
+    size_t operator()(const LockTarget &target) const;
+  };
 
   class LockRequest {
    public:
-    LockRequest(txn_id_t txn_id, LockMode lock_mode) : txn_id_(txn_id), lock_mode_(lock_mode), granted_(false) {}
-
-    txn_id_t txn_id_;
-    LockMode lock_mode_;
-    bool granted_;
+    txn_id_t txn_id_{INVALID_TXN_ID};
+    LockMode lock_mode_{LockMode::SHARED};
+    bool granted_{false};
+    /** Neighbours in the queue, or the next free request in the pool. */
+    LockRequest *prev_{nullptr};
+    LockRequest *next_{nullptr};
   };
 
+  /** The requests for a single object, in arrival order, as an intrusive list of pooled requests. */
   class LockRequestQueue {
    public:
-    std::list<LockRequest> request_queue_;
+    void Append(LockRequest *request);
+    void Remove(LockRequest *request);
+    /** @return the request of the transaction, or nullptr */
+    LockRequest *Find(txn_id_t txn_id) const;
+    inline bool IsEmpty() const { return head_ == nullptr; }
+
+    LockRequest *head_{nullptr};
+    LockRequest *tail_{nullptr};
     // for notifying blocked transactions on this rid
     std::condition_variable cv_;
     // txn_id of an upgrading transaction (if any)
     txn_id_t upgrading_ = INVALID_TXN_ID;
   };
 
+  /**
+   * LockRequestPool hands out lock requests from chunks that are allocated once and then recycled, instead of
+   * allocating a list node for every request. It is protected by the latch of its partition.
+   */
+  class LockRequestPool {
+   public:
+    LockRequest *Allocate(txn_id_t txn_id, LockMode lock_mode);
+    void Free(LockRequest *request);
+
+    /** @return the memory held by the pool, including the free requests */
+    inline size_t GetAllocatedBytes() const { return chunks_.size() * CHUNK_SIZE * sizeof(LockRequest); }
+
+   private:
+    /** The number of requests allocated at a time. */
+    static constexpr size_t CHUNK_SIZE = 64;
+    std::vector<std::unique_ptr<LockRequest[]>> chunks_;
+    LockRequest *free_list_{nullptr};
+  };
+
+  /** A partition of the lock table, on its own cache lines so that the latches do not share one. */
+  struct alignas(64) LockTablePartition {
+    std::mutex latch_;
+    std::unordered_map<LockTarget, LockRequestQueue, LockTargetHash> lock_table_;
+    LockRequestPool pool_;
+  };
+
  public:
+  /** The number of lock table partitions. */
+  static constexpr size_t LOCK_TABLE_PARTITIONS = 64;
   /**
-   * Creates a new lock manager configured for the deadlock prevention policy.
+   * How often a waiting transaction checks whether it was wounded or chosen as a deadlock victim. A transaction
+   * wounded in another queue is only notified there, so the waits in every other queue are bounded by this.
    */
-  LockManager() = default;
+  static constexpr std::chrono::milliseconds WOUND_CHECK_INTERVAL{10};
+  /** The default number of row locks a transaction may hold on one table before they are escalated. */
+  static constexpr size_t DEFAULT_ESCALATION_THRESHOLD = 1000;
+
+  /** How deadlocks are handled, see above. */
+  enum class DeadlockMode { PREVENTION, DETECTION };
+
+  /**
+   * Creates a new lock manager configured for the deadlock prevention policy, or the detection policy which starts
+   * the cycle detection thread.
+   */
+  explicit LockManager(DeadlockMode deadlock_mode = DeadlockMode::PREVENTION);
+
+  ~LockManager();
 
-  ~LockManager() = default;
+  DISALLOW_COPY_AND_MOVE(LockManager);
 
   /*
    * [LOCK_NOTE]: For all locking functions, we:
@@ -68,6 +163,9 @@ class LockManager {
    * 3. it is undefined behavior to try locking an already locked RID in the
    * same transaction, i.e. the transaction is responsible for keeping track of
    * its current locks.
+   *
+   * A transaction that breaks two-phase locking, or that is wounded while it waits, is aborted and gets a
+   * TransactionAbortException.
    */
 
   /**
@@ -86,6 +184,15 @@ class LockManager {
    */
   bool LockExclusive(Transaction *txn, const RID &rid);
 
+  /**
+   * Acquire a lock on RID in increment mode, or in exclusive mode if the transaction already holds a shared lock on
+   * it. See [LOCK_NOTE] in header file.
+   * @param txn the transaction requesting the increment lock
+   * @param rid the RID to be locked in increment mode
+   * @return true if the lock is granted, false otherwise
+   */
+  bool LockIncrement(Transaction *txn, const RID &rid);
+
   /**
    * Upgrade a lock from a shared lock to an exclusive lock.
    * @param txn the transaction requesting the lock upgrade
@@ -104,11 +211,170 @@ class LockManager {
    */
   bool Unlock(Transaction *txn, const RID &rid);
 
+  /**
+   * Lock a table, or strengthen the transaction's lock on it, e.g. from SHARED and INTENTION_EXCLUSIVE to
+   * SHARED_INTENTION_EXCLUSIVE. See [LOCK_NOTE] in header file.
+   * @param txn the transaction requesting the lock
+   * @param lock_mode the mode to lock the table in
+   * @param oid the table to be locked
+   * @return true if the lock is granted, false otherwise
+   */
+  bool LockTable(Transaction *txn, LockMode lock_mode, table_oid_t oid);
+
+  /**
+   * Lock a page of a table, or strengthen the transaction's lock on it. The transaction must hold an intention lock
+   * on the table that allows the page lock, e.g. INTENTION_EXCLUSIVE for an EXCLUSIVE page lock.
+   * @param txn the transaction requesting the lock
+   * @param lock_mode the mode to lock the page in
+   * @param oid the table of the page
+   * @param page_id the page to be locked
+   * @return true if the lock is granted, false otherwise
+   */
+  bool LockPage(Transaction *txn, LockMode lock_mode, table_oid_t oid, page_id_t page_id);
+
+  /**
+   * Release the transaction's lock on a table.
+   * @param txn the transaction releasing the lock
+   * @param oid the locked table
+   * @return true if the unlock is successful, false otherwise
+   */
+  bool UnlockTable(Transaction *txn, table_oid_t oid);
+
+  /**
+   * Release the transaction's lock on a page.
+   * @param txn the transaction releasing the lock
+   * @param page_id the locked page
+   * @return true if the unlock is successful, false otherwise
+   */
+  bool UnlockPage(Transaction *txn, page_id_t page_id);
+
+  /** @return true if a lock in mode held also grants the rights of a lock in mode wanted */
+  static bool Covers(LockMode held, LockMode wanted);
+
+  /**
+   * Record that the transaction's lock on rid is a row lock of the table, and escalate the transaction's row locks on
+   * the table to a table lock once there are more than the escalation threshold. This may block like LockTable.
+   * @param txn the transaction that locked the row
+   * @param oid the table of the row
+   * @param rid the locked row
+   */
+  void TrackRowLock(Transaction *txn, table_oid_t oid, const RID &rid);
+
+  /** Set the number of row locks a transaction may hold on one table before they are escalated. */
+  inline void SetEscalationThreshold(size_t threshold) { escalation_threshold_ = threshold; }
+
+  /** @return the number of times row locks have been escalated to a table lock */
+  inline size_t GetNumEscalations() { return num_escalations_; }
+
+  /** @return the memory used by the lock table, i.e. its queues and the pooled requests, in bytes */
+  size_t GetLockTableMemory();
+
+  /*** Graph API ***/
+
+  /** @return the edges of the wait-for graph, from each waiting transaction to the transactions it waits for */
+  std::vector<std::pair<txn_id_t, txn_id_t>> GetEdgeList();
+
+  /**
+   * Look for a cycle in the wait-for graph, starting from the lowest transaction id and exploring the neighbours in
+   * ascending order.
+   * @param[out] txn_id the youngest transaction of the cycle found
+   * @return true if there is a cycle
+   */
+  bool HasCycle(txn_id_t *txn_id);
+
+  /** @return the number of transactions aborted by cycle detection */
+  inline size_t GetNumDeadlocks() { return num_deadlocks_; }
+
+  /** Runs cycle detection in the background, with DETECTION. */
+  void RunCycleDetection();
+
  private:
-  std::mutex latch_;
+  /** @return true if two transactions may hold locks in these modes on the same object */
+  static bool AreCompatible(LockMode a, LockMode b);
+
+  /** @return the weakest mode that covers both modes */
+  static LockMode Combine(LockMode a, LockMode b);
+
+  /** @return the partition of the lock table that holds the queue of target */
+  LockTablePartition *GetPartition(const LockTarget &target);
+
+  /**
+   * Lock the target, or upgrade the transaction's lock on it to a mode that covers lock_mode.
+   * @return the mode of the transaction's lock now, see [LOCK_NOTE] for failures
+   */
+  LockMode Acquire(Transaction *txn, const LockTarget &target, LockMode lock_mode);
+
+  /**
+   * @param shrink false if releasing the lock does not end the growing phase, e.g. for a lock that was escalated
+   * @return the mode of the released lock, if the transaction had one on the target
+   */
+  std::optional<LockMode> Release(Transaction *txn, const LockTarget &target, bool shrink = true);
+
+  /** Replace the transaction's row locks on the table by a table lock. */
+  void Escalate(Transaction *txn, table_oid_t oid);
+
+  /** Abort the transaction and throw, the transaction has already been marked as aborted if reason is DEADLOCK. */
+  [[noreturn]] static void AbortTransaction(Transaction *txn, AbortReason reason);
+
+  /** The checks of every locking function, see [LOCK_NOTE]. @return false if the transaction is already aborted */
+  static bool CanLock(Transaction *txn, LockMode lock_mode);
+
+  /** Abort the younger transactions in the queue whose requests conflict with lock_mode, for wound-wait. */
+  static void Wound(Transaction *txn, LockMode lock_mode, LockRequestQueue *queue);
+
+  /**
+   * @return true if other keeps request from being granted: requests are granted in arrival order, except for an
+   * upgrade which only waits for the granted requests
+   */
+  static bool Blocks(const LockRequest *other, bool other_before, const LockRequest *request, bool upgrading);
+
+  /** @return true if the request can be granted, i.e. it is compatible with the granted requests and those before it */
+  static bool IsGrantable(const LockRequestQueue &queue, const LockRequest *request, bool upgrading);
+
+  /**
+   * Wait until the request is granted, the caller holds the partition latch.
+   * @return false if the transaction was aborted by deadlock handling while waiting
+   */
+  bool WaitForGrant(std::unique_lock<std::mutex> *lock, Transaction *txn, const LockTarget &target,
+                    LockRequestQueue *queue, LockRequest *request, bool upgrading);
+
+  /** Drop the request from its queue, and the queue from the partition once it is empty. */
+  void RemoveRequest(LockTablePartition *partition, const LockTarget &target, LockRequestQueue *queue,
+                     LockRequest *request);
+
+  /**
+   * Set the edges of the wait-for graph from every waiting request of the queue, with DETECTION. The caller holds the
+   * partition latch.
+   */
+  void UpdateWaitsFor(const LockTarget &target, const LockRequestQueue &queue);
+
+  /** Remove a transaction that no longer waits from the wait-for graph, with DETECTION. */
+  void RemoveWaitsFor(txn_id_t txn_id);
+
+  /** HasCycle() for the caller that holds waits_for_latch_. */
+  bool FindCycle(txn_id_t *txn_id);
+
+  /** A waiting transaction in the wait-for graph: what it waits for, and which transactions it waits on. */
+  struct Waiter {
+    LockTarget target_;
+    std::vector<txn_id_t> blockers_;
+  };
+
+  /** The partitions of the lock table. */
+  std::array<LockTablePartition, LOCK_TABLE_PARTITIONS> partitions_;
+  /** Lock escalation: the number of row locks per table and transaction that triggers it, and how often it did. */
+  std::atomic<size_t> escalation_threshold_{DEFAULT_ESCALATION_THRESHOLD};
+  std::atomic<size_t> num_escalations_{0};
 
-  /** Lock table for lock requests. */
-  std::unordered_map<RID, LockRequestQueue> lock_table_;
+  /** The deadlock policy. */
+  DeadlockMode deadlock_mode_;
+  /** Deadlock detection: the waiting transactions with their outgoing edges, i.e. the wait-for graph. */
+  std::map<txn_id_t, Waiter> waits_for_;
+  std::mutex waits_for_latch_;
+  /** Deadlock detection: the background thread and whether it should keep running. */
+  std::atomic<bool> enable_cycle_detection_{false};
+  std::thread cycle_detection_thread_;
+  std::atomic<size_t> num_deadlocks_{0};
 };
 
 }  // namespace bustub
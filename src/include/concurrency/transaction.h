@@ -15,12 +15,17 @@
 #include <atomic>
 #include <deque>
 #include <memory>
+#include <mutex>   // NOLINT
 #include <string>
 #include <thread>  // NOLINT
+#include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
 #include "common/logger.h"
+#include "recovery/log_record.h"
 #include "storage/page/page.h"
 #include "storage/table/tuple.h"
 
@@ -40,19 +45,31 @@ namespace bustub {
  * GROWING  -> COMMITTED     ABORTED
  *    |_________________________^
  *
+ * Transaction states for optimistic transactions, which take their locks while VALIDATING at commit:
+ *
+ * GROWING -> VALIDATING -> COMMITTED   ABORTED
+ *    |__________|_________________________^
+ *
  **/
-enum class TransactionState { GROWING, SHRINKING, COMMITTED, ABORTED };
+enum class TransactionState { GROWING, SHRINKING, VALIDATING, COMMITTED, ABORTED };
 
 /**
- * Transaction isolation level.
+ * Transaction isolation level. SNAPSHOT transactions read the tuples as of their beginning without taking any locks,
+ * see VersionStore, and abort when they write a tuple that another transaction wrote since.
  */
-enum class IsolationLevel { READ_UNCOMMITTED, REPEATABLE_READ, READ_COMMITTED };
+enum class IsolationLevel { READ_UNCOMMITTED, REPEATABLE_READ, READ_COMMITTED, SNAPSHOT };
 
 /**
  * Type of write operation.
  */
 enum class WType { INSERT = 0, DELETE, UPDATE };
 
+/**
+ * Lock modes of multi-granularity locking. Rows are locked SHARED or EXCLUSIVE, or INCREMENT to add to their integer
+ * columns, tables and pages can also be locked with the intention to lock rows below them, see LockManager.
+ */
+enum class LockMode { INTENTION_SHARED, INTENTION_EXCLUSIVE, SHARED, SHARED_INTENTION_EXCLUSIVE, EXCLUSIVE, INCREMENT };
+
 class TableHeap;
 class Catalog;
 using table_oid_t = uint32_t;
@@ -99,6 +116,22 @@ class IndexWriteRecord {
   Catalog *catalog_;
 };
 
+/**
+ * TableDeltaRecord tracks the increments of a transaction to the columns of a tuple. Increments commute, so they are
+ * only added to the tuple when the transaction commits, and concurrent transactions can increment the same tuple.
+ */
+class TableDeltaRecord {
+ public:
+  TableDeltaRecord(TableHeap *table, const Schema *schema) : table_(table), schema_(schema) {}
+
+  /** The table heap specifies which table this delta record is for. */
+  TableHeap *table_;
+  /** The schema of the table, to add to the columns of the tuple. */
+  const Schema *schema_;
+  /** The increment of each column, by column index. */
+  std::vector<std::pair<uint32_t, int32_t>> deltas_;
+};
+
 /**
  * Reason to a transaction abortion
  */
@@ -107,7 +140,10 @@ enum class AbortReason {
   UNLOCK_ON_SHRINKING,
   UPGRADE_CONFLICT,
   DEADLOCK,
-  LOCKSHARED_ON_READ_UNCOMMITTED
+  LOCKSHARED_ON_READ_UNCOMMITTED,
+  TABLE_LOCK_NOT_PRESENT,
+  VALIDATION_FAILED,
+  WRITE_ON_READ_ONLY
 };
 
 /**
@@ -137,6 +173,14 @@ class TransactionAbortException : public std::exception {
         return "Transaction " + std::to_string(txn_id_) + " aborted on deadlock\n";
       case AbortReason::LOCKSHARED_ON_READ_UNCOMMITTED:
         return "Transaction " + std::to_string(txn_id_) + " aborted on lockshared on READ_UNCOMMITTED\n";
+      case AbortReason::TABLE_LOCK_NOT_PRESENT:
+        return "Transaction " + std::to_string(txn_id_) +
+               " aborted because it locked a page without an intention lock on the table\n";
+      case AbortReason::VALIDATION_FAILED:
+        return "Transaction " + std::to_string(txn_id_) +
+               " aborted because another transaction changed a tuple it read since it began\n";
+      case AbortReason::WRITE_ON_READ_ONLY:
+        return "Transaction " + std::to_string(txn_id_) + " aborted because it is read-only and tried to write\n";
     }
     // Todo: Should fail with unreachable.
     return "";
@@ -145,28 +189,82 @@ class TransactionAbortException : public std::exception {
 
 /**
  * Transaction tracks information related to a transaction.
+ *
+ * A read-only transaction never writes: it aborts with WRITE_ON_READ_ONLY when it tries to, so it has no write sets,
+ * writes no log records, and commits without walking any. It reads a snapshot under SNAPSHOT, and takes shared locks
+ * otherwise.
  */
 class Transaction {
  public:
-  explicit Transaction(txn_id_t txn_id, IsolationLevel isolation_level = IsolationLevel::REPEATABLE_READ)
+  explicit Transaction(txn_id_t txn_id, IsolationLevel isolation_level = IsolationLevel::REPEATABLE_READ,
+                       bool read_only = false)
       : state_(TransactionState::GROWING),
         isolation_level_(isolation_level),
         thread_id_(std::this_thread::get_id()),
         txn_id_(txn_id),
         prev_lsn_(INVALID_LSN),
+        begin_lsn_(INVALID_LSN),
+        read_only_(read_only),
         shared_lock_set_{new std::unordered_set<RID>},
-        exclusive_lock_set_{new std::unordered_set<RID>} {
+        exclusive_lock_set_{new std::unordered_set<RID>},
+        increment_lock_set_{new std::unordered_set<RID>},
+        table_lock_set_{new std::unordered_map<table_oid_t, LockMode>},
+        page_lock_set_{new std::unordered_map<page_id_t, LockMode>},
+        table_row_lock_set_{new std::unordered_map<table_oid_t, std::unordered_set<RID>>} {
     // Initialize the sets that will be tracked.
-    table_write_set_ = std::make_shared<std::deque<TableWriteRecord>>();
-    index_write_set_ = std::make_shared<std::deque<IndexWriteRecord>>();
     page_set_ = std::make_shared<std::deque<bustub::Page *>>();
     deleted_page_set_ = std::make_shared<std::unordered_set<page_id_t>>();
+    if (!read_only) {
+      AllocateWriteSets();
+    }
   }
 
   ~Transaction() = default;
 
   DISALLOW_COPY(Transaction);
 
+  /**
+   * Reinitialize a finished transaction as a new one, used by the transaction pool of the transaction manager. The
+   * containers are cleared but keep their memory, so that beginning the transaction again does not allocate.
+   * @param txn_id the id of the new transaction
+   * @param isolation_level the isolation level of the new transaction
+   * @param read_only whether the new transaction is read-only
+   */
+  void Reset(txn_id_t txn_id, IsolationLevel isolation_level, bool read_only = false) {
+    if (!read_only && table_write_set_ == nullptr) {
+      AllocateWriteSets();
+    }
+    read_only_ = read_only;
+    state_ = TransactionState::GROWING;
+    isolation_level_ = isolation_level;
+    thread_id_ = std::this_thread::get_id();
+    txn_id_ = txn_id;
+    prev_lsn_ = INVALID_LSN;
+    begin_lsn_ = INVALID_LSN;
+    async_commit_ = false;
+    log_staging_ = false;
+    read_ts_ = 0;
+    optimistic_ = false;
+    staged_log_.clear();
+    staged_log_size_ = 0;
+    staged_page_lsns_.clear();
+    if (table_write_set_ != nullptr) {
+      table_write_set_->clear();
+      index_write_set_->clear();
+      read_set_->clear();
+      buffered_write_set_->clear();
+      delta_set_->clear();
+    }
+    page_set_->clear();
+    deleted_page_set_->clear();
+    shared_lock_set_->clear();
+    exclusive_lock_set_->clear();
+    increment_lock_set_->clear();
+    table_lock_set_->clear();
+    page_lock_set_->clear();
+    table_row_lock_set_->clear();
+  }
+
   /** @return the id of the thread running the transaction */
   inline std::thread::id GetThreadId() const { return thread_id_; }
 
@@ -176,10 +274,13 @@ class Transaction {
   /** @return the isolation level of this transaction */
   inline IsolationLevel GetIsolationLevel() const { return isolation_level_; }
 
-  /** @return the list of table write records of this transaction */
+  /** @return true if the transaction is read-only */
+  inline bool IsReadOnly() const { return read_only_; }
+
+  /** @return the list of table write records of this transaction, nullptr if it was begun read-only */
   inline std::shared_ptr<std::deque<TableWriteRecord>> GetWriteSet() { return table_write_set_; }
 
-  /** @return the list of index write records of this transaction */
+  /** @return the list of index write records of this transaction, nullptr if it was begun read-only */
   inline std::shared_ptr<std::deque<IndexWriteRecord>> GetIndexWriteSet() { return index_write_set_; }
 
   /** @return the page set */
@@ -222,12 +323,29 @@ class Transaction {
   /** @return the set of resources under an exclusive lock */
   inline std::shared_ptr<std::unordered_set<RID>> GetExclusiveLockSet() { return exclusive_lock_set_; }
 
+  /** @return the set of resources under an increment lock */
+  inline std::shared_ptr<std::unordered_set<RID>> GetIncrementLockSet() { return increment_lock_set_; }
+
   /** @return true if rid is shared locked by this transaction */
   bool IsSharedLocked(const RID &rid) { return shared_lock_set_->find(rid) != shared_lock_set_->end(); }
 
   /** @return true if rid is exclusively locked by this transaction */
   bool IsExclusiveLocked(const RID &rid) { return exclusive_lock_set_->find(rid) != exclusive_lock_set_->end(); }
 
+  /** @return true if rid is increment locked by this transaction */
+  bool IsIncrementLocked(const RID &rid) { return increment_lock_set_->find(rid) != increment_lock_set_->end(); }
+
+  /** @return the locked tables and the mode they are locked in */
+  inline std::shared_ptr<std::unordered_map<table_oid_t, LockMode>> GetTableLockSet() { return table_lock_set_; }
+
+  /** @return the locked pages and the mode they are locked in */
+  inline std::shared_ptr<std::unordered_map<page_id_t, LockMode>> GetPageLockSet() { return page_lock_set_; }
+
+  /** @return the locked rows of each table, the candidates for lock escalation */
+  inline std::shared_ptr<std::unordered_map<table_oid_t, std::unordered_set<RID>>> GetTableRowLockSet() {
+    return table_row_lock_set_;
+  }
+
   /** @return the current state of the transaction */
   inline TransactionState GetState() { return state_; }
 
@@ -246,7 +364,100 @@ class Transaction {
    */
   inline void SetPrevLSN(lsn_t prev_lsn) { prev_lsn_ = prev_lsn; }
 
+  /** @return the LSN of the BEGIN record of this transaction */
+  inline lsn_t GetBeginLSN() { return begin_lsn_; }
+
+  /**
+   * Set the LSN of the BEGIN record.
+   * @param begin_lsn the LSN of the BEGIN record
+   */
+  inline void SetBeginLSN(lsn_t begin_lsn) { begin_lsn_ = begin_lsn; }
+
+  /** @return true if Commit returns before the COMMIT record is durable */
+  inline bool IsAsyncCommit() { return async_commit_; }
+
+  /**
+   * Choose between synchronous and asynchronous commit. An asynchronous commit returns as soon as the COMMIT record is
+   * appended to the log and becomes durable within async_commit_window, so a crash may lose it.
+   * @param async_commit true for asynchronous commit
+   */
+  inline void SetAsyncCommit(bool async_commit) { async_commit_ = async_commit; }
+
+  /** @return true if the transaction stages its log records instead of appending each one to the shared log */
+  inline bool IsLogStaging() { return log_staging_; }
+
+  /**
+   * Choose whether the transaction collects its log records privately and appends them to the log as one batch,
+   * see LogManager::AppendLogRecord(Transaction *, LogRecord *, Page *). Only set this before the transaction begins.
+   * @param log_staging true to stage log records
+   */
+  inline void SetLogStaging(bool log_staging) { log_staging_ = log_staging; }
+
+  /** @return true if the transaction runs under optimistic concurrency control */
+  inline bool IsOptimistic() const { return optimistic_; }
+
+  /**
+   * Choose optimistic concurrency control: the transaction reads its snapshot without locks and records what it read,
+   * buffers its updates and deletes, and applies them at commit if nobody changed what it read in the meantime. Only
+   * set this before the transaction begins.
+   * @param optimistic true for optimistic concurrency control
+   */
+  inline void SetOptimistic(bool optimistic) { optimistic_ = optimistic; }
+
+  /** @return true if the transaction reads a snapshot, i.e. it is a SNAPSHOT or an optimistic transaction */
+  inline bool ReadsSnapshot() const { return isolation_level_ == IsolationLevel::SNAPSHOT || optimistic_; }
+
+  /**
+   * @return the tuples an optimistic transaction read (or wrote), by table, validated when it commits, nullptr if the
+   * transaction was begun read-only
+   */
+  inline std::shared_ptr<std::unordered_map<TableHeap *, std::unordered_set<RID>>> GetReadSet() { return read_set_; }
+
+  /**
+   * @return the updates and deletes of an optimistic transaction that are not applied yet, unlike the write set the
+   * tuple of an update is the new one, nullptr if the transaction was begun read-only
+   */
+  inline std::shared_ptr<std::deque<TableWriteRecord>> GetBufferedWriteSet() { return buffered_write_set_; }
+
+  /**
+   * @return the increments of the transaction that are not applied yet, by tuple, nullptr if the transaction was begun
+   * read-only
+   */
+  inline std::shared_ptr<std::unordered_map<RID, TableDeltaRecord>> GetDeltaSet() { return delta_set_; }
+
+  /** @return the commit timestamp of the snapshot a SNAPSHOT transaction reads */
+  inline timestamp_t GetReadTs() const { return read_ts_; }
+
+  /**
+   * Set the snapshot of the transaction, done by the transaction manager when the transaction begins.
+   * @param read_ts the commit timestamp of the last transaction the snapshot includes
+   */
+  inline void SetReadTs(timestamp_t read_ts) { read_ts_ = read_ts; }
+
  private:
+  /** Allocate the sets that only writers need. */
+  void AllocateWriteSets() {
+    table_write_set_ = std::make_shared<std::deque<TableWriteRecord>>();
+    index_write_set_ = std::make_shared<std::deque<IndexWriteRecord>>();
+    read_set_ = std::make_shared<std::unordered_map<TableHeap *, std::unordered_set<RID>>>();
+    buffered_write_set_ = std::make_shared<std::deque<TableWriteRecord>>();
+    delta_set_ = std::make_shared<std::unordered_map<RID, TableDeltaRecord>>();
+  }
+
+  // The log manager fills and drains the staged log.
+  friend class LogManager;
+
+  /** Log staging: a record that is not in the log yet. */
+  struct StagedLogRecord {
+    LogRecord log_record_;
+    /** The page the record changes, nullptr if there is none. */
+    Page *page_;
+    /** The predecessor a NEWPAGE record links its page into, nullptr if there is none. */
+    Page *prev_page_;
+  };
+  // The transaction manager keeps the nodes that register the transaction.
+  friend class TransactionManager;
+
   /** The current transaction state. */
   TransactionState state_;
   /** The isolation level of the transaction. */
@@ -262,6 +473,30 @@ class Transaction {
   std::shared_ptr<std::deque<IndexWriteRecord>> index_write_set_;
   /** The LSN of the last record written by the transaction. */
   lsn_t prev_lsn_;
+  /** The LSN of the first record written by the transaction. */
+  lsn_t begin_lsn_;
+  /** Whether Commit waits for the COMMIT record to be durable. */
+  bool async_commit_{false};
+  /** Whether log records are staged in staged_log_. */
+  bool log_staging_{false};
+  /** SNAPSHOT: the transactions that committed at or before this timestamp are visible. */
+  timestamp_t read_ts_{0};
+  /** Whether the transaction runs under optimistic concurrency control. */
+  bool optimistic_{false};
+  /** Whether the transaction is read-only. */
+  bool read_only_;
+
+  /** Log staging: the records that are not in the log yet. */
+  std::deque<StagedLogRecord> staged_log_;
+  /** Log staging: the total size of the records in staged_log_. */
+  size_t staged_log_size_{0};
+  /**
+   * Log staging: the pages of appended records whose page LSN is not set yet, with the LSN of the record. These pages
+   * still have the transaction as their log_owner_.
+   */
+  std::vector<std::pair<Page *, lsn_t>> staged_page_lsns_;
+  /** Log staging: protects the staged log, other threads append it when they need one of its pages. */
+  std::mutex staged_log_latch_;
 
   /** Concurrent index: the pages that were latched during index operation. */
   std::shared_ptr<std::deque<Page *>> page_set_;
@@ -272,6 +507,29 @@ class Transaction {
   std::shared_ptr<std::unordered_set<RID>> shared_lock_set_;
   /** LockManager: the set of exclusive-locked tuples held by this transaction. */
   std::shared_ptr<std::unordered_set<RID>> exclusive_lock_set_;
+  /** LockManager: the set of increment-locked tuples held by this transaction. */
+  std::shared_ptr<std::unordered_set<RID>> increment_lock_set_;
+  /** LockManager: the tables locked by this transaction. */
+  std::shared_ptr<std::unordered_map<table_oid_t, LockMode>> table_lock_set_;
+  /** LockManager: the pages locked by this transaction. */
+  std::shared_ptr<std::unordered_map<page_id_t, LockMode>> page_lock_set_;
+  /** LockManager: the locked rows of each table, as far as the table heap knows their table. */
+  std::shared_ptr<std::unordered_map<table_oid_t, std::unordered_set<RID>>> table_row_lock_set_;
+
+  /** OCC: the tuples read. */
+  std::shared_ptr<std::unordered_map<TableHeap *, std::unordered_set<RID>>> read_set_;
+  /** OCC: the writes to apply at commit. */
+  std::shared_ptr<std::deque<TableWriteRecord>> buffered_write_set_;
+
+  /** Escrow: the increments to apply at commit. */
+  std::shared_ptr<std::unordered_map<RID, TableDeltaRecord>> delta_set_;
+
+  /**
+   * TransactionManager: the map nodes that registered the transaction last time, so that registering it again does
+   * not allocate.
+   */
+  std::unordered_map<txn_id_t, Transaction *>::node_type registry_node_;
+  std::unordered_map<txn_id_t, Transaction *>::node_type active_node_;
 };
 
 }  // namespace bustub
@@ -12,43 +12,93 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <set>
 #include <shared_mutex>
+#include <thread>  // NOLINT
+#include <tuple>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "common/config.h"
+#include "common/rwlatch.h"
 #include "concurrency/lock_manager.h"
 #include "concurrency/transaction.h"
 #include "recovery/log_manager.h"
+#include "storage/table/version_store.h"
 
 namespace bustub {
 class LockManager;
 
 /**
  * TransactionManager keeps track of all the transactions running in the system.
+ *
+ * It also hands out the timestamps of multi-version concurrency control: a SNAPSHOT transaction reads as of the last
+ * commit timestamp when it begins, and every committing transaction that wrote gets the next one. The versions older
+ * than the oldest active snapshot (the watermark) are pruned when a transaction commits, for its own writes, and by
+ * the garbage collector, for the rest.
+ *
+ * Transactions run under two-phase locking, or under optimistic concurrency control (see
+ * Transaction::SetOptimistic()), and both kinds can run side by side: an optimistic transaction takes the exclusive
+ * locks of its buffered writes while it applies them at commit.
  */
 class TransactionManager {
  public:
   explicit TransactionManager(LockManager *lock_manager, LogManager *log_manager = nullptr)
       : lock_manager_(lock_manager), log_manager_(log_manager) {}
 
-  ~TransactionManager() = default;
+  ~TransactionManager();
 
   /**
    * Begins a new transaction.
-   * @param txn an optional transaction object to be initialized, otherwise a new transaction is created.
+   * @param txn an optional transaction object to be initialized, otherwise a pooled transaction is reused (see
+   * Recycle()), or a new transaction is created.
    * @param isolation_level an optional isolation level of the transaction.
    * @return an initialized transaction
    */
   Transaction *Begin(Transaction *txn = nullptr, IsolationLevel isolation_level = IsolationLevel::REPEATABLE_READ);
 
   /**
-   * Commits a transaction.
+   * Begins a new read-only transaction, see Transaction. It skips the global transaction latch and the log, and it
+   * commits without walking any write sets.
+   * @param isolation_level SNAPSHOT to read a snapshot without locks, otherwise the transaction takes shared locks
+   * @return an initialized read-only transaction
+   */
+  Transaction *BeginReadOnly(IsolationLevel isolation_level = IsolationLevel::SNAPSHOT);
+
+  /**
+   * Commits a transaction. Unless the transaction commits asynchronously, this waits until its COMMIT record is
+   * durable. An optimistic transaction applies its buffered writes and validates its read set first, if that fails it
+   * is aborted with a TransactionAbortException, and the caller rolls it back with Abort(). The increments of the
+   * transaction (see TableHeap::IncrementTuple()) are added to their tuples here.
    * @param txn the transaction to commit
    */
   void Commit(Transaction *txn);
 
+  /**
+   * Set whether transactions begun from now on commit asynchronously, see Transaction::SetAsyncCommit().
+   * @param async_commit true for asynchronous commit
+   */
+  void SetAsyncCommit(bool async_commit) { async_commit_ = async_commit; }
+
+  /**
+   * Set whether transactions begun from now on stage their log records, see Transaction::SetLogStaging().
+   * @param log_staging true to stage log records
+   */
+  void SetLogStaging(bool log_staging) { log_staging_ = log_staging; }
+
+  /**
+   * Set whether transactions begun from now on run under optimistic concurrency control, see
+   * Transaction::SetOptimistic().
+   * @param optimistic true for optimistic concurrency control
+   */
+  void SetOptimistic(bool optimistic) { optimistic_ = optimistic; }
+
   /**
    * Aborts a transaction
    * @param txn the transaction to abort
@@ -56,12 +106,27 @@ class TransactionManager {
   void Abort(Transaction *txn);
 
   /**
-   * Global list of running transactions
+   * Return a finished transaction to the pool instead of deleting it, a later Begin() reuses the object and the
+   * memory of its containers. The caller must not use the transaction afterwards.
+   * @param txn a committed or aborted transaction that was begun by this transaction manager
    */
+  void Recycle(Transaction *txn);
+
+  /** The number of shards of the transaction map. */
+  static constexpr size_t TXN_MAP_SHARDS = 64;
 
-  /** The transaction map is a global list of all the running transactions in the system. */
-  static std::unordered_map<txn_id_t, Transaction *> txn_map;
-  static std::shared_mutex txn_map_mutex;
+  /** A shard of the transaction map, aligned so that the latches of different shards do not share a cache line. */
+  struct alignas(64) TxnMapShard {
+    std::shared_mutex latch_;
+    std::unordered_map<txn_id_t, Transaction *> txns_;
+  };
+
+  /**
+   * The transaction map is a global list of all the running transactions in the system, sharded by transaction id so
+   * that concurrent begins and commits do not contend on one latch. A transaction leaves it when it commits or aborts,
+   * after it released its locks, so the lock manager only looks up transactions that are still in it.
+   */
+  static std::array<TxnMapShard, TXN_MAP_SHARDS> txn_map;
 
   /**
    * Locates and returns the transaction with the given transaction ID.
@@ -69,20 +134,49 @@ class TransactionManager {
    * @return the transaction with the given transaction id
    */
   static Transaction *GetTransaction(txn_id_t txn_id) {
-    TransactionManager::txn_map_mutex.lock_shared();
-    assert(TransactionManager::txn_map.find(txn_id) != TransactionManager::txn_map.end());
-    auto *res = TransactionManager::txn_map[txn_id];
-    assert(res != nullptr);
-    TransactionManager::txn_map_mutex.unlock_shared();
-    return res;
+    TxnMapShard &shard = GetTxnMapShard(txn_id);
+    std::shared_lock lock(shard.latch_);
+    auto it = shard.txns_.find(txn_id);
+    assert(it != shard.txns_.end());
+    assert(it->second != nullptr);
+    return it->second;
+  }
+
+  /** @return true if the transaction with the given id is still in the transaction map */
+  static bool IsRunning(txn_id_t txn_id) {
+    TxnMapShard &shard = GetTxnMapShard(txn_id);
+    std::shared_lock lock(shard.latch_);
+    return shard.txns_.count(txn_id) != 0;
   }
 
+  /**
+   * Snapshot the transactions of this transaction manager that have begun but not finished yet, used for fuzzy
+   * checkpointing.
+   * @return the id, last LSN and BEGIN LSN of every active transaction
+   */
+  std::vector<std::tuple<txn_id_t, lsn_t, lsn_t>> GetActiveTransactions();
+
   /** Prevents all transactions from performing operations, used for checkpointing. */
   void BlockAllTransactions();
 
   /** Resumes all transactions, used for checkpointing. */
   void ResumeTransactions();
 
+  /** @return the read timestamp of the oldest active snapshot, or the last commit timestamp if there is none */
+  timestamp_t GetWatermark();
+
+  /** Prune the versions below the watermark in every table written since the last garbage collection. */
+  void GarbageCollect();
+
+  /**
+   * Start the garbage collector thread, which calls GarbageCollect() every version_gc_interval. BustubInstance starts
+   * it along with the transaction manager.
+   */
+  void StartGarbageCollection();
+
+  /** Stop the garbage collector thread. */
+  void StopGarbageCollection();
+
  private:
   /**
    * Releases all the locks held by the given transaction.
@@ -96,17 +190,105 @@ class TransactionManager {
     for (auto item : *txn->GetSharedLockSet()) {
       lock_set.emplace(item);
     }
+    for (auto item : *txn->GetIncrementLockSet()) {
+      lock_set.emplace(item);
+    }
     for (auto locked_rid : lock_set) {
       lock_manager_->Unlock(txn, locked_rid);
     }
+    // Coarser locks last, they are the parents of the row locks.
+    std::vector<page_id_t> pages;
+    for (const auto &[page_id, lock_mode] : *txn->GetPageLockSet()) {
+      pages.push_back(page_id);
+    }
+    for (page_id_t page_id : pages) {
+      lock_manager_->UnlockPage(txn, page_id);
+    }
+    std::vector<table_oid_t> tables;
+    for (const auto &[oid, lock_mode] : *txn->GetTableLockSet()) {
+      tables.push_back(oid);
+    }
+    for (table_oid_t oid : tables) {
+      lock_manager_->UnlockTable(txn, oid);
+    }
   }
 
+  using TxnNode = std::unordered_map<txn_id_t, Transaction *>::node_type;
+
+  static TxnMapShard &GetTxnMapShard(txn_id_t txn_id) {
+    return txn_map[static_cast<size_t>(txn_id) % TXN_MAP_SHARDS];
+  }
+
+  /** @return a pooled transaction reset as a new one, or a new transaction */
+  Transaction *NewTransaction(IsolationLevel isolation_level, bool read_only);
+
+  /** Add txn to the transaction map. */
+  static void AddToTxnMap(Transaction *txn);
+
+  /** Remove txn from the transaction map. */
+  static void RemoveFromTxnMap(Transaction *txn);
+
+  /** Commit or abort a read-only transaction, after its state is set. */
+  void FinishReadOnly(Transaction *txn);
+
+  /** Map the id of txn to txn, reusing the map node in node if it holds one. */
+  static void Register(std::unordered_map<txn_id_t, Transaction *> *txns, Transaction *txn, TxnNode *node);
+
+  /** Remove txn from the map unless another transaction took its id since, keeping the map node in node. */
+  static void Unregister(std::unordered_map<txn_id_t, Transaction *> *txns, Transaction *txn, TxnNode *node);
+
+  /** GetWatermark() for the caller that holds version_latch_. */
+  timestamp_t GetWatermarkLocked() { return snapshots_.empty() ? last_commit_ts_ : *snapshots_.begin(); }
+
+  /** Apply the buffered writes of a committing optimistic transaction, under the exclusive locks of their tuples. */
+  void ApplyBufferedWrites(Transaction *txn);
+
+  /**
+   * Make the writes of a committing transaction visible at the next commit timestamp.
+   * @return false if the transaction is optimistic and another transaction changed a tuple it read
+   */
+  bool CommitVersions(Transaction *txn);
+
   std::atomic<txn_id_t> next_txn_id_{0};
+  /** The commit mode of new transactions. */
+  std::atomic<bool> async_commit_{false};
+  /** Whether new transactions stage their log records. */
+  std::atomic<bool> log_staging_{false};
+  /** Whether new transactions are optimistic. */
+  std::atomic<bool> optimistic_{false};
   LockManager *lock_manager_ __attribute__((__unused__));
   LogManager *log_manager_ __attribute__((__unused__));
 
-  /** The global transaction latch is used for checkpointing. */
-  ReaderWriterLatch global_txn_latch_;
+  /**
+   * The global transaction latch is used for checkpointing. Every transaction holds it in read mode, so it is a
+   * scalable latch whose readers do not contend with each other.
+   */
+  ScalableReaderWriterLatch global_txn_latch_;
+
+  /** Transactions of this transaction manager that have begun but not committed or aborted yet. */
+  std::unordered_map<txn_id_t, Transaction *> active_txns_;
+  std::mutex active_txns_latch_;
+
+  /** Orders the commits of transactions with increments, see Commit(). */
+  std::mutex escrow_latch_;
+
+  /** The most transactions the pool keeps, the others are deleted when they are recycled. */
+  static constexpr size_t TXN_POOL_SIZE = 256;
+  /** Finished transactions that Begin() reuses. */
+  std::vector<Transaction *> txn_pool_;
+  std::mutex txn_pool_latch_;
+
+  /** MVCC: the commit timestamp of the last transaction whose writes are visible. */
+  timestamp_t last_commit_ts_{0};
+  /** MVCC: the read timestamps of the active SNAPSHOT transactions. */
+  std::multiset<timestamp_t> snapshots_;
+  /** MVCC: the version stores that may hold versions to prune, they are shared with their tables. */
+  std::map<const VersionStore *, std::weak_ptr<VersionStore>> version_stores_;
+  /** MVCC: protects the timestamps, the snapshots and the version stores, and orders the commits. */
+  std::mutex version_latch_;
+  /** MVCC: the garbage collector thread and whether it should keep running. */
+  std::atomic<bool> enable_gc_{false};
+  std::thread gc_thread_;
 };
 
 }  // namespace bustub
@@ -40,9 +40,11 @@ class ExtendibleHashTable {
    * @param buffer_pool_manager buffer pool manager to be used
    * @param comparator comparator for keys
    * @param hash_fn the hash function
+   * @param directory_page_id the directory page of an existing hash table to open, INVALID_PAGE_ID to create one
    */
   explicit ExtendibleHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
-                               const KeyComparator &comparator, HashFunction<KeyType> hash_fn);
+                               const KeyComparator &comparator, HashFunction<KeyType> hash_fn,
+                               page_id_t directory_page_id = INVALID_PAGE_ID);
 
   /**
    * Inserts a key-value pair into the hash table.
@@ -74,6 +76,9 @@ class ExtendibleHashTable {
    */
   bool GetValue(Transaction *transaction, const KeyType &key, std::vector<ValueType> *result);
 
+  /** @return the page id of the directory page, which identifies the hash table on disk */
+  page_id_t GetDirectoryPageId() { return directory_page_id_; }
+
   /**
    * Returns the global depth.  Do not touch.
    */
@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <optional>
 #include <vector>
 
 #include "common/rid.h"
@@ -23,7 +24,8 @@
 namespace bustub {
 
 /**
- * IndexScanExecutor executes an index scan over a table.
+ * IndexScanExecutor executes an index scan over a table. It returns the tuples in key order, so the index has to be
+ * ordered (a B+ tree).
  */
 
 class IndexScanExecutor : public AbstractExecutor {
@@ -42,7 +44,16 @@ class IndexScanExecutor : public AbstractExecutor {
   bool Next(Tuple *tuple, RID *rid) override;
 
  private:
+  /** @return the key made of the values of the given constant expressions, nullopt if there are none */
+  std::optional<Tuple> MakeKey(const std::vector<const AbstractExpression *> &columns);
+
   /** The index scan plan node to be executed. */
   const IndexScanPlanNode *plan_;
+  /** The scanned index and its table. */
+  IndexInfo *index_info_{nullptr};
+  TableInfo *table_info_{nullptr};
+  /** The RIDs of the entries between the plan's bounds, in key order, and the next one to return. */
+  std::vector<RID> rids_;
+  size_t next_{0};
 };
 }  // namespace bustub
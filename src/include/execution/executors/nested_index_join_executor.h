@@ -28,7 +28,8 @@
 namespace bustub {
 
 /**
- * IndexJoinExecutor executes index join operations.
+ * IndexJoinExecutor executes index join operations. For each outer tuple, the left side of the join predicate is
+ * evaluated on it and looked up in the inner table's index.
  */
 class NestIndexJoinExecutor : public AbstractExecutor {
  public:
@@ -50,5 +51,14 @@ class NestIndexJoinExecutor : public AbstractExecutor {
  private:
   /** The nested index join plan node. */
   const NestedIndexJoinPlanNode *plan_;
+  /** The outer table child. */
+  std::unique_ptr<AbstractExecutor> child_executor_;
+  /** The inner table and the index that is probed. */
+  TableInfo *inner_table_info_{nullptr};
+  IndexInfo *index_info_{nullptr};
+  /** The current outer tuple, its matches in the index and the next match to return. */
+  Tuple outer_tuple_;
+  std::vector<RID> inner_rids_;
+  size_t next_{0};
 };
 }  // namespace bustub
@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <optional>
 #include <vector>
 
 #include "execution/executor_context.h"
@@ -22,7 +23,10 @@
 namespace bustub {
 
 /**
- * The SeqScanExecutor executor executes a sequential table scan.
+ * The SeqScanExecutor executor executes a sequential table scan. Unless the transaction reads uncommitted data, it
+ * locks the table once instead of locking every row it reads: in SHARED mode under REPEATABLE_READ, and with the
+ * intention to lock the rows (INTENTION_SHARED) under READ_COMMITTED, which releases each row lock once the row is
+ * read. A scan that feeds increments (see SetRowLockMode()) reads the rows under INCREMENT row locks instead.
  */
 class SeqScanExecutor : public AbstractExecutor {
  public:
@@ -44,11 +48,27 @@ class SeqScanExecutor : public AbstractExecutor {
    */
   bool Next(Tuple *tuple, RID *rid) override;
 
+  /**
+   * Set the lock to read the rows under, SHARED by default. An UPDATE applied as increments scans the rows under
+   * INCREMENT locks, so that it does not hold a shared lock that conflicts with the other incrementers.
+   * @param row_lock_mode The row lock mode, set before Init()
+   */
+  void SetRowLockMode(LockMode row_lock_mode) { row_lock_mode_ = row_lock_mode; }
+
   /** @return The output schema for the sequential scan */
   const Schema *GetOutputSchema() override { return plan_->OutputSchema(); }
 
  private:
   /** The sequential scan plan node to be executed */
   const SeqScanPlanNode *plan_;
+  /** Release the shared lock on a row that was just read, if the isolation level allows it. */
+  void ReleaseReadLock(const RID &rid);
+
+  /** The scanned table */
+  TableInfo *table_info_{nullptr};
+  /** The position of the scan */
+  std::optional<TableIterator> iterator_;
+  /** The lock the rows are read under */
+  LockMode row_lock_mode_{LockMode::SHARED};
 };
 }  // namespace bustub
@@ -72,5 +72,7 @@ class UpdateExecutor : public AbstractExecutor {
   const TableInfo *table_info_;
   /** The child executor to obtain value from */
   std::unique_ptr<AbstractExecutor> child_executor_;
+  /** The increments of the update if it is applied as increments (see TableHeap::IncrementTuple()), else empty */
+  std::vector<std::pair<uint32_t, int32_t>> deltas_;
 };
 }  // namespace bustub
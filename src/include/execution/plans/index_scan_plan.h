@@ -12,6 +12,9 @@
 
 #pragma once
 
+#include <utility>
+#include <vector>
+
 #include "catalog/catalog.h"
 #include "execution/expressions/abstract_expression.h"
 #include "execution/plans/abstract_plan.h"
@@ -28,9 +31,17 @@ class IndexScanPlanNode : public AbstractPlanNode {
    * @param predicate the predicate to scan with, tuples are returned if predicate(tuple) == true or predicate ==
    * nullptr
    * @param table_oid the identifier of table to be scanned
+   * @param low_key the lowest key to scan, one constant expression per key column, empty to start at the first key
+   * @param high_key the highest key to scan, one constant expression per key column, empty to scan to the last key
    */
-  IndexScanPlanNode(const Schema *output, const AbstractExpression *predicate, index_oid_t index_oid)
-      : AbstractPlanNode(output, {}), predicate_{predicate}, index_oid_(index_oid) {}
+  IndexScanPlanNode(const Schema *output, const AbstractExpression *predicate, index_oid_t index_oid,
+                    std::vector<const AbstractExpression *> low_key = {},
+                    std::vector<const AbstractExpression *> high_key = {})
+      : AbstractPlanNode(output, {}),
+        predicate_{predicate},
+        index_oid_(index_oid),
+        low_key_(std::move(low_key)),
+        high_key_(std::move(high_key)) {}
 
   PlanType GetType() const override { return PlanType::IndexScan; }
 
@@ -40,11 +51,20 @@ class IndexScanPlanNode : public AbstractPlanNode {
   /** @return the identifier of the table that should be scanned */
   index_oid_t GetIndexOid() const { return index_oid_; }
 
+  /** @return the key columns of the lowest key to scan, empty if the scan starts at the first key */
+  const std::vector<const AbstractExpression *> &GetLowKey() const { return low_key_; }
+
+  /** @return the key columns of the highest key to scan, empty if the scan ends at the last key */
+  const std::vector<const AbstractExpression *> &GetHighKey() const { return high_key_; }
+
  private:
   /** The predicate that all returned tuples must satisfy. */
   const AbstractExpression *predicate_;
   /** The table whose tuples should be scanned. */
   index_oid_t index_oid_;
+  /** The bounds of the scanned keys, inclusive. */
+  std::vector<const AbstractExpression *> low_key_;
+  std::vector<const AbstractExpression *> high_key_;
 };
 
 }  // namespace bustub
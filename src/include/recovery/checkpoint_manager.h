@@ -12,6 +12,11 @@
 
 #pragma once
 
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
+#include <mutex>               // NOLINT
+#include <thread>              // NOLINT
+
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/transaction_manager.h"
 #include "recovery/log_manager.h"
@@ -19,25 +24,58 @@
 namespace bustub {
 
 /**
- * CheckpointManager creates consistent checkpoints by blocking all other transactions temporarily.
+ * CheckpointManager creates checkpoints in one of two ways.
+ *
+ * BeginCheckpoint/EndCheckpoint create consistent checkpoints by blocking all other transactions temporarily.
+ *
+ * FuzzyCheckpoint never blocks transactions. It logs a CHECKPOINT_BEGIN record, snapshots the active transaction
+ * table and the dirty page table and logs them in a CHECKPOINT_END record, together with the log offset where redo
+ * has to start (the oldest recLSN or BEGIN of an active transaction). Once the end record is durable, the master
+ * record is pointed at the checkpoint, the log segments before the redo point are discarded, and the dirty pages are
+ * written back one at a time so that the next checkpoint can start redo later. RunCheckpointThread takes fuzzy
+ * checkpoints periodically in the background.
  */
 class CheckpointManager {
  public:
   CheckpointManager(TransactionManager *transaction_manager, LogManager *log_manager,
-                    BufferPoolManager *buffer_pool_manager)
+                    BufferPoolManager *buffer_pool_manager, DiskManager *disk_manager)
       : transaction_manager_(transaction_manager),
         log_manager_(log_manager),
-        buffer_pool_manager_(buffer_pool_manager) {}
+        buffer_pool_manager_(buffer_pool_manager),
+        disk_manager_(disk_manager) {}
 
-  ~CheckpointManager() = default;
+  ~CheckpointManager() { StopCheckpointThread(); }
 
   void BeginCheckpoint();
   void EndCheckpoint();
 
+  /**
+   * Take a fuzzy checkpoint. Requires logging to be enabled, does nothing otherwise.
+   */
+  void FuzzyCheckpoint();
+
+  /**
+   * Start a background thread taking a fuzzy checkpoint every interval.
+   * @param interval time between two checkpoints
+   */
+  void RunCheckpointThread(std::chrono::milliseconds interval);
+
+  /** Stop and join the background checkpoint thread, if it is running. */
+  void StopCheckpointThread();
+
  private:
-  TransactionManager *transaction_manager_ __attribute__((__unused__));
-  LogManager *log_manager_ __attribute__((__unused__));
-  BufferPoolManager *buffer_pool_manager_ __attribute__((__unused__));
+  TransactionManager *transaction_manager_;
+  LogManager *log_manager_;
+  BufferPoolManager *buffer_pool_manager_;
+  DiskManager *disk_manager_;
+
+  /** Serializes fuzzy checkpoints. */
+  std::mutex checkpoint_latch_;
+
+  std::thread *checkpoint_thread_{nullptr};
+  std::mutex thread_latch_;
+  std::condition_variable thread_cv_;
+  bool thread_running_{false};
 };
 
 }  // namespace bustub
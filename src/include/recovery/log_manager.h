@@ -13,10 +13,16 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>              // NOLINT
 #include <condition_variable>  // NOLINT
+#include <deque>
 #include <future>              // NOLINT
 #include <mutex>               // NOLINT
+#include <thread>              // NOLINT
+#include <unordered_map>
 
+#include "concurrency/transaction.h"
 #include "recovery/log_record.h"
 #include "storage/disk/disk_manager.h"
 
@@ -25,13 +31,30 @@ namespace bustub {
 /**
  * LogManager maintains a separate thread that is awakened whenever the log buffer is full or whenever a timeout
  * happens. When the thread is awakened, the log buffer's content is written into the disk log file.
+ *
+ * The log is double-buffered: appenders keep filling log_buffer_ while the flush thread writes flush_buffer_ to
+ * disk. Committing transactions do not write the log themselves, they wait until the flush thread has advanced
+ * persistent_lsn_ past their COMMIT record. Every commit that arrives while a flush is in progress is made durable
+ * by the next flush, so one disk write serves a whole group of commits. Asynchronous commits do not wait at all, they
+ * only schedule a flush within async_commit_window (see ScheduleFlush), which bounds how many of them a crash can lose.
+ *
+ * Appending does not take latch_. An appender reserves its LSN and its slot in log_buffer_ with a single atomic
+ * update of reservation_, copies the record into the slot in parallel with other appenders, and then adds its size
+ * to completed_bytes_. Before swapping, the flush thread seals the buffer so no further slots are handed out and
+ * waits until completed_bytes_ catches up with the reserved bytes, i.e. until the buffer is a fully filled prefix.
+ * Only appenders that find the buffer full or sealed fall back to waiting on latch_.
+ *
+ * Transactions with log staging do not reserve space per record at all. Their records are collected in the
+ * transaction and appended with a single reservation, see AppendLogRecord(Transaction *, LogRecord *, Page *).
  */
 class LogManager {
  public:
   explicit LogManager(DiskManager *disk_manager)
-      : next_lsn_(0), persistent_lsn_(INVALID_LSN), disk_manager_(disk_manager) {
+      : reservation_(0), persistent_lsn_(INVALID_LSN), disk_manager_(disk_manager) {
     log_buffer_ = new char[LOG_BUFFER_SIZE];
     flush_buffer_ = new char[LOG_BUFFER_SIZE];
+    buffer_offset_ = disk_manager_->GetLogFileSize();
+    buffer_history_.emplace_back(0, buffer_offset_);
   }
 
   ~LogManager() {
@@ -44,31 +67,190 @@ class LogManager {
   void RunFlushThread();
   void StopFlushThread();
 
+  /**
+   * Append a log record, waiting for space in the log buffer if it is full.
+   * @return the LSN of the record
+   * @throws Exception if the record cannot fit into a log buffer at all
+   */
   lsn_t AppendLogRecord(LogRecord *log_record);
 
-  inline lsn_t GetNextLSN() { return next_lsn_; }
+  /**
+   * Append a log record on behalf of a transaction and maintain the LSNs that refer to it: the transaction's prev LSN
+   * (and begin LSN for BEGIN) and the page LSNs of the changed pages.
+   *
+   * If the transaction stages its log, the record is only collected in the transaction. The staged records are
+   * appended as one batch with consecutive LSNs when the transaction finishes, when they exceed STAGED_LOG_LIMIT bytes,
+   * or when another thread needs one of their pages: redo replays the changes of a page in log order, so they must
+   * reach the log in the order they were made, and a page must not be written back before its records exist.
+   * @param txn the transaction writing the record, its prev LSN is used as the record's prev LSN
+   * @param log_record the record to append, its contents are moved into the staged log if the record is staged
+   * @param page the page changed by the record, nullptr if there is none; the caller holds its write latch
+   * @param prev_page the predecessor a NEWPAGE record links page into, nullptr if there is none; the caller holds its
+   * write latch
+   */
+  void AppendLogRecord(Transaction *txn, LogRecord *log_record, Page *page = nullptr, Page *prev_page = nullptr);
+
+  /** Register a transaction with log staging before it appends its first record. */
+  void StartLogStaging(Transaction *txn);
+
+  /**
+   * Append what a transaction with log staging has left in its staged log and unregister it. A transaction that has
+   * neither changed a page nor appended anything drops its staged BEGIN/COMMIT/ABORT, it never touches the log.
+   * The transaction must not be deleted before this returns.
+   */
+  void FinishLogStaging(Transaction *txn);
+
+  /**
+   * Append the staged log records of the transaction that has staged changes of page, if there is one.
+   * @param page the page whose log records are needed
+   * @param latched_page a page the caller holds the write latch of, nullptr if there is none
+   * @param latched_prev_page another page the caller holds the write latch of, nullptr if there is none
+   */
+  void AppendStagedLog(Page *page, Page *latched_page = nullptr, Page *latched_prev_page = nullptr);
+
+  /**
+   * Block until every log record up to and including lsn is on disk. The flush thread is woken up immediately if
+   * lsn is not durable yet; concurrent callers share the resulting flush. If the flush thread is not running, the
+   * caller flushes the log buffer itself.
+   * @param lsn the log sequence number that must become persistent
+   */
+  void WaitForPersistentLSN(lsn_t lsn);
+
+  /** Force every log record appended so far to disk, blocking until it is persistent. */
+  void Flush();
+
+  /** Wake up the flush thread to write out the log buffer now, without waiting for the write. */
+  void RequestFlush();
+
+  /**
+   * Make sure that the log is flushed up to lsn within async_commit_window from now, without waiting for it.
+   * @param lsn the log sequence number that must become persistent soon
+   */
+  void ScheduleFlush(lsn_t lsn);
+
+  /** @return the number of log records that have been appended but are not persistent yet */
+  inline lsn_t GetUnflushedLSNLag() { return GetNextLSN() - 1 - persistent_lsn_; }
+
+  /**
+   * Map an LSN to a position in the log file, e.g. to find where redo has to start.
+   * @param lsn a log sequence number that has been handed out
+   * @return a log file offset at or before the record with the given LSN
+   */
+  int GetLogOffset(lsn_t lsn);
+
+  inline lsn_t GetNextLSN() { return static_cast<lsn_t>(reservation_.load() >> 32); }
   inline lsn_t GetPersistentLSN() { return persistent_lsn_; }
   inline void SetPersistentLSN(lsn_t lsn) { persistent_lsn_ = lsn; }
   inline char *GetLogBuffer() { return log_buffer_; }
 
  private:
-  // TODO(students): you may add your own member variables
+  /** Staged log records are appended once they exceed this many bytes, so that a batch always fits a log buffer. */
+  static constexpr size_t STAGED_LOG_LIMIT = LOG_BUFFER_SIZE / 4;
+
+  /**
+   * Append records with consecutive LSNs using a single reservation. Each record's prev LSN is set to the LSN of the
+   * record before it, only the first one keeps its own.
+   */
+  void AppendLogRecords(LogRecord *const *log_records, size_t count);
+
+  /**
+   * Append the staged log of txn as one batch, the caller holds txn->staged_log_latch_. The changed pages are queued
+   * in txn->staged_page_lsns_, see SetStagedPageLSNs().
+   */
+  void AppendStagedLog(Transaction *txn);
 
-  /** The atomic counter which records the next log sequence number. */
-  std::atomic<lsn_t> next_lsn_;
+  /**
+   * Set the page LSNs of the appended staged records of txn under the page latches and clear the pages' owner.
+   * A caller that holds page latches only sets the LSNs of those pages, the others stay queued (and owned, so that
+   * they are not written back) until a thread without page latches comes along, e.g. the owner when it finishes.
+   * @param txn the transaction
+   * @param txn_lock the caller's lock on txn->staged_log_latch_, released before latching any page
+   * @param latched_page a page the caller holds the write latch of, nullptr if there is none
+   * @param latched_prev_page another page the caller holds the write latch of, nullptr if there is none
+   */
+  void SetStagedPageLSNs(Transaction *txn, std::unique_lock<std::mutex> *txn_lock, Page *latched_page,
+                         Page *latched_prev_page);
+
+  /** Body of the flush thread. */
+  void FlushThreadLoop();
+
+  /**
+   * Swap the log buffer with the flush buffer and write out the records it holds. Called by the flush thread, or by
+   * appenders and waiters while it is not running.
+   * @param lock a lock on latch_, released while the disk write is in progress
+   */
+  void SwapAndFlush(std::unique_lock<std::mutex> *lock);
+
+  /**
+   * Write a log record into its reserved slot of the log buffer.
+   * @param log_record the record to serialize, its lsn_ must already be assigned
+   * @param pos the start of the reserved slot
+   */
+  static void SerializeLogRecord(LogRecord *log_record, char *pos);
+
+  /**
+   * Prepare a log record for the compact encoding, computing the update ranges of an update.
+   * @return the size of the record's payload, i.e. everything after the header
+   */
+  static int32_t CompactPayloadSize(LogRecord *log_record);
+
+  /**
+   * The compact header stores the previous LSN relative to the record's own LSN, so the size depends on the LSN.
+   * @return the size of the whole record in the compact encoding if it gets the given LSN
+   */
+  static int32_t CompactRecordSize(LogRecord *log_record, lsn_t lsn, int32_t payload_size);
+
+  /** Write a log record in the compact encoding, its lsn_ and size_ must already be assigned. */
+  static void SerializeCompactLogRecord(LogRecord *log_record, int32_t payload_size, char *pos);
+
+  /** Set in the offset half of reservation_ while the flush thread is draining log_buffer_. */
+  static constexpr uint64_t SEALED = uint64_t{1} << 31;
+
+  /**
+   * The next log sequence number (high 32 bits) and the number of bytes reserved in log_buffer_ (low 32 bits).
+   * Both are advanced together by a single compare-and-swap, so LSN order matches buffer order.
+   */
+  std::atomic<uint64_t> reservation_;
+  /** Number of reserved bytes in log_buffer_ that have been completely copied in. */
+  std::atomic<uint32_t> completed_bytes_{0};
   /** The log records before and including the persistent lsn have been written to disk. */
   std::atomic<lsn_t> persistent_lsn_;
 
   char *log_buffer_;
   char *flush_buffer_;
 
+  /** Number of remembered log buffers in buffer_history_. */
+  static constexpr size_t BUFFER_HISTORY_SIZE = 1024;
+  /** Log file offset of log_buffer_[0]. */
+  int buffer_offset_;
+  /** The first LSN and the log file offset of recently filled log buffers, oldest first. */
+  std::deque<std::pair<lsn_t, int>> buffer_history_;
+
+  /** Serializes buffer swaps and protects the buffer history and the flush request state below. */
   std::mutex latch_;
 
-  std::thread *flush_thread_ __attribute__((__unused__));
+  std::thread *flush_thread_{nullptr};
 
+  /** Wakes up the flush thread on a full buffer or a force request. */
   std::condition_variable cv_;
+  /** Wakes up appenders waiting for buffer space and committers waiting for persistent_lsn_ to advance. */
+  std::condition_variable flushed_cv_;
+
+  /** True if somebody is waiting for the log buffer to be written out before the next timeout. */
+  bool flush_requested_{false};
+  /** The time by which the log buffer has to be written out for asynchronous commits, max() if there is none. */
+  std::chrono::steady_clock::time_point flush_deadline_{std::chrono::steady_clock::time_point::max()};
+  /** True while the flush thread should keep running. */
+  bool flush_thread_running_{false};
+  /** True while flush_buffer_ is being written, see SwapAndFlush(). */
+  bool flushing_{false};
+
+  /** The transactions with log staging that have not finished yet, to look up the owner of a page's staged records. */
+  std::unordered_map<txn_id_t, Transaction *> staging_txns_;
+  /** Protects staging_txns_. */
+  std::mutex staging_txns_latch_;
 
-  DiskManager *disk_manager_ __attribute__((__unused__));
+  DiskManager *disk_manager_;
 };
 
 }  // namespace bustub
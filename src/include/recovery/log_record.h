@@ -14,6 +14,8 @@
 
 #include <cassert>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
 #include "storage/table/tuple.h"
@@ -32,6 +34,10 @@ enum class LogRecordType {
   ABORT,
   /** Creating a new page in the table heap. */
   NEWPAGE,
+  /** Start of a fuzzy checkpoint. */
+  CHECKPOINT_BEGIN,
+  /** End of a fuzzy checkpoint, carries the active transaction table and the dirty page table. */
+  CHECKPOINT_END,
 };
 
 /**
@@ -54,15 +60,38 @@ enum class LogRecordType {
  * | HEADER | tuple_rid | tuple_size | old_tuple_data | tuple_size | new_tuple_data |
  *-----------------------------------------------------------------------------------
  * For new page type log record
- *--------------------------
- * | HEADER | prev_page_id |
- *--------------------------
+ *------------------------------------
+ * | HEADER | prev_page_id | page_id |
+ *------------------------------------
+ * For checkpoint end type log record (checkpoint begin only has the HEADER)
+ *-----------------------------------------------------------------------------------------------------
+ * | HEADER | redo_offset | txn_count | (txn_id, last_lsn) ... | page_count | (page_id, rec_lsn) ... |
+ *-----------------------------------------------------------------------------------------------------
+ *
+ * With enable_compact_log, the same fields are written as varints (signed ones zigzag encoded) and the HEADER becomes
+ *---------------------------------------------------------------------
+ * | length | LSN | transID | LSN - prevLSN (0 if none) | LogType (1) |
+ *---------------------------------------------------------------------
+ * where length counts the bytes after the length field itself. Tuples are written as | tuple_size | tuple_data |.
+ * An update does not carry the tuple images, only the byte ranges in which they differ
+ *---------------------------------------------------------------------------------------------------
+ * | HEADER | tuple_rid | range_count | (gap, old_length, new_length, old_data, new_data) ... |
+ *---------------------------------------------------------------------------------------------------
+ * where gap is the distance from the end of the previous range (in the old tuple) to the start of this one.
  */
 class LogRecord {
   friend class LogManager;
   friend class LogRecovery;
 
  public:
+  /** A byte range in which the old and the new image of an updated tuple differ. */
+  struct UpdateRange {
+    /** Start of the range, which is the same in both images. */
+    uint32_t offset_;
+    std::string old_data_;
+    std::string new_data_;
+  };
+
   LogRecord() = default;
 
   // constructor for Transaction type(BEGIN/COMMIT/ABORT)
@@ -110,8 +139,26 @@ class LogRecord {
     size_ = HEADER_SIZE + sizeof(page_id_t) * 2;
   }
 
+  // constructor for CHECKPOINT_END type
+  LogRecord(LogRecordType log_record_type, int32_t redo_offset, std::vector<std::pair<txn_id_t, lsn_t>> active_txns,
+            std::vector<std::pair<page_id_t, lsn_t>> dirty_pages)
+      : log_record_type_(log_record_type),
+        redo_offset_(redo_offset),
+        active_txns_(std::move(active_txns)),
+        dirty_pages_(std::move(dirty_pages)) {
+    // calculate log record size, header size + redo offset + both tables with their entry counts
+    size_ = HEADER_SIZE + 3 * sizeof(int32_t) + active_txns_.size() * (sizeof(txn_id_t) + sizeof(lsn_t)) +
+            dirty_pages_.size() * (sizeof(page_id_t) + sizeof(lsn_t));
+  }
+
   ~LogRecord() = default;
 
+  LogRecord(const LogRecord &other) = default;
+  LogRecord &operator=(const LogRecord &other) = default;
+  // Staging a record in a transaction moves it, which does not copy its tuples.
+  LogRecord(LogRecord &&other) noexcept = default;
+  LogRecord &operator=(LogRecord &&other) noexcept = default;
+
   inline Tuple &GetDeleteTuple() { return delete_tuple_; }
 
   inline RID &GetDeleteRID() { return delete_rid_; }
@@ -120,14 +167,36 @@ class LogRecord {
 
   inline RID &GetInsertRID() { return insert_rid_; }
 
+  /** Empty if the update was read from a compact log, see GetUpdateRanges(). */
   inline Tuple &GetOriginalTuple() { return old_tuple_; }
 
+  /** Empty if the update was read from a compact log, see GetUpdateRanges(). */
   inline Tuple &GetUpdateTuple() { return new_tuple_; }
 
+  /** The differences between the old and the new tuple of an update, only filled in for the compact encoding. */
+  inline std::vector<UpdateRange> &GetUpdateRanges() { return update_ranges_; }
+
+  /** @return true if this update is only known by its update ranges */
+  inline bool IsUpdateDiff() { return update_diff_; }
+
+  /**
+   * Turn one image of the updated tuple into the other by replacing the update ranges.
+   * @param base the old tuple to redo the update on, or the new tuple to undo it on
+   * @param redo true to produce the new tuple, false to produce the old one
+   * @return the other image of the tuple
+   */
+  Tuple ApplyUpdateRanges(const Tuple &base, bool redo) const;
+
   inline RID &GetUpdateRID() { return update_rid_; }
 
   inline page_id_t GetNewPageRecord() { return prev_page_id_; }
 
+  inline int32_t GetRedoOffset() { return redo_offset_; }
+
+  inline std::vector<std::pair<txn_id_t, lsn_t>> &GetActiveTxns() { return active_txns_; }
+
+  inline std::vector<std::pair<page_id_t, lsn_t>> &GetDirtyPages() { return dirty_pages_; }
+
   inline int32_t GetSize() { return size_; }
 
   inline lsn_t GetLSN() { return lsn_; }
@@ -176,6 +245,25 @@ class LogRecord {
   // case4: for new page operation
   page_id_t prev_page_id_{INVALID_PAGE_ID};
   page_id_t page_id_{INVALID_PAGE_ID};
+
+  // case5: for checkpoint end, where redo starts and the tables needed to resume recovery from the checkpoint
+  int32_t redo_offset_{0};
+  std::vector<std::pair<txn_id_t, lsn_t>> active_txns_;
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_pages_;
+
+  // case6: for update operation in the compact encoding
+  std::vector<UpdateRange> update_ranges_;
+  bool update_diff_{false};
+
+  /** Fill update_ranges_ with the differences between old_tuple_ and new_tuple_. */
+  void ComputeUpdateRanges();
+
+  /**
+   * Unchanged bytes between two changed ones are merged into a single range if the gap is at most this long. Carrying
+   * a byte in both images costs two bytes, a new range at least three bytes of lengths.
+   */
+  static constexpr uint32_t UPDATE_RANGE_MAX_GAP = 1;
+
   static const int HEADER_SIZE = 20;
 };  // namespace bustub
 
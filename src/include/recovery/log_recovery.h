@@ -13,8 +13,14 @@
 #pragma once
 
 #include <algorithm>
-#include <mutex>  // NOLINT
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <mutex>               // NOLINT
+#include <thread>              // NOLINT
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/lock_manager.h"
@@ -24,12 +30,34 @@ namespace bustub {
 
 /**
  * Read log file from disk, redo and undo.
+ *
+ * Redo starts at the redo point of the most recent fuzzy checkpoint (or at the beginning of the log without one) and
+ * reads the log sequentially in chunks of LOG_BUFFER_SIZE bytes. A single thread deserializes each chunk and
+ * hands every record to one of several worker threads, chosen by the id of the page the record applies to. Each page
+ * is therefore replayed by exactly one worker and in log order, while different pages are replayed in parallel.
+ *
+ * Before a chunk is handed to the workers, the distinct pages it touches are passed to a prefetch thread, which
+ * brings them into the buffer pool in page id order. The workers then mostly find their pages resident instead of
+ * reading each one synchronously in log order.
  */
 class LogRecovery {
  public:
-  LogRecovery(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager)
-      : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager), offset_(0) {
+  /**
+   * @param disk_manager the disk manager holding the log file
+   * @param buffer_pool_manager the buffer pool the pages are redone/undone in
+   * @param num_redo_workers number of redo threads, 0 means one per hardware thread (capped by the pool size)
+   * @param enable_prefetch whether redo prefetches the pages of the log records it is about to replay
+   */
+  LogRecovery(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, size_t num_redo_workers = 0,
+              bool enable_prefetch = true)
+      : disk_manager_(disk_manager),
+        buffer_pool_manager_(buffer_pool_manager),
+        offset_(0),
+        enable_prefetch_(enable_prefetch) {
     log_buffer_ = new char[LOG_BUFFER_SIZE];
+    num_redo_workers_ = num_redo_workers != 0 ? num_redo_workers : std::max(1U, std::thread::hardware_concurrency());
+    // Every worker pins one page at a time, leave enough frames for the others.
+    num_redo_workers_ = std::max<size_t>(1, std::min(num_redo_workers_, buffer_pool_manager->GetPoolSize() / 2));
   }
 
   ~LogRecovery() {
@@ -41,17 +69,103 @@ class LogRecovery {
   void Undo();
   bool DeserializeLogRecord(const char *data, LogRecord *log_record);
 
+  /** @return the number of pages the last Redo() prefetched */
+  inline size_t GetNumPrefetched() { return num_prefetched_; }
+
  private:
-  DiskManager *disk_manager_ __attribute__((__unused__));
-  BufferPoolManager *buffer_pool_manager_ __attribute__((__unused__));
+  /** A record to be redone on the given page. */
+  using RedoTask = std::pair<page_id_t, LogRecord>;
+
+  /** Work queue of one background thread of redo. Batches are processed in the order they are pushed. */
+  template <typename Task>
+  class WorkQueue {
+   public:
+    void Push(std::vector<Task> &&batch) {
+      std::scoped_lock lock(latch_);
+      batches_.emplace_back(std::move(batch));
+      cv_.notify_one();
+    }
+
+    /** No more batches will be pushed, Pop() returns false once the queue is drained. */
+    void Close() {
+      std::scoped_lock lock(latch_);
+      done_ = true;
+      cv_.notify_one();
+    }
+
+    /** Block until the next batch is available. */
+    bool Pop(std::vector<Task> *batch) {
+      std::unique_lock<std::mutex> lock(latch_);
+      cv_.wait(lock, [&] { return !batches_.empty() || done_; });
+      if (batches_.empty()) {
+        return false;
+      }
+      *batch = std::move(batches_.front());
+      batches_.pop_front();
+      return true;
+    }
+
+   private:
+    std::mutex latch_;
+    std::condition_variable cv_;
+    std::deque<std::vector<Task>> batches_;
+    bool done_{false};
+  };
+  using RedoQueue = WorkQueue<RedoTask>;
+  using PrefetchQueue = WorkQueue<page_id_t>;
+
+  /**
+   * Decode a log record written in the compact encoding, see DeserializeLogRecord().
+   * @param data the start of the record, which must be complete
+   */
+  bool DeserializeCompactLogRecord(const char *data, LogRecord *log_record);
+
+  /**
+   * Determine the size of the log record at data without deserializing it.
+   * @param data the start of the record
+   * @param available number of readable bytes at data
+   * @return the size of the record, 0 at the end of the log, or -1 if not even the size fits into the available bytes
+   */
+  int32_t GetLogRecordSize(const char *data, int available);
+
+  /**
+   * Find the end record of the checkpoint that starts at the given log offset.
+   * @param checkpoint_offset log offset from the master record, negative if there is no checkpoint
+   * @param[out] checkpoint_end the end record
+   * @return false if the checkpoint does not exist or never completed
+   */
+  bool ReadCheckpointEnd(int checkpoint_offset, LogRecord *checkpoint_end);
+
+  /** Body of a redo worker thread. */
+  void RedoWorker(RedoQueue *queue);
+
+  /** Body of the prefetch thread, which fetches and immediately unpins every page it is given. */
+  void PrefetchWorker(PrefetchQueue *queue);
+
+  /**
+   * Reapply a log record to a page, unless the page already reflects it.
+   * @param page_id the page to redo on; a NEWPAGE record is dispatched both to the new page and to its predecessor
+   * @param log_record the record to redo
+   */
+  void RedoLogRecord(page_id_t page_id, LogRecord *log_record);
+
+  /** Revert the effect of a log record of an uncommitted transaction. */
+  void UndoLogRecord(LogRecord *log_record);
+
+  DiskManager *disk_manager_;
+  BufferPoolManager *buffer_pool_manager_;
 
   /** Maintain active transactions and its corresponding latest lsn. */
   std::unordered_map<txn_id_t, lsn_t> active_txn_;
   /** Mapping the log sequence number to log file offset for undos. */
   std::unordered_map<lsn_t, int> lsn_mapping_;
 
-  int offset_ __attribute__((__unused__));
+  /** Log file offset of log_buffer_[0]. */
+  int offset_;
   char *log_buffer_;
+  size_t num_redo_workers_;
+  bool enable_prefetch_;
+  std::atomic<size_t> num_prefetched_{0};
 };
 
 }  // namespace bustub
@@ -25,6 +25,12 @@ namespace bustub {
 /**
  * DiskManager takes care of the allocation and deallocation of pages within a database. It performs the reading and
  * writing of pages to and from disk, providing a logical file layer within the context of a database management system.
+ *
+ * The log is one contiguous byte stream to its users, but it is stored in fixed-size segment files named
+ * "<db>.log.<n>", where segment n holds the log bytes [n * segment size, (n + 1) * segment size). Segments are
+ * preallocated when they are created. The small control file "<db>.log" records the oldest segment that is still
+ * needed, TruncateLog deletes the segments before it, and the encoding of the log records. Removing the control file
+ * discards the whole log.
  */
 class DiskManager {
  public:
@@ -32,9 +38,9 @@ class DiskManager {
    * Creates a new disk manager that writes to the specified database file.
    * @param db_file the file name of the database file to write to
    */
-  explicit DiskManager(const std::string &db_file);
+  explicit DiskManager(const std::string &db_file, int log_segment_size = LOG_SEGMENT_SIZE);
 
-  ~DiskManager() = default;
+  ~DiskManager();
 
   /**
    * Shut down the disk manager and close all the file resources.
@@ -55,8 +61,11 @@ class DiskManager {
    */
   void ReadPage(page_id_t page_id, char *page_data);
 
+  /** @return the number of pages in the database file */
+  int GetNumPages();
+
   /**
-   * Flush the entire log buffer into disk.
+   * Flush the entire log buffer into disk. The log is synced before this returns, so the records are durable.
    * @param log_data raw log data
    * @param size size of log entry
    */
@@ -71,6 +80,30 @@ class DiskManager {
    */
   bool ReadLog(char *log_data, int size, int offset);
 
+  /** @return the size of the log in bytes, including truncated segments */
+  int GetLogFileSize();
+
+  /**
+   * Discard the log segments that only hold log bytes before the given offset.
+   * @param offset the oldest log offset that must remain readable
+   */
+  void TruncateLog(int offset);
+
+  /** @return true if the log records are in the compact encoding, which enable_compact_log picks for a new log */
+  inline bool IsCompactLog() const { return compact_log_; }
+
+  /** @return the number of log segment files currently on disk */
+  int GetNumLogSegments();
+
+  /**
+   * Replace the master record, which remembers where the most recent checkpoint starts in the log.
+   * @param checkpoint_offset log file offset of the checkpoint
+   */
+  void WriteMasterRecord(int checkpoint_offset);
+
+  /** @return the log file offset stored in the master record, or -1 if no checkpoint was taken yet */
+  int ReadMasterRecord();
+
   /** @return the number of disk flushes */
   int GetNumFlushes() const;
 
@@ -91,9 +124,32 @@ class DiskManager {
 
  private:
   int GetFileSize(const std::string &file_name);
-  // stream to write log file
-  std::fstream log_io_;
+  std::string GetLogSegmentName(int segment) const;
+  /** Open (and create and preallocate, if necessary) the segment the log is appended to. */
+  int OpenLogSegmentForWrite(int segment);
+  /** Persist first_log_segment_ and compact_log_ in the control file. */
+  void WriteLogControl();
+
+  // control file of the log
   std::string log_name_;
+  // size of one log segment file
+  const int log_segment_size_;
+  // end of the log, kept in memory so reads do not have to stat the segments
+  int log_size_{0};
+  // oldest log segment that has not been truncated
+  int first_log_segment_{0};
+  // encoding of the log records
+  bool compact_log_{false};
+  // segment the log is appended to and its file descriptor
+  int log_write_segment_{-1};
+  int log_write_fd_{-1};
+  // segment that was read last and its file descriptor
+  int log_read_segment_{-1};
+  int log_read_fd_{-1};
+  // protects the log segment state above
+  std::mutex log_io_latch_;
+  // file holding the master record
+  std::string master_name_;
   // stream to write db file
   std::fstream db_io_;
   std::string file_name_;
@@ -14,6 +14,7 @@
 #include <string>
 #include <vector>
 
+#include "common/rwlatch.h"
 #include "concurrency/transaction.h"
 #include "storage/index/index_iterator.h"
 #include "storage/page/b_plus_tree_internal_page.h"
@@ -39,8 +40,15 @@ class BPlusTree {
   using LeafPage = BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>;
 
  public:
+  /**
+   * @param header_page_id the header page in which the tree records its root page id under its name
+   */
   explicit BPlusTree(std::string name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
-                     int leaf_max_size = LEAF_PAGE_SIZE, int internal_max_size = INTERNAL_PAGE_SIZE);
+                     int leaf_max_size = LEAF_PAGE_SIZE, int internal_max_size = INTERNAL_PAGE_SIZE,
+                     page_id_t header_page_id = HEADER_PAGE_ID);
+
+  // Open the existing tree whose root page id is recorded in the header page.
+  void Open();
 
   // Returns true if this B+ tree has no keys and values.
   bool IsEmpty() const;
@@ -48,7 +56,7 @@ class BPlusTree {
   // Insert a key-value pair into this B+ tree.
   bool Insert(const KeyType &key, const ValueType &value, Transaction *transaction = nullptr);
 
-  // Remove a key and its value from this B+ tree.
+  // Remove a key and its value from this B+ tree. Leaves are not merged, an empty leaf stays in the leaf chain.
   void Remove(const KeyType &key, Transaction *transaction = nullptr);
 
   // return the value associated with a given key
@@ -111,11 +119,14 @@ class BPlusTree {
 
   // member variable
   std::string index_name_;
+  page_id_t header_page_id_;
   page_id_t root_page_id_;
   BufferPoolManager *buffer_pool_manager_;
   KeyComparator comparator_;
   int leaf_max_size_;
   int internal_max_size_;
+  // Readers are lookups and iterators, writers are inserts and removes
+  ReaderWriterLatch tree_latch_;
 };
 
 }  // namespace bustub
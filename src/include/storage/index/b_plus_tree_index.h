@@ -14,6 +14,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "storage/index/b_plus_tree.h"
@@ -23,10 +24,36 @@ namespace bustub {
 
 #define BPLUSTREE_INDEX_TYPE BPlusTreeIndex<KeyType, ValueType, KeyComparator>
 
+/** The key and comparator types of the tree behind a BPlusTreeIndex on KeyType. */
+template <typename KeyType>
+struct RidKeyTraits;
+
+template <size_t KeySize>
+struct RidKeyTraits<GenericKey<KeySize>> {
+  using Key = GenericRidKey<KeySize>;
+  using Comparator = GenericRidComparator<KeySize>;
+};
+
+/**
+ * A B+ tree index. Keys need not be unique: the tree is keyed on (key, RID), so it holds an entry per RID and
+ * DeleteEntry() removes only the entry of the given RID.
+ */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeIndex : public Index {
+  using TreeKeyType = typename RidKeyTraits<KeyType>::Key;
+  using TreeComparator = typename RidKeyTraits<KeyType>::Comparator;
+  using TreeIterator = IndexIterator<TreeKeyType, ValueType, TreeComparator>;
+  /** The page sizes of the tree, LEAF_PAGE_SIZE and INTERNAL_PAGE_SIZE for its key type. */
+  static constexpr int TREE_LEAF_SIZE = (PAGE_SIZE - LEAF_PAGE_HEADER_SIZE) / sizeof(std::pair<TreeKeyType, ValueType>);
+  static constexpr int TREE_INTERNAL_SIZE =
+      (PAGE_SIZE - INTERNAL_PAGE_HEADER_SIZE) / sizeof(std::pair<TreeKeyType, page_id_t>);
+
  public:
-  BPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager);
+  /**
+   * @param header_page_id the header page of an existing tree to open, INVALID_PAGE_ID to create one
+   */
+  BPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager,
+                 page_id_t header_page_id = INVALID_PAGE_ID);
 
   void InsertEntry(const Tuple &key, RID rid, Transaction *transaction) override;
 
@@ -34,17 +61,33 @@ class BPlusTreeIndex : public Index {
 
   void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) override;
 
-  INDEXITERATOR_TYPE GetBeginIterator();
+  bool IsOrdered() const override { return true; }
 
-  INDEXITERATOR_TYPE GetBeginIterator(const KeyType &key);
+  void ScanRange(const Tuple *low_key, const Tuple *high_key, std::vector<RID> *result,
+                 Transaction *transaction) override;
 
-  INDEXITERATOR_TYPE GetEndIterator();
+  /** @return the page in which the tree records its root page id, which identifies the tree on disk */
+  page_id_t GetHeaderPageId() const { return header_page_id_; }
+
+  TreeIterator GetBeginIterator();
+
+  /** @return an iterator at the first entry whose key is not less than key */
+  TreeIterator GetBeginIterator(const KeyType &key);
+
+  TreeIterator GetEndIterator();
 
  protected:
+  /** Allocate an empty header page for a new tree. */
+  static page_id_t NewHeaderPage(BufferPoolManager *buffer_pool_manager);
+
   // comparator for key
   KeyComparator comparator_;
+  // comparator for (key, rid)
+  TreeComparator tree_comparator_;
+  // the tree's own header page
+  page_id_t header_page_id_;
   // container
-  BPlusTree<KeyType, ValueType, KeyComparator> container_;
+  BPlusTree<TreeKeyType, ValueType, TreeComparator> container_;
 };
 
 }  // namespace bustub
@@ -28,8 +28,11 @@ namespace bustub {
 template <typename KeyType, typename ValueType, typename KeyComparator>
 class ExtendibleHashTableIndex : public Index {
  public:
+  /**
+   * Create a new hash index, or open an existing one if directory_page_id is given.
+   */
   ExtendibleHashTableIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager,
-                           const HashFunction<KeyType> &hash_fn);
+                           const HashFunction<KeyType> &hash_fn, page_id_t directory_page_id = INVALID_PAGE_ID);
 
   ~ExtendibleHashTableIndex() override = default;
 
@@ -39,6 +42,9 @@ class ExtendibleHashTableIndex : public Index {
 
   void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) override;
 
+  /** @return the directory page of the underlying hash table */
+  page_id_t GetDirectoryPageId() { return container_.GetDirectoryPageId(); }
+
  protected:
   // comparator for key
   KeyComparator comparator_;
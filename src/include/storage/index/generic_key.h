@@ -14,6 +14,7 @@
 
 #include <cstring>
 
+#include "common/rid.h"
 #include "storage/table/tuple.h"
 #include "type/value.h"
 
@@ -103,4 +104,58 @@ class GenericComparator {
   Schema *key_schema_;
 };
 
+/**
+ * A generic key extended by the RID of its entry. A B+ tree keyed on it keeps one entry per RID for duplicate keys,
+ * and the entry of a RID can be removed without touching the others.
+ */
+template <size_t KeySize>
+class GenericRidKey {
+ public:
+  inline void SetFromKey(const Tuple &tuple, const RID &rid) {
+    key_.SetFromKey(tuple);
+    rid_ = rid;
+  }
+
+  // NOTE: for test purpose only
+  inline void SetFromInteger(int64_t key) {
+    key_.SetFromInteger(key);
+    rid_ = RID();
+  }
+
+  inline int64_t ToString() const { return key_.ToString(); }
+
+  // NOTE: for test purpose only
+  friend std::ostream &operator<<(std::ostream &os, const GenericRidKey &key) {
+    os << key.ToString();
+    return os;
+  }
+
+  GenericKey<KeySize> key_;
+  /** The default RID (INVALID_PAGE_ID) sorts before every valid one, so it makes a lower bound for the key. */
+  RID rid_;
+};
+
+/**
+ * Orders GenericRidKeys by key, then by RID.
+ */
+template <size_t KeySize>
+class GenericRidComparator {
+ public:
+  inline int operator()(const GenericRidKey<KeySize> &lhs, const GenericRidKey<KeySize> &rhs) const {
+    int result = key_comparator_(lhs.key_, rhs.key_);
+    if (result != 0) {
+      return result;
+    }
+    if (lhs.rid_.Get() < rhs.rid_.Get()) {
+      return -1;
+    }
+    return lhs.rid_.Get() > rhs.rid_.Get() ? 1 : 0;
+  }
+
+  explicit GenericRidComparator(Schema *key_schema) : key_comparator_(key_schema) {}
+
+ private:
+  GenericComparator<KeySize> key_comparator_;
+};
+
 }  // namespace bustub
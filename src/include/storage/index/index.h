@@ -18,6 +18,7 @@
 #include <vector>
 
 #include "catalog/schema.h"
+#include "common/exception.h"
 #include "storage/table/tuple.h"
 #include "type/value.h"
 
@@ -175,6 +176,25 @@ class Index {
    */
   virtual void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) = 0;
 
+  ///////////////////////////////////////////////////////////////////
+  // Range Scan
+  ///////////////////////////////////////////////////////////////////
+
+  /** @return true if the index keeps its keys in order and supports ScanRange() */
+  virtual bool IsOrdered() const { return false; }
+
+  /**
+   * Search the index for the keys in [low_key, high_key], in key order. Only ordered indexes support this.
+   * @param low_key The lowest key, nullptr to start at the first key
+   * @param high_key The highest key, nullptr to end at the last key
+   * @param result The collection of RIDs that is populated with results of the search
+   * @param transaction The transaction context
+   */
+  virtual void ScanRange(const Tuple *low_key, const Tuple *high_key, std::vector<RID> *result,
+                         Transaction *transaction) {
+    throw NotImplementedException("The index does not support range scans.");
+  }
+
  private:
   /** The Index structure owns its metadata */
   std::unique_ptr<IndexMetadata> metadata_;
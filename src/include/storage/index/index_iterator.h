@@ -13,17 +13,36 @@
  * For range scan of b+ tree
  */
 #pragma once
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "common/rwlatch.h"
 #include "storage/page/b_plus_tree_leaf_page.h"
 
 namespace bustub {
 
 #define INDEXITERATOR_TYPE IndexIterator<KeyType, ValueType, KeyComparator>
 
+/**
+ * IndexIterator walks the leaves of a B+ tree in key order. It copies the entries of one leaf at a time and holds
+ * neither a pin nor a latch in between, so a scan does not block writers. Entries inserted into a leaf after it was
+ * copied may be missed, entries are never returned twice.
+ */
 INDEX_TEMPLATE_ARGUMENTS
 class IndexIterator {
+  using LeafPage = BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>;
+
  public:
-  // you may define your own constructor based on your member variables
+  /** Create an end iterator. */
   IndexIterator();
+
+  /**
+   * Create an iterator positioned at entry index of leaf, which the caller keeps pinned and latched by tree_latch.
+   * @param buffer_pool_manager the buffer pool manager of the tree
+   * @param tree_latch the latch that protects the tree's pages
+   */
+  IndexIterator(BufferPoolManager *buffer_pool_manager, ReaderWriterLatch *tree_latch, LeafPage *leaf, int index);
+
   ~IndexIterator();
 
   bool IsEnd();
@@ -32,12 +51,27 @@ class IndexIterator {
 
   IndexIterator &operator++();
 
-  bool operator==(const IndexIterator &itr) const { throw std::runtime_error("unimplemented"); }
+  bool operator==(const IndexIterator &itr) const { return page_id_ == itr.page_id_ && index_ == itr.index_; }
 
-  bool operator!=(const IndexIterator &itr) const { throw std::runtime_error("unimplemented"); }
+  bool operator!=(const IndexIterator &itr) const { return !(*this == itr); }
 
  private:
-  // add your own private member variables here
+  /** Copy the entries of leaf from index on. */
+  void CopyLeaf(LeafPage *leaf, int index);
+
+  /** Move to the next non-empty leaf, or to the end. */
+  void SkipEmptyLeaves();
+
+  BufferPoolManager *buffer_pool_manager_{nullptr};
+  ReaderWriterLatch *tree_latch_{nullptr};
+  /** The current leaf, INVALID_PAGE_ID at the end. */
+  page_id_t page_id_{INVALID_PAGE_ID};
+  /** The position in the current leaf. */
+  int index_{0};
+  /** The entries of the current leaf from the first position on. */
+  std::vector<MappingType> entries_;
+  size_t pos_{0};
+  page_id_t next_page_id_{INVALID_PAGE_ID};
 };
 
 }  // namespace bustub
@@ -22,9 +22,11 @@ namespace bustub {
  * 32 bytes) and their corresponding root_id
  *
  * Format (size in byte):
- *  -----------------------------------------------------------------
- * | RecordCount (4) | Entry_1 name (32) | Entry_1 root_id (4) | ... |
- *  -----------------------------------------------------------------
+ *  ---------------------------------------------------------------------------
+ * | RecordCount (4) | LSN (4) | Entry_1 name (32) | Entry_1 root_id (4) | ... |
+ *  ---------------------------------------------------------------------------
+ *
+ * The LSN is not used, but the buffer pool reads it like in every other page.
  */
 class HeaderPage : public Page {
  public:
@@ -41,6 +43,8 @@ class HeaderPage : public Page {
   int GetRecordCount();
 
  private:
+  static constexpr int OFFSET_RECORDS = 8;
+
   /**
    * helper functions
    */
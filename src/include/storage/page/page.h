@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstring>
 #include <iostream>
 
@@ -28,6 +29,8 @@ namespace bustub {
 class Page {
   // There is book-keeping information inside the page that should only be relevant to the buffer pool manager.
   friend class BufferPoolManagerInstance;
+  // The log manager tracks which transaction has staged, not yet appended log records for the page.
+  friend class LogManager;
 
  public:
   /** Constructor. Zeros out the page data. */
@@ -86,6 +89,10 @@ class Page {
   int pin_count_ = 0;
   /** True if the page is dirty, i.e. it is different from its corresponding page on disk. */
   bool is_dirty_ = false;
+  /** No log record older than this LSN can be missing from the page on disk (recLSN). */
+  lsn_t rec_lsn_ = INVALID_LSN;
+  /** The transaction whose staged log records for this page are not in the log yet, INVALID_TXN_ID if there is none. */
+  std::atomic<txn_id_t> log_owner_{INVALID_TXN_ID};
   /** Page latch. */
   ReaderWriterLatch rwlatch_;
 };
@@ -50,8 +50,10 @@ class TablePage : public Page {
    * @param prev_page_id the previous table page ID
    * @param log_manager the log manager in use
    * @param txn the transaction that this page is created in
+   * @param prev_page the previous table page if the caller linked this page into it, write latched by the caller
    */
-  void Init(page_id_t page_id, uint32_t page_size, page_id_t prev_page_id, LogManager *log_manager, Transaction *txn);
+  void Init(page_id_t page_id, uint32_t page_size, page_id_t prev_page_id, LogManager *log_manager, Transaction *txn,
+            Page *prev_page = nullptr);
 
   /** @return the page ID of this table page */
   page_id_t GetTablePageId() { return *reinterpret_cast<page_id_t *>(GetData()); }
@@ -77,34 +79,34 @@ class TablePage : public Page {
    * @param tuple tuple to insert
    * @param[out] rid rid of the inserted tuple
    * @param txn transaction performing the insert
-   * @param lock_manager the lock manager
+   * @param lock_manager the lock manager, nullptr if the transaction holds a table or page lock that covers the row
    * @param log_manager the log manager
-   * @return true if the insert is successful (i.e. there is enough space)
+   * @return true if the insert is successful (i.e. there is enough space and the new tuple could be locked)
    */
   bool InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn, LockManager *lock_manager, LogManager *log_manager);
 
   /**
-   * Mark a tuple as deleted. This does not actually delete the tuple.
+   * Mark a tuple as deleted. This does not actually delete the tuple. The caller holds the exclusive lock of the
+   * tuple (or a coarser one), taken before the page was latched.
    * @param rid rid of the tuple to mark as deleted
    * @param txn transaction performing the delete
-   * @param lock_manager the lock manager
    * @param log_manager the log manager
    * @return true if marking the tuple as deleted is successful (i.e the tuple exists)
    */
-  bool MarkDelete(const RID &rid, Transaction *txn, LockManager *lock_manager, LogManager *log_manager);
+  bool MarkDelete(const RID &rid, Transaction *txn, LogManager *log_manager);
 
   /**
-   * Update a tuple.
+   * Update a tuple. The caller holds the exclusive lock of the tuple (or a coarser one), taken before the page was
+   * latched.
    * @param new_tuple new value of the tuple
    * @param[out] old_tuple old value of the tuple
    * @param rid rid of the tuple
    * @param txn transaction performing the update
-   * @param lock_manager the lock manager
    * @param log_manager the log manager
    * @return true if updating the tuple succeeded
    */
   bool UpdateTuple(const Tuple &new_tuple, Tuple *old_tuple, const RID &rid, Transaction *txn,
-                   LockManager *lock_manager, LogManager *log_manager);
+                   LogManager *log_manager);
 
   /** To be called on commit or abort. Actually perform the delete or rollback an insert. */
   void ApplyDelete(const RID &rid, Transaction *txn, LogManager *log_manager);
@@ -113,29 +115,39 @@ class TablePage : public Page {
   void RollbackDelete(const RID &rid, Transaction *txn, LogManager *log_manager);
 
   /**
-   * Read a tuple from a table.
+   * Read a tuple from a table. The caller holds at least a shared lock of the tuple (or a coarser one), taken before
+   * the page was latched. A tuple deleted while the caller waited for the lock is not there anymore, which does not
+   * abort the caller.
    * @param rid rid of the tuple to read
    * @param[out] tuple the tuple that was read
-   * @param txn transaction performing the read
-   * @param lock_manager the lock manager
    * @return true if the read is successful (i.e. the tuple exists)
    */
-  bool GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, LockManager *lock_manager);
+  bool GetTuple(const RID &rid, Tuple *tuple);
+
+  /**
+   * Read a tuple without locking it, for physical scans (e.g. an index build) that only rely on the page latch.
+   * @param rid rid of the tuple to read
+   * @param[out] tuple the tuple that was read
+   * @return true if the tuple exists, is not deleted and lies within the page
+   */
+  bool ReadTuple(const RID &rid, Tuple *tuple);
 
   /** @return the rid of the first tuple in this page */
 
   /**
    * @param[out] first_rid the RID of the first tuple in this page
+   * @param include_deleted also return deleted and empty slots, whose tuples a snapshot may still see
    * @return true if the first tuple exists, false otherwise
    */
-  bool GetFirstTupleRid(RID *first_rid);
+  bool GetFirstTupleRid(RID *first_rid, bool include_deleted = false);
 
   /**
    * @param cur_rid the RID of the current tuple
    * @param[out] next_rid the RID of the tuple following the current tuple
+   * @param include_deleted also return deleted and empty slots, whose tuples a snapshot may still see
    * @return true if the next tuple exists, false otherwise
    */
-  bool GetNextTupleRid(const RID &cur_rid, RID *next_rid);
+  bool GetNextTupleRid(const RID &cur_rid, RID *next_rid, bool include_deleted = false);
 
  private:
   static_assert(sizeof(page_id_t) == 4);
@@ -190,6 +202,9 @@ class TablePage : public Page {
     memcpy(GetData() + OFFSET_TUPLE_SIZE + SIZE_TUPLE * slot_num, &size, sizeof(uint32_t));
   }
 
+  /** Copy the tuple at rid, which is tuple_size bytes long, into tuple. */
+  void CopyTuple(const RID &rid, uint32_t tuple_size, Tuple *tuple);
+
   /** @return true if the tuple is deleted or empty */
   static bool IsDeleted(uint32_t tuple_size) { return static_cast<bool>(tuple_size & DELETE_MASK) || tuple_size == 0; }
 
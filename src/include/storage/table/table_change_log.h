@@ -0,0 +1,100 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// table_change_log.h
+//
+// Identification: src/include/storage/table/table_change_log.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <mutex>  // NOLINT
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "common/config.h"
+#include "common/rid.h"
+#include "storage/table/tuple.h"
+
+namespace bustub {
+
+/**
+ * TableChangeLog is the side log of an online index build. While it is active, the table heap records every change
+ * to a tuple's presence: an insert (or a rolled back delete) with the new tuple, a delete (or a rolled back insert)
+ * with the old tuple, and an update as both. The index builder replays the changes on top of its scan, so replaying a
+ * change that the scan has already seen must be harmless.
+ */
+class TableChangeLog {
+ public:
+  /** A tuple that appeared (insert_) or disappeared at rid. */
+  struct Change {
+    RID rid_;
+    Tuple tuple_;
+    bool insert_;
+  };
+
+  /** @return true if changes are being recorded, cheap enough to be checked on every write */
+  inline bool IsActive() const { return active_.load(); }
+
+  /** Start recording changes. @return false if another index build already uses the log */
+  bool Start() {
+    std::scoped_lock lock(latch_);
+    if (active_) {
+      return false;
+    }
+    changes_.clear();
+    writers_.clear();
+    active_ = true;
+    return true;
+  }
+
+  /** Stop recording changes, the caller holds the latch (see Lock()). */
+  void StopLocked() {
+    active_ = false;
+    changes_.clear();
+    writers_.clear();
+  }
+
+  /**
+   * Record a change by the transaction txn_id, this is a no-op if the log is not active. The caller holds the write
+   * latch of the page.
+   */
+  void Append(const RID &rid, const Tuple &tuple, bool insert, txn_id_t txn_id) {
+    std::scoped_lock lock(latch_);
+    if (active_) {
+      changes_.push_back({rid, tuple, insert});
+      writers_.insert(txn_id);
+    }
+  }
+
+  /** @return the transactions that recorded changes since Start(), the caller holds the latch (see Lock()) */
+  const std::unordered_set<txn_id_t> &GetWritersLocked() const { return writers_; }
+
+  /** @return the changes recorded since the last call, the caller holds the latch (see Lock()) */
+  std::vector<Change> TakeChangesLocked() { return std::exchange(changes_, {}); }
+
+  /** @return the changes recorded since the last call */
+  std::vector<Change> TakeChanges() {
+    std::scoped_lock lock(latch_);
+    return TakeChangesLocked();
+  }
+
+  /** Block writers that record changes, e.g. to apply the last changes and publish an index atomically. */
+  void Lock() { latch_.lock(); }
+
+  void Unlock() { latch_.unlock(); }
+
+ private:
+  std::atomic<bool> active_{false};
+  std::mutex latch_;
+  std::vector<Change> changes_;
+  std::unordered_set<txn_id_t> writers_;
+};
+
+}  // namespace bustub
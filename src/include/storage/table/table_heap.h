@@ -12,17 +12,28 @@
 
 #pragma once
 
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
 #include "buffer/buffer_pool_manager.h"
 #include "recovery/log_manager.h"
 #include "storage/page/table_page.h"
+#include "storage/table/table_change_log.h"
 #include "storage/table/table_iterator.h"
 #include "storage/table/tuple.h"
+#include "storage/table/version_store.h"
 
 namespace bustub {
 
 /**
  * TableHeap represents a physical table on disk.
  * This is just a doubly-linked list of pages.
+ *
+ * The pages hold the newest version of every tuple, the version store the versions that SNAPSHOT transactions may
+ * still read. Those read without locks, see GetTuple(). So do optimistic transactions, which also buffer their updates
+ * and deletes until they commit.
  */
 class TableHeap {
   friend class TableIterator;
@@ -60,7 +71,8 @@ class TableHeap {
   bool InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn);
 
   /**
-   * Mark the tuple as deleted. The actual delete will occur when ApplyDelete is called.
+   * Mark the tuple as deleted. The actual delete will occur when ApplyDelete is called. An optimistic transaction only
+   * buffers the delete, the transaction manager applies it at commit.
    * @param rid resource id of the tuple of delete
    * @param txn transaction performing the delete
    * @return true iff the delete is successful (i.e the tuple exists)
@@ -69,6 +81,7 @@ class TableHeap {
 
   /**
    * if the new tuple is too large to fit in the old page, return false (will delete and insert)
+   * An optimistic transaction only buffers the update, the transaction manager applies it at commit.
    * @param tuple new tuple
    * @param rid rid of the old tuple
    * @param txn transaction performing the update
@@ -76,6 +89,28 @@ class TableHeap {
    */
   bool UpdateTuple(const Tuple &tuple, const RID &rid, Transaction *txn);
 
+  /**
+   * Add to integer columns of a tuple under an INCREMENT lock, which concurrent incrementers of the tuple share. The
+   * increments are recorded in the transaction and only added to the tuple when it commits (see ApplyDelta()), so an
+   * abort simply drops them. The transaction reads its own increments, and an update or delete of the tuple replaces
+   * them.
+   * @param rid rid of the tuple
+   * @param schema the schema of the table
+   * @param deltas the increment of each column, by column index
+   * @param txn transaction performing the increment
+   * @return true if the increment is successful (i.e. the tuple exists)
+   */
+  bool IncrementTuple(const RID &rid, const Schema &schema, const std::vector<std::pair<uint32_t, int32_t>> &deltas,
+                      Transaction *txn);
+
+  /**
+   * Called on Commit to add the increments of the transaction to a tuple, if it still exists.
+   * @param rid rid of the tuple
+   * @param record the increments of the transaction
+   * @param txn the committing transaction
+   */
+  void ApplyDelta(const RID &rid, const TableDeltaRecord &record, Transaction *txn);
+
   /**
    * Called on Commit/Abort to actually delete a tuple or rollback an insert.
    * @param rid rid of the tuple to delete
@@ -91,16 +126,22 @@ class TableHeap {
   void RollbackDelete(const RID &rid, Transaction *txn);
 
   /**
-   * Read a tuple from the table.
+   * Read a tuple from the table. A SNAPSHOT transaction reads the version in its snapshot, without locking it, and an
+   * optimistic one its own buffered writes or else the version in its snapshot.
    * @param rid rid of the tuple to read
    * @param tuple output variable for the tuple
    * @param txn transaction performing the read
+   * @param row_mode the lock to read the tuple under, SHARED, or INCREMENT for a tuple the transaction increments
    * @return true if the read was successful (i.e. the tuple exists)
    */
-  bool GetTuple(const RID &rid, Tuple *tuple, Transaction *txn);
+  bool GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, LockMode row_mode = LockMode::SHARED);
 
-  /** @return the begin iterator of this table */
-  TableIterator Begin(Transaction *txn);
+  /**
+   * @param txn the transaction performing the scan
+   * @param row_mode the lock to read the tuples under, see GetTuple()
+   * @return the begin iterator of this table
+   */
+  TableIterator Begin(Transaction *txn, LockMode row_mode = LockMode::SHARED);
 
   /** @return the end iterator of this table */
   TableIterator End();
@@ -108,11 +149,74 @@ class TableHeap {
   /** @return the id of the first page of this table */
   inline page_id_t GetFirstPageId() const { return first_page_id_; }
 
+  /** @return the side log that records the changes to this table while an index on it is built */
+  inline TableChangeLog *GetChangeLog() { return &change_log_; }
+
+  /** Set the catalog oid of the table, so that the table locks of transactions can cover their row locks. */
+  inline void SetTableOid(table_oid_t oid) { table_oid_ = oid; }
+
+  /** @return the older versions of the tuples, shared with the garbage collector of the transaction manager */
+  inline std::shared_ptr<VersionStore> GetVersionStore() { return version_store_; }
+
  private:
+  /**
+   * @return the lock manager to lock a row on the page with, or nullptr if a table or page lock of the transaction
+   * already covers reading (or writing) the row
+   */
+  LockManager *GetRowLockManager(page_id_t page_id, Transaction *txn, bool write) {
+    return GetRowLockManager(page_id, txn, write ? LockMode::EXCLUSIVE : LockMode::SHARED);
+  }
+
+  /** Insert the tuple into the latched page, releasing the page if locking the new tuple throws. */
+  bool InsertIntoPage(TablePage *page, const Tuple &tuple, RID *rid, Transaction *txn);
+
+  /** GetRowLockManager() for a row lock in row_mode. */
+  LockManager *GetRowLockManager(page_id_t page_id, Transaction *txn, LockMode row_mode);
+
+  /**
+   * Take the intention lock on the table that locking one of its rows needs, before any page is latched.
+   * @return false if the transaction is aborted
+   */
+  bool LockTableForRow(Transaction *txn, bool write);
+
+  /**
+   * Take the row lock in row_mode (SHARED, EXCLUSIVE or INCREMENT) on the tuple at rid, before its page is latched.
+   * The lock's owner latches the page to commit or abort, so waiting for the lock under the latch would deadlock.
+   * @return false if the lock was not granted
+   */
+  bool LockRow(Transaction *txn, const RID &rid, LockMode row_mode);
+
+  /** Count a row lock of the transaction towards lock escalation, after all pages are unlatched. */
+  void TrackRowLock(Transaction *txn, const RID &rid);
+
+  /** @return the tuple with the increments of record added */
+  static Tuple AddDeltas(const Tuple &tuple, const TableDeltaRecord &record);
+
+  /** GetTuple() for a transaction that reads a snapshot. */
+  bool GetSnapshotTuple(const RID &rid, Tuple *tuple, Transaction *txn);
+
+  /** GetTuple() for a running optimistic transaction, which records the read. */
+  bool GetOptimisticTuple(const RID &rid, Tuple *tuple, Transaction *txn);
+
+  /** Buffer an update or a delete of a running optimistic transaction, if it sees the tuple. */
+  bool BufferWrite(const RID &rid, WType wtype, const Tuple &tuple, Transaction *txn);
+
+  /** Abort a read-only transaction that tries to write, with a TransactionAbortException. */
+  static void CheckWritable(Transaction *txn);
+
+  /** @return true if the writes of the transaction are buffered rather than applied */
+  static bool BuffersWrites(Transaction *txn) {
+    return txn->IsOptimistic() && txn->GetState() == TransactionState::GROWING;
+  }
+
   BufferPoolManager *buffer_pool_manager_;
   LockManager *lock_manager_;
   LogManager *log_manager_;
   page_id_t first_page_id_{};
+  TableChangeLog change_log_;
+  /** The catalog oid of the table, if it is in the catalog. */
+  std::optional<table_oid_t> table_oid_;
+  std::shared_ptr<VersionStore> version_store_{std::make_shared<VersionStore>()};
 };
 
 }  // namespace bustub
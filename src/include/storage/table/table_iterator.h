@@ -23,16 +23,22 @@ namespace bustub {
 class TableHeap;
 
 /**
- * TableIterator enables the sequential scan of a TableHeap.
+ * TableIterator enables the sequential scan of a TableHeap. For a transaction that reads a snapshot it visits every
+ * slot, also those of deleted tuples, and skips the tuples that are not in the snapshot. The other transactions read
+ * the tuples under row locks in row_mode, see TableHeap::GetTuple(), and skip the tuples deleted while they waited
+ * for a lock. If a lock cannot be taken, the transaction is aborted and the iterator moves to the end.
  */
 class TableIterator {
   friend class Cursor;
 
  public:
-  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn);
+  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn, LockMode row_mode = LockMode::SHARED);
 
   TableIterator(const TableIterator &other)
-      : table_heap_(other.table_heap_), tuple_(new Tuple(*other.tuple_)), txn_(other.txn_) {}
+      : table_heap_(other.table_heap_),
+        tuple_(new Tuple(*other.tuple_)),
+        txn_(other.txn_),
+        row_mode_(other.row_mode_) {}
 
   ~TableIterator() { delete tuple_; }
 
@@ -52,13 +58,24 @@ class TableIterator {
     table_heap_ = other.table_heap_;
     *tuple_ = *other.tuple_;
     txn_ = other.txn_;
+    row_mode_ = other.row_mode_;
     return *this;
   }
 
  private:
+  /** @return true if the transaction reads a snapshot */
+  inline bool IsSnapshot() const { return txn_ != nullptr && txn_->ReadsSnapshot(); }
+
+  /** Move to the next slot and read its tuple. @return false if the tuple could not be read */
+  bool Advance();
+
+  /** Unless read, advance until a tuple is read, or to the end if the transaction is aborted. */
+  void SkipUnreadable(bool read);
+
   TableHeap *table_heap_;
   Tuple *tuple_;
   Transaction *txn_;
+  LockMode row_mode_;
 };
 
 }  // namespace bustub
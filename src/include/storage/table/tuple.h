@@ -48,6 +48,12 @@ class Tuple {
   // assign operator, deep copy
   Tuple &operator=(const Tuple &other);
 
+  // move constructor, takes over the data of other
+  Tuple(Tuple &&other) noexcept;
+
+  // move assign operator, takes over the data of other
+  Tuple &operator=(Tuple &&other) noexcept;
+
   ~Tuple() {
     if (allocated_) {
       delete[] data_;
@@ -75,7 +81,7 @@ class Tuple {
   Value GetValue(const Schema *schema, uint32_t column_idx) const;
 
   // Generates a key tuple given schemas and attributes
-  Tuple KeyFromTuple(const Schema &schema, const Schema &key_schema, const std::vector<uint32_t> &key_attrs);
+  Tuple KeyFromTuple(const Schema &schema, const Schema &key_schema, const std::vector<uint32_t> &key_attrs) const;
 
   // Is the column value null ?
   inline bool IsNull(const Schema *schema, uint32_t column_idx) const {
@@ -0,0 +1,115 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// version_store.h
+//
+// Identification: src/include/storage/table/version_store.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <deque>
+#include <mutex>  // NOLINT
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "common/config.h"
+#include "common/rid.h"
+#include "concurrency/transaction.h"
+#include "storage/table/tuple.h"
+
+namespace bustub {
+
+/**
+ * VersionStore keeps the older versions of the tuples of a table heap for multi-version concurrency control. The
+ * table pages always hold the newest version of a tuple, which may be uncommitted. For every tuple that was written
+ * recently, the store keeps a chain of the versions it replaced, newest first, each with the commit timestamp from
+ * which it was valid. A tuple without a chain is visible to everybody as it is on its page.
+ *
+ * The table heap records a write after changing the page, under the page's write latch, so that a reader holding the
+ * read latch sees the page and the chain in sync. Versions are pruned once no snapshot can see them anymore.
+ */
+class VersionStore {
+ public:
+  /**
+   * Record that txn wrote the tuple at rid, called under the page write latch.
+   * @param rid the tuple
+   * @param txn the writer
+   * @param old_tuple the version the write replaced, std::nullopt if the tuple did not exist (an insert)
+   */
+  void RecordWrite(const RID &rid, Transaction *txn, std::optional<Tuple> old_tuple);
+
+  /**
+   * @return false if a SNAPSHOT transaction must not write the tuple at rid, because another transaction wrote it
+   * after the transaction's snapshot, or is still writing it (first updater wins)
+   */
+  bool CanWrite(const RID &rid, Transaction *txn);
+
+  /**
+   * @return true if no other transaction wrote the tuple at rid after the snapshot of txn, nor is writing it, i.e. the
+   * version txn read is still the newest one
+   */
+  bool IsUnchanged(const RID &rid, Transaction *txn);
+
+  /**
+   * Resolve the version of the tuple at rid that txn sees, called under the page latch.
+   * @param rid the tuple
+   * @param txn the reader, which reads a snapshot
+   * @param[in,out] tuple the version on the page on input, the visible version on output
+   * @param exists whether the tuple exists on the page
+   * @return true if the tuple exists in the snapshot of txn
+   */
+  bool GetVisible(const RID &rid, Transaction *txn, Tuple *tuple, bool exists);
+
+  /** Make the write of txn to the tuple at rid the version valid from commit_ts. */
+  void Commit(const RID &rid, Transaction *txn, timestamp_t commit_ts);
+
+  /** Drop the write of txn to the tuple at rid, once the page is rolled back. */
+  void Abort(const RID &rid, Transaction *txn);
+
+  /**
+   * Drop the versions that no snapshot at or after the watermark can see.
+   * @param watermark the read timestamp of the oldest active snapshot
+   * @param rid only prune the chain of this tuple, if given
+   */
+  void Prune(timestamp_t watermark, std::optional<RID> rid = std::nullopt);
+
+  /** @return the transactions whose writes are on the pages and not committed or rolled back yet */
+  std::unordered_set<txn_id_t> GetUncommittedWriters();
+
+  /** @return the number of tuples with older versions */
+  size_t GetNumChains();
+
+  /** @return the number of older versions */
+  size_t GetNumVersions();
+
+ private:
+  /** A replaced version of a tuple, std::nullopt if the tuple did not exist. */
+  struct Version {
+    std::optional<Tuple> tuple_;
+    timestamp_t begin_ts_;
+  };
+
+  /** The older versions of a tuple. */
+  struct VersionChain {
+    /** The transaction that wrote the version on the page and did not commit yet, or INVALID_TXN_ID. */
+    txn_id_t head_txn_{INVALID_TXN_ID};
+    /** The commit timestamp of the version on the page, if it is committed. */
+    timestamp_t head_ts_{0};
+    /** The replaced versions, newest first. */
+    std::deque<Version> versions_;
+  };
+
+  /** Prune one chain. @return true if the chain is not needed anymore */
+  static bool PruneChain(VersionChain *chain, timestamp_t watermark);
+
+  std::mutex latch_;
+  std::unordered_map<RID, VersionChain> chains_;
+};
+
+}  // namespace bustub
@@ -12,6 +12,14 @@
 
 #include "recovery/log_manager.h"
 
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "common/exception.h"
+#include "common/util/varint_util.h"
+
 namespace bustub {
 /*
  * set enable_logging = true
@@ -22,33 +30,541 @@ namespace bustub {
  *
  * This thread runs forever until system shutdown/StopFlushThread
  */
-void LogManager::RunFlushThread() {}
+void LogManager::RunFlushThread() {
+  std::scoped_lock lock(latch_);
+  if (flush_thread_ != nullptr) {
+    return;
+  }
+  enable_logging = true;
+  flush_thread_running_ = true;
+  flush_thread_ = new std::thread(&LogManager::FlushThreadLoop, this);
+}
 
 /*
  * Stop and join the flush thread, set enable_logging = false
  */
-void LogManager::StopFlushThread() {}
+void LogManager::StopFlushThread() {
+  {
+    std::scoped_lock lock(latch_);
+    if (flush_thread_ == nullptr) {
+      return;
+    }
+    flush_thread_running_ = false;
+    cv_.notify_one();
+  }
+  // The flush thread writes out whatever is left in the log buffer before it exits.
+  flush_thread_->join();
+  delete flush_thread_;
+  flush_thread_ = nullptr;
+  enable_logging = false;
+}
 
 /*
  * append a log record into log buffer
  * you MUST set the log record's lsn within this method
  * @return: lsn that is assigned to this log record
- *
- *
- * example below
- * // First, serialize the must have fields(20 bytes in total)
- * log_record.lsn_ = next_lsn_++;
- * memcpy(log_buffer_ + offset_, &log_record, 20);
- * int pos = offset_ + 20;
- *
- * if (log_record.log_record_type_ == LogRecordType::INSERT) {
- *    memcpy(log_buffer_ + pos, &log_record.insert_rid_, sizeof(RID));
- *    pos += sizeof(RID);
- *    // we have provided serialize function for tuple class
- *    log_record.insert_tuple_.SerializeTo(log_buffer_ + pos);
- *  }
- *
  */
-lsn_t LogManager::AppendLogRecord(LogRecord *log_record) { return INVALID_LSN; }
+lsn_t LogManager::AppendLogRecord(LogRecord *log_record) {
+  AppendLogRecords(&log_record, 1);
+  return log_record->lsn_;
+}
+
+void LogManager::AppendLogRecords(LogRecord *const *log_records, size_t count) {
+  bool compact = disk_manager_->IsCompactLog();
+  std::vector<int32_t> payload_sizes;
+  if (compact) {
+    for (size_t i = 0; i < count; i++) {
+      payload_sizes.push_back(CompactPayloadSize(log_records[i]));
+    }
+  }
+  uint64_t size = 0;
+  uint64_t cur = reservation_.load();
+  while (true) {
+    // The size of a compact record depends on its LSN, so recompute the batch size for every candidate LSN.
+    auto lsn = static_cast<lsn_t>(cur >> 32);
+    size = 0;
+    for (size_t i = 0; i < count; i++) {
+      if (i > 0) {
+        log_records[i]->prev_lsn_ = lsn + static_cast<lsn_t>(i) - 1;
+      }
+      size += compact ? CompactRecordSize(log_records[i], lsn + static_cast<lsn_t>(i), payload_sizes[i])
+                      : log_records[i]->size_;
+    }
+    // Waiting for space would never end.
+    if (size > LOG_BUFFER_SIZE) {
+      throw Exception(ExceptionType::OUT_OF_RANGE, "Log records are larger than the log buffer.");
+    }
+    // A sealed buffer has an offset beyond LOG_BUFFER_SIZE, so it is treated like a full one.
+    if ((cur & 0xFFFFFFFF) + size > LOG_BUFFER_SIZE) {
+      std::unique_lock<std::mutex> lock(latch_);
+      if (flush_thread_running_) {
+        flush_requested_ = true;
+        cv_.notify_one();
+        flushed_cv_.wait(lock, [&] { return (reservation_.load() & 0xFFFFFFFF) + size <= LOG_BUFFER_SIZE; });
+      } else {
+        // Nobody else empties the buffer.
+        SwapAndFlush(&lock);
+      }
+      cur = reservation_.load();
+      continue;
+    }
+    // Take the next count LSNs and the next size bytes of the buffer in one step.
+    if (reservation_.compare_exchange_weak(cur, cur + (static_cast<uint64_t>(count) << 32) + size)) {
+      break;
+    }
+  }
+
+  // The buffer cannot be swapped before our bytes are counted as completed, so log_buffer_ is stable here.
+  char *pos = log_buffer_ + (cur & 0xFFFFFFFF);
+  for (size_t i = 0; i < count; i++) {
+    LogRecord *log_record = log_records[i];
+    log_record->lsn_ = static_cast<lsn_t>(cur >> 32) + static_cast<lsn_t>(i);
+    if (compact) {
+      log_record->size_ = CompactRecordSize(log_record, log_record->lsn_, payload_sizes[i]);
+      SerializeCompactLogRecord(log_record, payload_sizes[i], pos);
+    } else {
+      SerializeLogRecord(log_record, pos);
+    }
+    pos += log_record->size_;
+  }
+  completed_bytes_.fetch_add(size);
+}
+
+void LogManager::AppendLogRecord(Transaction *txn, LogRecord *log_record, Page *page, Page *prev_page) {
+  // Another transaction's staged changes of these pages come first in the log.
+  for (Page *changed : {page, prev_page}) {
+    if (changed != nullptr && changed->log_owner_ != INVALID_TXN_ID &&
+        changed->log_owner_ != txn->GetTransactionId()) {
+      AppendStagedLog(changed, page, prev_page);
+    }
+  }
+
+  log_record->prev_lsn_ = txn->GetPrevLSN();
+  if (!txn->IsLogStaging()) {
+    lsn_t lsn = AppendLogRecord(log_record);
+    for (Page *changed : {page, prev_page}) {
+      if (changed != nullptr) {
+        changed->SetLSN(lsn);
+      }
+    }
+    if (log_record->log_record_type_ == LogRecordType::BEGIN) {
+      txn->SetBeginLSN(lsn);
+    }
+    txn->SetPrevLSN(lsn);
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(txn->staged_log_latch_);
+  size_t size = log_record->size_;
+  if (!txn->staged_log_.empty() && txn->staged_log_size_ + size > STAGED_LOG_LIMIT) {
+    AppendStagedLog(txn);
+    SetStagedPageLSNs(txn, &lock, page, prev_page);
+    lock.lock();
+  }
+  txn->staged_log_.push_back({std::move(*log_record), page, prev_page});
+  txn->staged_log_size_ += size;
+  for (Page *changed : {page, prev_page}) {
+    if (changed != nullptr) {
+      changed->log_owner_ = txn->GetTransactionId();
+    }
+  }
+}
+
+void LogManager::StartLogStaging(Transaction *txn) {
+  std::scoped_lock lock(staging_txns_latch_);
+  staging_txns_[txn->GetTransactionId()] = txn;
+}
+
+void LogManager::FinishLogStaging(Transaction *txn) {
+  {
+    std::unique_lock<std::mutex> lock(txn->staged_log_latch_);
+    bool read_only = txn->GetPrevLSN() == INVALID_LSN &&
+                     std::all_of(txn->staged_log_.begin(), txn->staged_log_.end(),
+                                 [](const auto &staged) { return staged.page_ == nullptr; });
+    if (read_only) {
+      txn->staged_log_.clear();
+      txn->staged_log_size_ = 0;
+    } else {
+      AppendStagedLog(txn);
+    }
+    // The transaction holds no page latch anymore, so it can latch every page whose LSN is still missing.
+    SetStagedPageLSNs(txn, &lock, nullptr, nullptr);
+  }
+  // Only unregister once nothing is staged, a thread that misses the transaction relies on its pages being appended.
+  {
+    std::scoped_lock lock(staging_txns_latch_);
+    staging_txns_.erase(txn->GetTransactionId());
+  }
+  // Threads that looked up the transaction before may still hold its latch, wait for them before it can be deleted.
+  std::scoped_lock lock(txn->staged_log_latch_);
+}
+
+void LogManager::AppendStagedLog(Page *page, Page *latched_page, Page *latched_prev_page) {
+  txn_id_t owner = page->log_owner_;
+  if (owner == INVALID_TXN_ID) {
+    return;
+  }
+  Transaction *txn;
+  std::unique_lock<std::mutex> txn_lock;
+  {
+    std::scoped_lock lock(staging_txns_latch_);
+    auto it = staging_txns_.find(owner);
+    if (it == staging_txns_.end()) {
+      // The owner has finished in the meantime, so its records are in the log already.
+      return;
+    }
+    txn = it->second;
+    txn_lock = std::unique_lock<std::mutex>(txn->staged_log_latch_);
+  }
+  AppendStagedLog(txn);
+  SetStagedPageLSNs(txn, &txn_lock, latched_page, latched_prev_page);
+}
+
+void LogManager::AppendStagedLog(Transaction *txn) {
+  if (txn->staged_log_.empty()) {
+    return;
+  }
+  std::vector<LogRecord *> log_records;
+  log_records.reserve(txn->staged_log_.size());
+  for (auto &staged : txn->staged_log_) {
+    log_records.push_back(&staged.log_record_);
+  }
+  log_records.front()->prev_lsn_ = txn->GetPrevLSN();
+  AppendLogRecords(log_records.data(), log_records.size());
+
+  for (auto &staged : txn->staged_log_) {
+    for (Page *changed : {staged.page_, staged.prev_page_}) {
+      if (changed != nullptr) {
+        txn->staged_page_lsns_.emplace_back(changed, staged.log_record_.lsn_);
+      }
+    }
+    if (staged.log_record_.log_record_type_ == LogRecordType::BEGIN) {
+      txn->SetBeginLSN(staged.log_record_.lsn_);
+    }
+  }
+  txn->SetPrevLSN(log_records.back()->lsn_);
+  txn->staged_log_.clear();
+  txn->staged_log_size_ = 0;
+}
+
+void LogManager::SetStagedPageLSNs(Transaction *txn, std::unique_lock<std::mutex> *txn_lock, Page *latched_page,
+                                   Page *latched_prev_page) {
+  // Every page gets the LSN of the last record that changed it.
+  auto &page_lsns = txn->staged_page_lsns_;
+  std::sort(page_lsns.begin(), page_lsns.end());
+  std::vector<std::pair<Page *, lsn_t>> ready;
+  std::vector<std::pair<Page *, lsn_t>> deferred;
+  bool holds_latch = latched_page != nullptr || latched_prev_page != nullptr;
+  for (size_t i = 0; i < page_lsns.size(); i++) {
+    if (i + 1 < page_lsns.size() && page_lsns[i + 1].first == page_lsns[i].first) {
+      continue;
+    }
+    // Latching another page while holding one could deadlock with a thread that does the same the other way around.
+    Page *page = page_lsns[i].first;
+    bool can_latch = !holds_latch || page == latched_page || page == latched_prev_page;
+    (can_latch ? ready : deferred).push_back(page_lsns[i]);
+  }
+  page_lsns = std::move(deferred);
+  // A thread that holds the latch of one of the pages may be waiting for txn_lock, and the transaction may be deleted
+  // once it is released.
+  txn_id_t owner = txn->GetTransactionId();
+  txn_lock->unlock();
+
+  for (auto [page, lsn] : ready) {
+    bool latched = page == latched_page || page == latched_prev_page;
+    if (!latched) {
+      page->WLatch();
+    }
+    // Somebody may have changed the page after the owner's records were appended.
+    if (page->GetLSN() < lsn) {
+      page->SetLSN(lsn);
+    }
+    // The page LSN must be final before the page loses its owner, the buffer pool writes pages without an owner back
+    // as soon as their page LSN is durable.
+    txn_id_t expected = owner;
+    page->log_owner_.compare_exchange_strong(expected, INVALID_TXN_ID);
+    if (!latched) {
+      page->WUnlatch();
+    }
+  }
+}
+
+void LogManager::SerializeLogRecord(LogRecord *log_record, char *pos) {
+  // First, serialize the must have fields (20 bytes in total).
+  memcpy(pos, &log_record->size_, sizeof(int32_t));
+  memcpy(pos + 4, &log_record->lsn_, sizeof(lsn_t));
+  memcpy(pos + 8, &log_record->txn_id_, sizeof(txn_id_t));
+  memcpy(pos + 12, &log_record->prev_lsn_, sizeof(lsn_t));
+  memcpy(pos + 16, &log_record->log_record_type_, sizeof(LogRecordType));
+  pos += LogRecord::HEADER_SIZE;
+
+  // Then the payload, which depends on the type of the record.
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      memcpy(pos, &log_record->insert_rid_, sizeof(RID));
+      pos += sizeof(RID);
+      log_record->insert_tuple_.SerializeTo(pos);
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      memcpy(pos, &log_record->delete_rid_, sizeof(RID));
+      pos += sizeof(RID);
+      log_record->delete_tuple_.SerializeTo(pos);
+      break;
+    case LogRecordType::UPDATE:
+      memcpy(pos, &log_record->update_rid_, sizeof(RID));
+      pos += sizeof(RID);
+      log_record->old_tuple_.SerializeTo(pos);
+      pos += sizeof(int32_t) + log_record->old_tuple_.GetLength();
+      log_record->new_tuple_.SerializeTo(pos);
+      break;
+    case LogRecordType::NEWPAGE:
+      memcpy(pos, &log_record->prev_page_id_, sizeof(page_id_t));
+      memcpy(pos + sizeof(page_id_t), &log_record->page_id_, sizeof(page_id_t));
+      break;
+    case LogRecordType::CHECKPOINT_END: {
+      memcpy(pos, &log_record->redo_offset_, sizeof(int32_t));
+      pos += sizeof(int32_t);
+      auto txn_count = static_cast<int32_t>(log_record->active_txns_.size());
+      memcpy(pos, &txn_count, sizeof(int32_t));
+      pos += sizeof(int32_t);
+      for (const auto &[txn_id, last_lsn] : log_record->active_txns_) {
+        memcpy(pos, &txn_id, sizeof(txn_id_t));
+        memcpy(pos + sizeof(txn_id_t), &last_lsn, sizeof(lsn_t));
+        pos += sizeof(txn_id_t) + sizeof(lsn_t);
+      }
+      auto page_count = static_cast<int32_t>(log_record->dirty_pages_.size());
+      memcpy(pos, &page_count, sizeof(int32_t));
+      pos += sizeof(int32_t);
+      for (const auto &[page_id, rec_lsn] : log_record->dirty_pages_) {
+        memcpy(pos, &page_id, sizeof(page_id_t));
+        memcpy(pos + sizeof(page_id_t), &rec_lsn, sizeof(lsn_t));
+        pos += sizeof(page_id_t) + sizeof(lsn_t);
+      }
+      break;
+    }
+    default:
+      // BEGIN/COMMIT/ABORT/CHECKPOINT_BEGIN only consist of the header.
+      break;
+  }
+}
+
+int32_t LogManager::CompactPayloadSize(LogRecord *log_record) {
+  auto rid_size = [](const RID &rid) {
+    return VarintUtil::Size(rid.GetPageId()) + VarintUtil::Size(rid.GetSlotNum());
+  };
+  auto tuple_size = [](const Tuple &tuple) { return VarintUtil::Size(tuple.GetLength()) + tuple.GetLength(); };
+
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      return rid_size(log_record->insert_rid_) + tuple_size(log_record->insert_tuple_);
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      return rid_size(log_record->delete_rid_) + tuple_size(log_record->delete_tuple_);
+    case LogRecordType::UPDATE: {
+      log_record->ComputeUpdateRanges();
+      int32_t size = rid_size(log_record->update_rid_) + VarintUtil::Size(log_record->update_ranges_.size());
+      uint32_t prev_end = 0;
+      for (const auto &range : log_record->update_ranges_) {
+        size += VarintUtil::Size(range.offset_ - prev_end) + VarintUtil::Size(range.old_data_.size()) +
+                VarintUtil::Size(range.new_data_.size()) + range.old_data_.size() + range.new_data_.size();
+        prev_end = range.offset_ + range.old_data_.size();
+      }
+      return size;
+    }
+    case LogRecordType::NEWPAGE:
+      return VarintUtil::SignedSize(log_record->prev_page_id_) + VarintUtil::Size(log_record->page_id_);
+    case LogRecordType::CHECKPOINT_END: {
+      int32_t size = VarintUtil::Size(log_record->redo_offset_) + VarintUtil::Size(log_record->active_txns_.size()) +
+                     VarintUtil::Size(log_record->dirty_pages_.size());
+      for (const auto &[txn_id, last_lsn] : log_record->active_txns_) {
+        size += VarintUtil::SignedSize(txn_id) + VarintUtil::SignedSize(last_lsn);
+      }
+      for (const auto &[page_id, rec_lsn] : log_record->dirty_pages_) {
+        size += VarintUtil::Size(page_id) + VarintUtil::SignedSize(rec_lsn);
+      }
+      return size;
+    }
+    default:
+      return 0;
+  }
+}
+
+int32_t LogManager::CompactRecordSize(LogRecord *log_record, lsn_t lsn, int32_t payload_size) {
+  uint32_t prev_lsn_delta = log_record->prev_lsn_ == INVALID_LSN ? 0 : lsn - log_record->prev_lsn_;
+  int32_t length = VarintUtil::Size(lsn) + VarintUtil::SignedSize(log_record->txn_id_) +
+                   VarintUtil::Size(prev_lsn_delta) + 1 + payload_size;
+  return VarintUtil::Size(length) + length;
+}
+
+void LogManager::SerializeCompactLogRecord(LogRecord *log_record, int32_t payload_size, char *pos) {
+  uint32_t prev_lsn_delta = log_record->prev_lsn_ == INVALID_LSN ? 0 : log_record->lsn_ - log_record->prev_lsn_;
+  int32_t length = VarintUtil::Size(log_record->lsn_) + VarintUtil::SignedSize(log_record->txn_id_) +
+                   VarintUtil::Size(prev_lsn_delta) + 1 + payload_size;
+  pos = VarintUtil::Encode(length, pos);
+  pos = VarintUtil::Encode(log_record->lsn_, pos);
+  pos = VarintUtil::EncodeSigned(log_record->txn_id_, pos);
+  pos = VarintUtil::Encode(prev_lsn_delta, pos);
+  *pos++ = static_cast<char>(log_record->log_record_type_);
+
+  auto put_rid = [&](const RID &rid) {
+    pos = VarintUtil::Encode(rid.GetPageId(), pos);
+    pos = VarintUtil::Encode(rid.GetSlotNum(), pos);
+  };
+  auto put_bytes = [&](const char *data, uint32_t size) {
+    pos = VarintUtil::Encode(size, pos);
+    memcpy(pos, data, size);
+    pos += size;
+  };
+
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      put_rid(log_record->insert_rid_);
+      put_bytes(log_record->insert_tuple_.GetData(), log_record->insert_tuple_.GetLength());
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      put_rid(log_record->delete_rid_);
+      put_bytes(log_record->delete_tuple_.GetData(), log_record->delete_tuple_.GetLength());
+      break;
+    case LogRecordType::UPDATE: {
+      put_rid(log_record->update_rid_);
+      pos = VarintUtil::Encode(log_record->update_ranges_.size(), pos);
+      uint32_t prev_end = 0;
+      for (const auto &range : log_record->update_ranges_) {
+        pos = VarintUtil::Encode(range.offset_ - prev_end, pos);
+        pos = VarintUtil::Encode(range.old_data_.size(), pos);
+        pos = VarintUtil::Encode(range.new_data_.size(), pos);
+        memcpy(pos, range.old_data_.data(), range.old_data_.size());
+        pos += range.old_data_.size();
+        memcpy(pos, range.new_data_.data(), range.new_data_.size());
+        pos += range.new_data_.size();
+        prev_end = range.offset_ + range.old_data_.size();
+      }
+      break;
+    }
+    case LogRecordType::NEWPAGE:
+      pos = VarintUtil::EncodeSigned(log_record->prev_page_id_, pos);
+      pos = VarintUtil::Encode(log_record->page_id_, pos);
+      break;
+    case LogRecordType::CHECKPOINT_END:
+      pos = VarintUtil::Encode(log_record->redo_offset_, pos);
+      pos = VarintUtil::Encode(log_record->active_txns_.size(), pos);
+      for (const auto &[txn_id, last_lsn] : log_record->active_txns_) {
+        pos = VarintUtil::EncodeSigned(txn_id, pos);
+        pos = VarintUtil::EncodeSigned(last_lsn, pos);
+      }
+      pos = VarintUtil::Encode(log_record->dirty_pages_.size(), pos);
+      for (const auto &[page_id, rec_lsn] : log_record->dirty_pages_) {
+        pos = VarintUtil::Encode(page_id, pos);
+        pos = VarintUtil::EncodeSigned(rec_lsn, pos);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+void LogManager::WaitForPersistentLSN(lsn_t lsn) {
+  std::unique_lock<std::mutex> lock(latch_);
+  // Nothing beyond the last handed out LSN can ever become persistent (pages that are not table pages may not even
+  // store an LSN at the usual offset).
+  lsn = std::min(lsn, GetNextLSN() - 1);
+  while (persistent_lsn_ < lsn) {
+    if (flush_thread_running_) {
+      flush_requested_ = true;
+      cv_.notify_one();
+      flushed_cv_.wait(lock);
+    } else {
+      // Without the flush thread, the waiter writes the log itself.
+      SwapAndFlush(&lock);
+    }
+  }
+}
+
+void LogManager::Flush() { WaitForPersistentLSN(GetNextLSN() - 1); }
+
+void LogManager::RequestFlush() {
+  std::scoped_lock lock(latch_);
+  flush_requested_ = true;
+  cv_.notify_one();
+}
+
+void LogManager::ScheduleFlush(lsn_t lsn) {
+  std::scoped_lock lock(latch_);
+  // A pending deadline is never later than ours, so it covers this lsn as well.
+  if (persistent_lsn_ >= lsn || flush_deadline_ != std::chrono::steady_clock::time_point::max()) {
+    return;
+  }
+  flush_deadline_ = std::chrono::steady_clock::now() + async_commit_window;
+  cv_.notify_one();
+}
+
+int LogManager::GetLogOffset(lsn_t lsn) {
+  std::scoped_lock lock(latch_);
+  for (auto it = buffer_history_.rbegin(); it != buffer_history_.rend(); ++it) {
+    if (it->first <= lsn) {
+      return it->second;
+    }
+  }
+  // Older than anything we remember, the start of the log is always safe.
+  return 0;
+}
+
+void LogManager::FlushThreadLoop() {
+  std::unique_lock<std::mutex> lock(latch_);
+  while (flush_thread_running_) {
+    // Sleep until the timeout or until the deadline of an asynchronous commit, whichever comes first.
+    auto timeout = std::chrono::steady_clock::now() + log_timeout;
+    while (!flush_requested_ && flush_thread_running_ &&
+           std::chrono::steady_clock::now() < std::min(timeout, flush_deadline_)) {
+      cv_.wait_until(lock, std::min(timeout, flush_deadline_));
+    }
+    SwapAndFlush(&lock);
+  }
+  // Whatever was appended before shutdown still has to reach the disk.
+  SwapAndFlush(&lock);
+}
+
+void LogManager::SwapAndFlush(std::unique_lock<std::mutex> *lock) {
+  // flush_buffer_ is in use until the previous flush has written it.
+  flushed_cv_.wait(*lock, [&] { return !flushing_; });
+  flush_requested_ = false;
+  flush_deadline_ = std::chrono::steady_clock::time_point::max();
+  if ((reservation_.load() & 0xFFFFFFFF) == 0) {
+    return;
+  }
+
+  // Seal the buffer so that no more slots are handed out, then wait for the in-flight copies to finish.
+  uint64_t sealed = reservation_.fetch_or(SEALED);
+  auto flush_size = static_cast<uint32_t>(sealed & 0xFFFFFFFF);
+  auto next_lsn = static_cast<lsn_t>(sealed >> 32);
+  while (completed_bytes_.load() != flush_size) {
+    std::this_thread::yield();
+  }
+
+  std::swap(log_buffer_, flush_buffer_);
+  buffer_offset_ += static_cast<int>(flush_size);
+  buffer_history_.emplace_back(next_lsn, buffer_offset_);
+  if (buffer_history_.size() > BUFFER_HISTORY_SIZE) {
+    buffer_history_.pop_front();
+  }
+  completed_bytes_ = 0;
+  reservation_ = static_cast<uint64_t>(next_lsn) << 32;
+  // Appenders that were waiting for space can fill the fresh buffer while we write out the old one.
+  flushed_cv_.notify_all();
+
+  flushing_ = true;
+  lock->unlock();
+  disk_manager_->WriteLog(flush_buffer_, static_cast<int>(flush_size));
+  lock->lock();
+  flushing_ = false;
+
+  persistent_lsn_ = next_lsn - 1;
+  flushed_cv_.notify_all();
+}
 
 }  // namespace bustub
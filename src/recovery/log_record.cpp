@@ -0,0 +1,99 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// log_record.cpp
+//
+// Identification: src/recovery/log_record.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "recovery/log_record.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "common/macros.h"
+
+namespace bustub {
+
+void LogRecord::ComputeUpdateRanges() {
+  update_ranges_.clear();
+  const char *old_data = old_tuple_.GetData();
+  const char *new_data = new_tuple_.GetData();
+  uint32_t old_size = old_tuple_.GetLength();
+  uint32_t new_size = new_tuple_.GetLength();
+  auto bytes = [](const char *data, uint32_t begin, uint32_t end) {
+    return begin < end ? std::string(data + begin, end - begin) : std::string();
+  };
+
+  // Strip the common prefix and suffix, the changed bytes are somewhere in between.
+  uint32_t min_size = std::min(old_size, new_size);
+  uint32_t prefix = 0;
+  while (prefix < min_size && old_data[prefix] == new_data[prefix]) {
+    prefix++;
+  }
+  uint32_t suffix = 0;
+  while (suffix < min_size - prefix && old_data[old_size - 1 - suffix] == new_data[new_size - 1 - suffix]) {
+    suffix++;
+  }
+
+  // If the tuple changes its size (varchars), everything after the first change moves, so use a single range.
+  if (old_size != new_size) {
+    update_ranges_.push_back(
+        {prefix, bytes(old_data, prefix, old_size - suffix), bytes(new_data, prefix, new_size - suffix)});
+    return;
+  }
+
+  // Otherwise every changed run of bytes gets its own range, e.g. for each updated fixed-size column.
+  uint32_t end = old_size - suffix;
+  for (uint32_t i = prefix; i < end; i++) {
+    if (old_data[i] == new_data[i]) {
+      continue;
+    }
+    if (!update_ranges_.empty()) {
+      auto &last = update_ranges_.back();
+      uint32_t last_end = last.offset_ + last.old_data_.size();
+      if (i - last_end <= UPDATE_RANGE_MAX_GAP) {
+        last.old_data_.append(old_data + last_end, i + 1 - last_end);
+        last.new_data_.append(new_data + last_end, i + 1 - last_end);
+        continue;
+      }
+    }
+    update_ranges_.push_back({i, bytes(old_data, i, i + 1), bytes(new_data, i, i + 1)});
+  }
+}
+
+Tuple LogRecord::ApplyUpdateRanges(const Tuple &base, bool redo) const {
+  uint32_t size = base.GetLength();
+  for (const auto &range : update_ranges_) {
+    size = size - (redo ? range.old_data_.size() : range.new_data_.size()) +
+           (redo ? range.new_data_.size() : range.old_data_.size());
+  }
+
+  // Assemble the serialized form of the result, | size | data |, and let the tuple copy it.
+  std::vector<char> storage(sizeof(uint32_t) + size);
+  memcpy(storage.data(), &size, sizeof(uint32_t));
+  char *pos = storage.data() + sizeof(uint32_t);
+  uint32_t base_pos = 0;
+  for (const auto &range : update_ranges_) {
+    const std::string &from = redo ? range.old_data_ : range.new_data_;
+    const std::string &to = redo ? range.new_data_ : range.old_data_;
+    BUSTUB_ASSERT(range.offset_ >= base_pos && range.offset_ + from.size() <= base.GetLength(),
+                  "Update range out of the tuple.");
+    memcpy(pos, base.GetData() + base_pos, range.offset_ - base_pos);
+    pos += range.offset_ - base_pos;
+    memcpy(pos, to.data(), to.size());
+    pos += to.size();
+    base_pos = range.offset_ + from.size();
+  }
+  memcpy(pos, base.GetData() + base_pos, base.GetLength() - base_pos);
+
+  Tuple result;
+  result.DeserializeFrom(storage.data());
+  return result;
+}
+
+}  // namespace bustub
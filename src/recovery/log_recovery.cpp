@@ -12,6 +12,13 @@
 
 #include "recovery/log_recovery.h"
 
+#include <cstring>
+#include <queue>
+#include <string>
+#include <type_traits>
+
+#include "common/exception.h"
+#include "common/util/varint_util.h"
 #include "storage/page/table_page.h"
 
 namespace bustub {
@@ -20,7 +27,213 @@ namespace bustub {
  * @return: true means deserialize succeed, otherwise can't deserialize cause
  * incomplete log record
  */
-bool LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record) { return false; }
+bool LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record) {
+  if (disk_manager_->IsCompactLog()) {
+    return DeserializeCompactLogRecord(data, log_record);
+  }
+  memcpy(&log_record->size_, data, sizeof(int32_t));
+  // The log file is zero filled beyond its end, so an empty header marks the end of the log.
+  if (log_record->size_ < LogRecord::HEADER_SIZE) {
+    return false;
+  }
+  memcpy(&log_record->lsn_, data + 4, sizeof(lsn_t));
+  memcpy(&log_record->txn_id_, data + 8, sizeof(txn_id_t));
+  memcpy(&log_record->prev_lsn_, data + 12, sizeof(lsn_t));
+  memcpy(&log_record->log_record_type_, data + 16, sizeof(LogRecordType));
+  const char *pos = data + LogRecord::HEADER_SIZE;
+
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      memcpy(&log_record->insert_rid_, pos, sizeof(RID));
+      log_record->insert_tuple_.DeserializeFrom(pos + sizeof(RID));
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      memcpy(&log_record->delete_rid_, pos, sizeof(RID));
+      log_record->delete_tuple_.DeserializeFrom(pos + sizeof(RID));
+      break;
+    case LogRecordType::UPDATE:
+      memcpy(&log_record->update_rid_, pos, sizeof(RID));
+      pos += sizeof(RID);
+      log_record->old_tuple_.DeserializeFrom(pos);
+      pos += sizeof(int32_t) + log_record->old_tuple_.GetLength();
+      log_record->new_tuple_.DeserializeFrom(pos);
+      break;
+    case LogRecordType::NEWPAGE:
+      memcpy(&log_record->prev_page_id_, pos, sizeof(page_id_t));
+      memcpy(&log_record->page_id_, pos + sizeof(page_id_t), sizeof(page_id_t));
+      break;
+    case LogRecordType::CHECKPOINT_END: {
+      memcpy(&log_record->redo_offset_, pos, sizeof(int32_t));
+      pos += sizeof(int32_t);
+      int32_t txn_count;
+      memcpy(&txn_count, pos, sizeof(int32_t));
+      pos += sizeof(int32_t);
+      log_record->active_txns_.resize(txn_count);
+      for (auto &[txn_id, last_lsn] : log_record->active_txns_) {
+        memcpy(&txn_id, pos, sizeof(txn_id_t));
+        memcpy(&last_lsn, pos + sizeof(txn_id_t), sizeof(lsn_t));
+        pos += sizeof(txn_id_t) + sizeof(lsn_t);
+      }
+      int32_t page_count;
+      memcpy(&page_count, pos, sizeof(int32_t));
+      pos += sizeof(int32_t);
+      log_record->dirty_pages_.resize(page_count);
+      for (auto &[page_id, rec_lsn] : log_record->dirty_pages_) {
+        memcpy(&page_id, pos, sizeof(page_id_t));
+        memcpy(&rec_lsn, pos + sizeof(page_id_t), sizeof(lsn_t));
+        pos += sizeof(page_id_t) + sizeof(lsn_t);
+      }
+      break;
+    }
+    case LogRecordType::BEGIN:
+    case LogRecordType::COMMIT:
+    case LogRecordType::ABORT:
+    case LogRecordType::CHECKPOINT_BEGIN:
+      break;
+    default:
+      return false;
+  }
+  return true;
+}
+
+bool LogRecovery::DeserializeCompactLogRecord(const char *data, LogRecord *log_record) {
+  uint32_t length;
+  const char *pos = VarintUtil::Decode(data, data + VarintUtil::MAX_SIZE, &length);
+  if (pos == nullptr || length == 0) {
+    return false;
+  }
+  const char *end = pos + length;
+  log_record->size_ = static_cast<int32_t>(end - data);
+
+  // Every field is bounds checked against the record's length, a decoding failure leaves pos at nullptr.
+  auto get = [&](auto *value) {
+    uint32_t raw = 0;
+    pos = pos == nullptr ? nullptr : VarintUtil::Decode(pos, end, &raw);
+    *value = static_cast<std::remove_pointer_t<decltype(value)>>(raw);
+  };
+  auto get_signed = [&](int32_t *value) {
+    pos = pos == nullptr ? nullptr : VarintUtil::DecodeSigned(pos, end, value);
+  };
+  auto get_rid = [&](RID *rid) {
+    page_id_t page_id;
+    uint32_t slot_num;
+    get(&page_id);
+    get(&slot_num);
+    rid->Set(page_id, slot_num);
+  };
+  auto get_bytes = [&](uint32_t size) {
+    if (pos == nullptr || size > static_cast<uint32_t>(end - pos)) {
+      pos = nullptr;
+      return std::string();
+    }
+    std::string bytes(pos, size);
+    pos += size;
+    return bytes;
+  };
+  auto get_tuple = [&](Tuple *tuple) {
+    uint32_t size = 0;
+    get(&size);
+    std::string bytes = get_bytes(size);
+    if (pos != nullptr) {
+      // Tuples only deserialize from their own format, | size | data |.
+      bytes.insert(0, reinterpret_cast<const char *>(&size), sizeof(uint32_t));
+      tuple->DeserializeFrom(bytes.data());
+    }
+  };
+
+  uint32_t prev_lsn_delta = 0;
+  get(&log_record->lsn_);
+  get_signed(&log_record->txn_id_);
+  get(&prev_lsn_delta);
+  if (pos == nullptr || pos >= end) {
+    return false;
+  }
+  log_record->prev_lsn_ = prev_lsn_delta == 0 ? INVALID_LSN : log_record->lsn_ - static_cast<lsn_t>(prev_lsn_delta);
+  log_record->log_record_type_ = static_cast<LogRecordType>(*pos++);
+
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      get_rid(&log_record->insert_rid_);
+      get_tuple(&log_record->insert_tuple_);
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      get_rid(&log_record->delete_rid_);
+      get_tuple(&log_record->delete_tuple_);
+      break;
+    case LogRecordType::UPDATE: {
+      get_rid(&log_record->update_rid_);
+      uint32_t range_count = 0;
+      get(&range_count);
+      uint32_t prev_end = 0;
+      for (uint32_t i = 0; i < range_count && pos != nullptr; i++) {
+        uint32_t gap = 0;
+        uint32_t old_size = 0;
+        uint32_t new_size = 0;
+        get(&gap);
+        get(&old_size);
+        get(&new_size);
+        LogRecord::UpdateRange range{prev_end + gap, get_bytes(old_size), get_bytes(new_size)};
+        prev_end = range.offset_ + old_size;
+        log_record->update_ranges_.emplace_back(std::move(range));
+      }
+      log_record->update_diff_ = true;
+      break;
+    }
+    case LogRecordType::NEWPAGE:
+      get_signed(&log_record->prev_page_id_);
+      get(&log_record->page_id_);
+      break;
+    case LogRecordType::CHECKPOINT_END: {
+      uint32_t count = 0;
+      get(&log_record->redo_offset_);
+      get(&count);
+      for (uint32_t i = 0; i < count && pos != nullptr; i++) {
+        std::pair<txn_id_t, lsn_t> entry;
+        get_signed(&entry.first);
+        get_signed(&entry.second);
+        log_record->active_txns_.push_back(entry);
+      }
+      get(&count);
+      for (uint32_t i = 0; i < count && pos != nullptr; i++) {
+        std::pair<page_id_t, lsn_t> entry;
+        get(&entry.first);
+        get_signed(&entry.second);
+        log_record->dirty_pages_.push_back(entry);
+      }
+      break;
+    }
+    case LogRecordType::BEGIN:
+    case LogRecordType::COMMIT:
+    case LogRecordType::ABORT:
+    case LogRecordType::CHECKPOINT_BEGIN:
+      break;
+    default:
+      return false;
+  }
+  return pos == end;
+}
+
+int32_t LogRecovery::GetLogRecordSize(const char *data, int available) {
+  if (disk_manager_->IsCompactLog()) {
+    uint32_t length;
+    const char *pos = VarintUtil::Decode(data, data + std::min(available, VarintUtil::MAX_SIZE), &length);
+    if (pos == nullptr) {
+      return available < VarintUtil::MAX_SIZE ? -1 : 0;
+    }
+    return length == 0 ? 0 : static_cast<int32_t>(pos - data + length);
+  }
+  if (available < LogRecord::HEADER_SIZE) {
+    return -1;
+  }
+  int32_t size;
+  memcpy(&size, data, sizeof(int32_t));
+  // The log file is zero filled beyond its end, so an empty header marks the end of the log.
+  return size < LogRecord::HEADER_SIZE ? 0 : size;
+}
 
 /*
  *redo phase on TABLE PAGE level(table/table_page.h)
@@ -29,12 +242,307 @@ bool LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record)
  *LSN with log_record's sequence number, and also build active_txn_ table &
  *lsn_mapping_ table
  */
-void LogRecovery::Redo() {}
+void LogRecovery::Redo() {
+  std::vector<RedoQueue> queues(num_redo_workers_);
+  std::vector<std::thread> workers;
+  workers.reserve(num_redo_workers_ + 1);
+  for (auto &queue : queues) {
+    workers.emplace_back(&LogRecovery::RedoWorker, this, &queue);
+  }
+  PrefetchQueue prefetch_queue;
+  if (enable_prefetch_) {
+    workers.emplace_back(&LogRecovery::PrefetchWorker, this, &prefetch_queue);
+  }
+  num_prefetched_ = 0;
+  // Prefetching more pages than stay resident next to the workers' pins would only evict the earlier ones again.
+  size_t prefetch_window = buffer_pool_manager_->GetPoolSize() - num_redo_workers_;
+
+  // Start at the redo point of the last completed checkpoint, if there is one. Everything before it is either on
+  // disk already or belongs to a transaction that finished before the checkpoint.
+  offset_ = 0;
+  LogRecord checkpoint_end;
+  if (ReadCheckpointEnd(disk_manager_->ReadMasterRecord(), &checkpoint_end)) {
+    offset_ = checkpoint_end.redo_offset_;
+    for (const auto &[txn_id, last_lsn] : checkpoint_end.active_txns_) {
+      active_txn_[txn_id] = last_lsn;
+    }
+  }
+
+  bool end_of_log = false;
+  while (!end_of_log && disk_manager_->ReadLog(log_buffer_, LOG_BUFFER_SIZE, offset_)) {
+    std::vector<std::vector<RedoTask>> batches(num_redo_workers_);
+    std::vector<page_id_t> pages;
+    auto dispatch = [&](page_id_t page_id, const LogRecord &log_record) {
+      batches[page_id % num_redo_workers_].emplace_back(page_id, log_record);
+      pages.push_back(page_id);
+    };
+
+    int pos = 0;
+    while (pos < LOG_BUFFER_SIZE) {
+      int32_t size = GetLogRecordSize(log_buffer_ + pos, LOG_BUFFER_SIZE - pos);
+      if (size == 0) {
+        end_of_log = true;
+        break;
+      }
+      // The record continues in the next chunk, which is read starting at this record.
+      if (size < 0 || pos + size > LOG_BUFFER_SIZE) {
+        break;
+      }
+      LogRecord log_record;
+      if (!DeserializeLogRecord(log_buffer_ + pos, &log_record)) {
+        end_of_log = true;
+        break;
+      }
+      lsn_mapping_[log_record.lsn_] = offset_ + pos;
+      pos += size;
+
+      switch (log_record.log_record_type_) {
+        case LogRecordType::COMMIT:
+        case LogRecordType::ABORT:
+          active_txn_.erase(log_record.txn_id_);
+          continue;
+        case LogRecordType::CHECKPOINT_BEGIN:
+        case LogRecordType::CHECKPOINT_END:
+          continue;
+        case LogRecordType::INSERT:
+          dispatch(log_record.insert_rid_.GetPageId(), log_record);
+          break;
+        case LogRecordType::MARKDELETE:
+        case LogRecordType::APPLYDELETE:
+        case LogRecordType::ROLLBACKDELETE:
+          dispatch(log_record.delete_rid_.GetPageId(), log_record);
+          break;
+        case LogRecordType::UPDATE:
+          dispatch(log_record.update_rid_.GetPageId(), log_record);
+          break;
+        case LogRecordType::NEWPAGE:
+          dispatch(log_record.page_id_, log_record);
+          if (log_record.prev_page_id_ != INVALID_PAGE_ID) {
+            dispatch(log_record.prev_page_id_, log_record);
+          }
+          break;
+        default:
+          break;
+      }
+      active_txn_[log_record.txn_id_] = log_record.lsn_;
+    }
+    if (pos == 0) {
+      break;
+    }
+    offset_ += pos;
+
+    // The chunk has been scanned completely, so its pages can be read ahead of the workers in disk order.
+    if (enable_prefetch_ && !pages.empty()) {
+      std::sort(pages.begin(), pages.end());
+      pages.erase(std::unique(pages.begin(), pages.end()), pages.end());
+      pages.resize(std::min(pages.size(), prefetch_window));
+      prefetch_queue.Push(std::move(pages));
+    }
+    for (size_t i = 0; i < num_redo_workers_; i++) {
+      if (!batches[i].empty()) {
+        queues[i].Push(std::move(batches[i]));
+      }
+    }
+  }
+
+  for (auto &queue : queues) {
+    queue.Close();
+  }
+  prefetch_queue.Close();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+bool LogRecovery::ReadCheckpointEnd(int checkpoint_offset, LogRecord *checkpoint_end) {
+  if (checkpoint_offset < 0) {
+    return false;
+  }
+  // Other transactions keep logging during a fuzzy checkpoint, so the end record is somewhere after the begin record.
+  int offset = checkpoint_offset;
+  while (disk_manager_->ReadLog(log_buffer_, LOG_BUFFER_SIZE, offset)) {
+    int pos = 0;
+    while (pos < LOG_BUFFER_SIZE) {
+      int32_t size = GetLogRecordSize(log_buffer_ + pos, LOG_BUFFER_SIZE - pos);
+      if (size == 0) {
+        return false;
+      }
+      if (size < 0 || pos + size > LOG_BUFFER_SIZE) {
+        break;
+      }
+      LogRecord log_record;
+      if (!DeserializeLogRecord(log_buffer_ + pos, &log_record)) {
+        return false;
+      }
+      if (log_record.log_record_type_ == LogRecordType::CHECKPOINT_END) {
+        *checkpoint_end = std::move(log_record);
+        return true;
+      }
+      pos += size;
+    }
+    if (pos == 0) {
+      return false;
+    }
+    offset += pos;
+  }
+  return false;
+}
+
+void LogRecovery::RedoWorker(RedoQueue *queue) {
+  std::vector<RedoTask> batch;
+  while (queue->Pop(&batch)) {
+    for (auto &task : batch) {
+      RedoLogRecord(task.first, &task.second);
+    }
+  }
+}
+
+void LogRecovery::PrefetchWorker(PrefetchQueue *queue) {
+  std::vector<page_id_t> batch;
+  while (queue->Pop(&batch)) {
+    for (page_id_t page_id : batch) {
+      // A full buffer pool only means this page is read on demand later.
+      if (buffer_pool_manager_->FetchPage(page_id) != nullptr) {
+        buffer_pool_manager_->UnpinPage(page_id, false);
+        num_prefetched_++;
+      }
+    }
+  }
+}
+
+void LogRecovery::RedoLogRecord(page_id_t page_id, LogRecord *log_record) {
+  auto *page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+  BUSTUB_ASSERT(page != nullptr, "Out of frames during redo.");
+
+  // Linking the new page into its predecessor is idempotent, so it does not depend on the predecessor's LSN.
+  if (log_record->log_record_type_ == LogRecordType::NEWPAGE && page_id == log_record->prev_page_id_) {
+    bool link = page->GetNextPageId() == INVALID_PAGE_ID;
+    if (link) {
+      page->SetNextPageId(log_record->page_id_);
+    }
+    buffer_pool_manager_->UnpinPage(page_id, link);
+    return;
+  }
+
+  if (page->GetLSN() >= log_record->lsn_) {
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    return;
+  }
+
+  RID rid;
+  Tuple old_tuple;
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      page->InsertTuple(log_record->insert_tuple_, &rid, nullptr, nullptr, nullptr);
+      BUSTUB_ASSERT(rid == log_record->insert_rid_, "Redo must insert the tuple into its original slot.");
+      break;
+    case LogRecordType::MARKDELETE:
+      page->MarkDelete(log_record->delete_rid_, nullptr, nullptr);
+      break;
+    case LogRecordType::APPLYDELETE:
+      page->ApplyDelete(log_record->delete_rid_, nullptr, nullptr);
+      break;
+    case LogRecordType::ROLLBACKDELETE:
+      page->RollbackDelete(log_record->delete_rid_, nullptr, nullptr);
+      break;
+    case LogRecordType::UPDATE:
+      if (log_record->update_diff_) {
+        // The page holds the tuple as it was right before this update, which is what the ranges apply to.
+        page->GetTuple(log_record->update_rid_, &old_tuple);
+        log_record->new_tuple_ = log_record->ApplyUpdateRanges(old_tuple, true);
+      }
+      page->UpdateTuple(log_record->new_tuple_, &old_tuple, log_record->update_rid_, nullptr, nullptr);
+      break;
+    case LogRecordType::NEWPAGE:
+      page->Init(page_id, PAGE_SIZE, log_record->prev_page_id_, nullptr, nullptr);
+      break;
+    default:
+      break;
+  }
+  page->SetLSN(log_record->lsn_);
+  buffer_pool_manager_->UnpinPage(page_id, true);
+}
 
 /*
  *undo phase on TABLE PAGE level(table/table_page.h)
  *iterate through active txn map and undo each operation
  */
-void LogRecovery::Undo() {}
+void LogRecovery::Undo() {
+  // Undo the losers' records from the newest to the oldest, following each transaction's prev_lsn chain.
+  std::priority_queue<lsn_t> to_undo;
+  for (const auto &[txn_id, last_lsn] : active_txn_) {
+    to_undo.push(last_lsn);
+  }
+  while (!to_undo.empty()) {
+    lsn_t lsn = to_undo.top();
+    to_undo.pop();
+    // Only a BEGIN record can precede the redo point, if its transaction had not published it to the checkpoint yet.
+    if (lsn_mapping_.count(lsn) == 0) {
+      continue;
+    }
+    LogRecord log_record;
+    if (!disk_manager_->ReadLog(log_buffer_, LOG_BUFFER_SIZE, lsn_mapping_[lsn]) ||
+        !DeserializeLogRecord(log_buffer_, &log_record)) {
+      throw Exception(ExceptionType::INVALID, "cannot read log record to undo");
+    }
+    UndoLogRecord(&log_record);
+    if (log_record.prev_lsn_ != INVALID_LSN) {
+      to_undo.push(log_record.prev_lsn_);
+    }
+  }
+  active_txn_.clear();
+  lsn_mapping_.clear();
+}
+
+void LogRecovery::UndoLogRecord(LogRecord *log_record) {
+  page_id_t page_id;
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      page_id = log_record->insert_rid_.GetPageId();
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      page_id = log_record->delete_rid_.GetPageId();
+      break;
+    case LogRecordType::UPDATE:
+      page_id = log_record->update_rid_.GetPageId();
+      break;
+    default:
+      // Transaction boundaries have nothing to undo, and a new page is simply left empty in the table.
+      return;
+  }
+
+  auto *page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+  BUSTUB_ASSERT(page != nullptr, "Out of frames during undo.");
+  RID rid;
+  Tuple old_tuple;
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      page->ApplyDelete(log_record->insert_rid_, nullptr, nullptr);
+      break;
+    case LogRecordType::MARKDELETE:
+      page->RollbackDelete(log_record->delete_rid_, nullptr, nullptr);
+      break;
+    case LogRecordType::APPLYDELETE:
+      page->InsertTuple(log_record->delete_tuple_, &rid, nullptr, nullptr, nullptr);
+      break;
+    case LogRecordType::ROLLBACKDELETE:
+      page->MarkDelete(log_record->delete_rid_, nullptr, nullptr);
+      break;
+    case LogRecordType::UPDATE:
+      if (log_record->update_diff_) {
+        // Later updates of the same transaction have been undone already, so the page holds this update's result.
+        Tuple new_tuple;
+        page->GetTuple(log_record->update_rid_, &new_tuple);
+        log_record->old_tuple_ = log_record->ApplyUpdateRanges(new_tuple, false);
+      }
+      page->UpdateTuple(log_record->old_tuple_, &old_tuple, log_record->update_rid_, nullptr, nullptr);
+      break;
+    default:
+      break;
+  }
+  buffer_pool_manager_->UnpinPage(page_id, true);
+}
 
 }  // namespace bustub
@@ -10,9 +10,14 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
 #include <cassert>
+#include <cstdio>
 #include <cstring>
+#include <filesystem>
 #include <iostream>
 #include <mutex>  // NOLINT
 #include <string>
@@ -26,29 +31,66 @@ namespace bustub {
 
 static char *buffer_used;
 
+/** Force the written data of a file to disk, including the file size that tells where the log ends. */
+static bool SyncData(int fd) {
+#ifdef __linux__
+  return fdatasync(fd) == 0;
+#else
+  return fsync(fd) == 0;
+#endif
+}
+
 /**
  * Constructor: open/create a single database file & log file
  * @input db_file: database file name
  */
-DiskManager::DiskManager(const std::string &db_file)
-    : file_name_(db_file), num_flushes_(0), num_writes_(0), flush_log_(false), flush_log_f_(nullptr) {
+DiskManager::DiskManager(const std::string &db_file, int log_segment_size)
+    : log_segment_size_(log_segment_size),
+      file_name_(db_file),
+      num_flushes_(0),
+      num_writes_(0),
+      flush_log_(false),
+      flush_log_f_(nullptr) {
   std::string::size_type n = file_name_.rfind('.');
   if (n == std::string::npos) {
     LOG_DEBUG("wrong file format");
     return;
   }
   log_name_ = file_name_.substr(0, n) + ".log";
+  master_name_ = file_name_.substr(0, n) + ".ckpt";
 
-  log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
-  // directory or file does not exist
-  if (!log_io_.is_open()) {
-    log_io_.clear();
-    // create a new file
-    log_io_.open(log_name_, std::ios::binary | std::ios::trunc | std::ios::app | std::ios::out);
-    log_io_.close();
-    // reopen with original mode
-    log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
-    if (!log_io_.is_open()) {
+  std::ifstream log_control(log_name_, std::ios::binary | std::ios::in);
+  if (log_control.read(reinterpret_cast<char *>(&first_log_segment_), sizeof(int))) {
+    // The encoding of the log is fixed when it is created. Control files without it are from fixed-size logs.
+    char compact = 0;
+    compact_log_ = log_control.read(&compact, 1) && compact != 0;
+    // The log ends in the last segment that exists. Preallocation keeps the file size, so it tells how much was
+    // written.
+    int segment = first_log_segment_;
+    while (GetFileSize(GetLogSegmentName(segment)) >= 0) {
+      segment++;
+    }
+    log_size_ = segment == first_log_segment_
+                    ? first_log_segment_ * log_segment_size_
+                    : (segment - 1) * log_segment_size_ + GetFileSize(GetLogSegmentName(segment - 1));
+  } else {
+    // A new log, remove whatever segments are left over from an old one.
+    std::string::size_type slash = log_name_.rfind('/');
+    std::filesystem::path dir = slash == std::string::npos ? "." : log_name_.substr(0, slash);
+    std::string prefix = log_name_.substr(slash == std::string::npos ? 0 : slash + 1) + ".";
+    std::error_code ec;
+    for (const auto &entry : std::filesystem::directory_iterator(dir, ec)) {
+      std::string name = entry.path().filename().string();
+      if (name.compare(0, prefix.size(), prefix) == 0 &&
+          name.find_first_not_of("0123456789", prefix.size()) == std::string::npos) {
+        std::filesystem::remove(entry.path(), ec);
+      }
+    }
+    first_log_segment_ = 0;
+    log_size_ = 0;
+    compact_log_ = enable_compact_log;
+    WriteLogControl();
+    if (GetFileSize(log_name_) < 0) {
       throw Exception("can't open dblog file");
     }
   }
@@ -78,9 +120,19 @@ void DiskManager::ShutDown() {
     std::scoped_lock scoped_db_io_latch(db_io_latch_);
     db_io_.close();
   }
-  log_io_.close();
+  std::scoped_lock scoped_log_io_latch(log_io_latch_);
+  for (int *fd : {&log_write_fd_, &log_read_fd_}) {
+    if (*fd >= 0) {
+      close(*fd);
+      *fd = -1;
+    }
+  }
+  log_write_segment_ = -1;
+  log_read_segment_ = -1;
 }
 
+DiskManager::~DiskManager() { ShutDown(); }
+
 /**
  * Write the contents of the specified page into disk file
  */
@@ -100,6 +152,12 @@ void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
   db_io_.flush();
 }
 
+int DiskManager::GetNumPages() {
+  std::scoped_lock scoped_db_io_latch(db_io_latch_);
+  int size = GetFileSize(file_name_);
+  return size <= 0 ? 0 : (size + PAGE_SIZE - 1) / PAGE_SIZE;
+}
+
 /**
  * Read the contents of the specified page into the given memory area
  */
@@ -150,16 +208,22 @@ void DiskManager::WriteLog(char *log_data, int size) {
   }
 
   num_flushes_ += 1;
-  // sequence write
-  log_io_.write(log_data, size);
-
-  // check for I/O error
-  if (log_io_.bad()) {
-    LOG_DEBUG("I/O error while writing log");
-    return;
+  // sequence write, continuing in the next segment once the current one is full
+  std::scoped_lock scoped_log_io_latch(log_io_latch_);
+  while (size > 0) {
+    int segment = log_size_ / log_segment_size_;
+    int segment_offset = log_size_ % log_segment_size_;
+    int fd = OpenLogSegmentForWrite(segment);
+    int write_size = std::min(size, log_segment_size_ - segment_offset);
+    // The caller considers the records persistent once we return, so they must not stay in the OS cache.
+    if (fd < 0 || pwrite(fd, log_data, write_size, segment_offset) != write_size || !SyncData(fd)) {
+      LOG_DEBUG("I/O error while writing log");
+      return;
+    }
+    log_data += write_size;
+    size -= write_size;
+    log_size_ += write_size;
   }
-  // needs to flush to keep disk file in sync
-  log_io_.flush();
   flush_log_ = false;
 }
 
@@ -169,28 +233,105 @@ void DiskManager::WriteLog(char *log_data, int size) {
  * @return: false means already reach the end
  */
 bool DiskManager::ReadLog(char *log_data, int size, int offset) {
-  if (offset >= GetFileSize(log_name_)) {
-    // LOG_DEBUG("end of log file");
-    // LOG_DEBUG("file size is %d", GetFileSize(log_name_));
+  std::scoped_lock scoped_log_io_latch(log_io_latch_);
+  if (offset >= log_size_ || offset < first_log_segment_ * log_segment_size_) {
     return false;
   }
-  log_io_.seekp(offset);
-  log_io_.read(log_data, size);
-
-  if (log_io_.bad()) {
-    LOG_DEBUG("I/O error while reading log");
-    return false;
+  // Only the segments overlapping the requested range are opened.
+  int read_count = 0;
+  while (read_count < size && offset + read_count < log_size_) {
+    int segment = (offset + read_count) / log_segment_size_;
+    int segment_offset = (offset + read_count) % log_segment_size_;
+    if (log_read_segment_ != segment) {
+      if (log_read_fd_ >= 0) {
+        close(log_read_fd_);
+      }
+      log_read_fd_ = open(GetLogSegmentName(segment).c_str(), O_RDONLY);
+      log_read_segment_ = segment;
+    }
+    int read_size = std::min({size - read_count, log_segment_size_ - segment_offset, log_size_ - offset - read_count});
+    if (log_read_fd_ < 0 || pread(log_read_fd_, log_data + read_count, read_size, segment_offset) != read_size) {
+      LOG_DEBUG("I/O error while reading log");
+      return false;
+    }
+    read_count += read_size;
   }
   // if log file ends before reading "size"
-  int read_count = log_io_.gcount();
   if (read_count < size) {
-    log_io_.clear();
     memset(log_data + read_count, 0, size - read_count);
   }
 
   return true;
 }
 
+/**
+ * Returns the current size of the log file
+ */
+int DiskManager::GetLogFileSize() {
+  std::scoped_lock scoped_log_io_latch(log_io_latch_);
+  return log_size_;
+}
+
+/**
+ * Delete every log segment that ends at or before offset, recording the new first segment before deleting anything
+ */
+void DiskManager::TruncateLog(int offset) {
+  std::scoped_lock scoped_log_io_latch(log_io_latch_);
+  int old_first_segment = first_log_segment_;
+  first_log_segment_ = std::max(first_log_segment_, std::min(offset, log_size_) / log_segment_size_);
+  if (first_log_segment_ == old_first_segment) {
+    return;
+  }
+  WriteLogControl();
+  for (int segment = old_first_segment; segment < first_log_segment_; segment++) {
+    if (segment == log_read_segment_) {
+      close(log_read_fd_);
+      log_read_fd_ = -1;
+      log_read_segment_ = -1;
+    }
+    remove(GetLogSegmentName(segment).c_str());
+  }
+}
+
+/**
+ * Returns the number of log segments that have not been truncated and were created already
+ */
+int DiskManager::GetNumLogSegments() {
+  std::scoped_lock scoped_log_io_latch(log_io_latch_);
+  int count = 0;
+  for (int segment = first_log_segment_; GetFileSize(GetLogSegmentName(segment)) >= 0; segment++) {
+    count++;
+  }
+  return count;
+}
+
+/**
+ * Write the master record to a temporary file and rename it over the old one, so a crash leaves either the old or
+ * the new record behind
+ */
+void DiskManager::WriteMasterRecord(int checkpoint_offset) {
+  std::string tmp_name = master_name_ + ".tmp";
+  std::ofstream master_io(tmp_name, std::ios::binary | std::ios::trunc | std::ios::out);
+  master_io.write(reinterpret_cast<const char *>(&checkpoint_offset), sizeof(int));
+  master_io.close();
+  if (master_io.fail() || std::rename(tmp_name.c_str(), master_name_.c_str()) != 0) {
+    LOG_DEBUG("I/O error while writing master record");
+  }
+}
+
+/**
+ * Read the master record
+ * @return: -1 if there is no (complete) master record
+ */
+int DiskManager::ReadMasterRecord() {
+  std::ifstream master_io(master_name_, std::ios::binary | std::ios::in);
+  int checkpoint_offset;
+  if (!master_io.read(reinterpret_cast<char *>(&checkpoint_offset), sizeof(int))) {
+    return -1;
+  }
+  return checkpoint_offset;
+}
+
 /**
  * Returns number of flushes made so far
  */
@@ -206,6 +347,60 @@ int DiskManager::GetNumWrites() const { return num_writes_; }
  */
 bool DiskManager::GetFlushState() const { return flush_log_; }
 
+/**
+ * Private helper function to get the file name of a log segment
+ */
+std::string DiskManager::GetLogSegmentName(int segment) const { return log_name_ + "." + std::to_string(segment); }
+
+/**
+ * Private helper function to open the log segment that is appended to, the caller holds log_io_latch_
+ */
+int DiskManager::OpenLogSegmentForWrite(int segment) {
+  if (log_write_segment_ == segment) {
+    return log_write_fd_;
+  }
+  if (log_write_fd_ >= 0) {
+    close(log_write_fd_);
+  }
+  bool created = GetFileSize(GetLogSegmentName(segment)) < 0;
+  log_write_fd_ = open(GetLogSegmentName(segment).c_str(), O_WRONLY | O_CREAT, 0644);
+  log_write_segment_ = segment;
+#ifdef FALLOC_FL_KEEP_SIZE
+  // Reserve the space of the whole segment up front without changing the file size, which marks the end of the log.
+  if (created && log_write_fd_ >= 0 && fallocate(log_write_fd_, FALLOC_FL_KEEP_SIZE, 0, log_segment_size_) != 0) {
+    LOG_DEBUG("could not preallocate log segment");
+  }
+#endif
+  if (created && log_write_fd_ >= 0) {
+    // A synced segment is of no use if its directory entry is lost in a crash.
+    std::string::size_type slash = log_name_.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : log_name_.substr(0, slash);
+    int dir_fd = open(dir.c_str(), O_RDONLY);
+    if (dir_fd < 0 || fsync(dir_fd) != 0) {
+      LOG_DEBUG("could not sync the log directory");
+    }
+    if (dir_fd >= 0) {
+      close(dir_fd);
+    }
+  }
+  return log_write_fd_;
+}
+
+/**
+ * Private helper function to replace the log control file
+ */
+void DiskManager::WriteLogControl() {
+  std::string tmp_name = log_name_ + ".tmp";
+  std::ofstream log_control(tmp_name, std::ios::binary | std::ios::trunc | std::ios::out);
+  log_control.write(reinterpret_cast<const char *>(&first_log_segment_), sizeof(int));
+  char compact = compact_log_ ? 1 : 0;
+  log_control.write(&compact, 1);
+  log_control.close();
+  if (log_control.fail() || std::rename(tmp_name.c_str(), log_name_.c_str()) != 0) {
+    LOG_DEBUG("I/O error while writing log control file");
+  }
+}
+
 /**
  * Private helper function to get disk file size
  */
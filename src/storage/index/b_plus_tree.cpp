@@ -20,19 +20,32 @@
 namespace bustub {
 INDEX_TEMPLATE_ARGUMENTS
 BPLUSTREE_TYPE::BPlusTree(std::string name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
-                          int leaf_max_size, int internal_max_size)
+                          int leaf_max_size, int internal_max_size, page_id_t header_page_id)
     : index_name_(std::move(name)),
+      header_page_id_(header_page_id),
       root_page_id_(INVALID_PAGE_ID),
       buffer_pool_manager_(buffer_pool_manager),
       comparator_(comparator),
       leaf_max_size_(leaf_max_size),
       internal_max_size_(internal_max_size) {}
 
+/*
+ * Open an existing tree: load the root page id recorded in the header page
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::Open() {
+  auto *header_page = static_cast<HeaderPage *>(buffer_pool_manager_->FetchPage(header_page_id_));
+  if(!header_page->GetRootId(index_name_, &root_page_id_)){
+    root_page_id_ = INVALID_PAGE_ID;
+  }
+  buffer_pool_manager_->UnpinPage(header_page_id_, false);
+}
+
 /*
  * Helper function to decide whether current b+tree is empty
  */
 INDEX_TEMPLATE_ARGUMENTS
-bool BPLUSTREE_TYPE::IsEmpty() const { return true; }
+bool BPLUSTREE_TYPE::IsEmpty() const { return root_page_id_ == INVALID_PAGE_ID; }
 /*****************************************************************************
  * SEARCH
  *****************************************************************************/
@@ -44,9 +57,11 @@ bool BPLUSTREE_TYPE::IsEmpty() const { return true; }
 INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result, Transaction *transaction) {
   // std::cout<<"a\n";
+  tree_latch_.RLock();
   Page* page = FindLeafPage(key, false);
   // std::cout<<"b\n";
   if(page == nullptr){
+    tree_latch_.RUnlock();
     return false;
   }
   // std::cout<<"c\n";
@@ -60,6 +75,7 @@ bool BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result
     result->push_back(value);
   }
   buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  tree_latch_.RUnlock();
   return isExist;
 }
 
@@ -76,11 +92,14 @@ bool BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result
 INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transaction *transaction) {
   // std::cout<<"inserting\n"; 
+  tree_latch_.WLock();
   if(root_page_id_ == INVALID_PAGE_ID){
     StartNewTree(key, value);
+    tree_latch_.WUnlock();
     return true;
   }
   bool isInsert = InsertIntoLeaf(key, value, transaction);
+  tree_latch_.WUnlock();
   // std::cout<<"inserted\n"; 
   return isInsert;
 }
@@ -121,8 +140,7 @@ bool BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value,
   Page* page = FindLeafPage(key, false);
   LeafPage* leaf_page = reinterpret_cast<LeafPage*>(page->GetData());
   int key_index = leaf_page->KeyIndex(key, comparator_);
-  MappingType pair = leaf_page->GetItem(key_index);
-  if(comparator_(key, pair.first) == 0){
+  if(key_index < leaf_page->GetSize() && comparator_(key, leaf_page->KeyAt(key_index)) == 0){
     //duplicated
     buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
     return false;
@@ -252,7 +270,21 @@ void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node, const KeyType &ke
  * necessary.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {}
+void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {
+  tree_latch_.WLock();
+  Page* page = FindLeafPage(key, false);
+  if(page == nullptr){
+    tree_latch_.WUnlock();
+    return;
+  }
+  // Removal is lazy: underfull leaves are neither merged nor redistributed, so leaf pages are never freed and the
+  // leaf chain stays valid for iterators that do not hold a latch.
+  LeafPage* leaf_page = reinterpret_cast<LeafPage*>(page->GetData());
+  int old_size = leaf_page->GetSize();
+  bool isRemoved = leaf_page->RemoveAndDeleteRecord(key, comparator_) != old_size;
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), isRemoved);
+  tree_latch_.WUnlock();
+}
 
 /*
  * User needs to first find the sibling of input page. If sibling's size + input
@@ -321,7 +353,18 @@ bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) { return false; }
  * @return : index iterator
  */
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin() { return INDEXITERATOR_TYPE(); }
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin() {
+  tree_latch_.RLock();
+  Page* page = FindLeafPage(KeyType(), true);
+  if(page == nullptr){
+    tree_latch_.RUnlock();
+    return INDEXITERATOR_TYPE();
+  }
+  INDEXITERATOR_TYPE iterator(buffer_pool_manager_, &tree_latch_, reinterpret_cast<LeafPage*>(page->GetData()), 0);
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  tree_latch_.RUnlock();
+  return iterator;
+}
 
 /*
  * Input parameter is low key, find the leaf page that contains the input key
@@ -329,7 +372,19 @@ INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin() { return INDEXITERATOR_TYPE(); }
  * @return : index iterator
  */
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType &key) { return INDEXITERATOR_TYPE(); }
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType &key) {
+  tree_latch_.RLock();
+  Page* page = FindLeafPage(key, false);
+  if(page == nullptr){
+    tree_latch_.RUnlock();
+    return INDEXITERATOR_TYPE();
+  }
+  LeafPage* leaf_page = reinterpret_cast<LeafPage*>(page->GetData());
+  INDEXITERATOR_TYPE iterator(buffer_pool_manager_, &tree_latch_, leaf_page, leaf_page->KeyIndex(key, comparator_));
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  tree_latch_.RUnlock();
+  return iterator;
+}
 
 /*
  * Input parameter is void, construct an index iterator representing the end
@@ -375,7 +430,7 @@ Page *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost) {
 }
 
 /*
- * Update/Insert root page id in header page(where page_id = 0, header_page is
+ * Update/Insert root page id in header page (header_page_id_, page 0 by default; header_page is
  * defined under include/page/header_page.h)
  * Call this method everytime root page id is changed.
  * @parameter: insert_record      defualt value is false. When set to true,
@@ -384,7 +439,7 @@ Page *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost) {
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::UpdateRootPageId(int insert_record) {
-  HeaderPage *header_page = static_cast<HeaderPage *>(buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  HeaderPage *header_page = static_cast<HeaderPage *>(buffer_pool_manager_->FetchPage(header_page_id_));
   if (insert_record != 0) {
     // create a new record<index_name + root_page_id> in header_page
     header_page->InsertRecord(index_name_, root_page_id_);
@@ -392,7 +447,7 @@ void BPLUSTREE_TYPE::UpdateRootPageId(int insert_record) {
     // update root_page_id in header_page
     header_page->UpdateRecord(index_name_, root_page_id_);
   }
-  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
+  buffer_pool_manager_->UnpinPage(header_page_id_, true);
 }
 
 /*
@@ -558,4 +613,10 @@ template class BPlusTree<GenericKey<16>, RID, GenericComparator<16>>;
 template class BPlusTree<GenericKey<32>, RID, GenericComparator<32>>;
 template class BPlusTree<GenericKey<64>, RID, GenericComparator<64>>;
 
+template class BPlusTree<GenericRidKey<4>, RID, GenericRidComparator<4>>;
+template class BPlusTree<GenericRidKey<8>, RID, GenericRidComparator<8>>;
+template class BPlusTree<GenericRidKey<16>, RID, GenericRidComparator<16>>;
+template class BPlusTree<GenericRidKey<32>, RID, GenericRidComparator<32>>;
+template class BPlusTree<GenericRidKey<64>, RID, GenericRidComparator<64>>;
+
 }  // namespace bustub
@@ -11,51 +11,94 @@
 
 #include "storage/index/b_plus_tree_index.h"
 
+#include "storage/page/header_page.h"
+
 namespace bustub {
 /*
  * Constructor
  */
 INDEX_TEMPLATE_ARGUMENTS
-BPLUSTREE_INDEX_TYPE::BPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager)
+BPLUSTREE_INDEX_TYPE::BPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager,
+                                     page_id_t header_page_id)
     : Index(std::move(metadata)),
       comparator_(GetMetadata()->GetKeySchema()),
-      container_(GetMetadata()->GetName(), buffer_pool_manager, comparator_) {}
+      tree_comparator_(GetMetadata()->GetKeySchema()),
+      header_page_id_(header_page_id != INVALID_PAGE_ID ? header_page_id : NewHeaderPage(buffer_pool_manager)),
+      container_(GetMetadata()->GetName(), buffer_pool_manager, tree_comparator_, TREE_LEAF_SIZE, TREE_INTERNAL_SIZE,
+                 header_page_id_) {
+  if (header_page_id != INVALID_PAGE_ID) {
+    container_.Open();
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+page_id_t BPLUSTREE_INDEX_TYPE::NewHeaderPage(BufferPoolManager *buffer_pool_manager) {
+  // Each tree has a header page of its own, page 0 belongs to the catalog.
+  page_id_t header_page_id;
+  auto *header_page = reinterpret_cast<HeaderPage *>(buffer_pool_manager->NewPage(&header_page_id));
+  BUSTUB_ASSERT(header_page != nullptr, "Couldn't create a header page for the B+ tree.");
+  header_page->Init();
+  buffer_pool_manager->UnpinPage(header_page_id, true);
+  return header_page_id;
+}
 
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::InsertEntry(const Tuple &key, RID rid, Transaction *transaction) {
   // construct insert index key
-  KeyType index_key;
-  index_key.SetFromKey(key);
+  TreeKeyType index_key;
+  index_key.SetFromKey(key, rid);
 
   container_.Insert(index_key, rid, transaction);
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) {
-  // construct delete index key
-  KeyType index_key;
-  index_key.SetFromKey(key);
+  // construct delete index key, the rid picks the entry among those of the key
+  TreeKeyType index_key;
+  index_key.SetFromKey(key, rid);
 
   container_.Remove(index_key, transaction);
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) {
-  // construct scan index key
-  KeyType index_key;
-  index_key.SetFromKey(key);
+  ScanRange(&key, &key, result, transaction);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::ScanRange(const Tuple *low_key, const Tuple *high_key, std::vector<RID> *result,
+                                    Transaction *transaction) {
+  // The default rid sorts first, so the scan starts at the first entry of the low key.
+  TreeKeyType index_key;
+  if (low_key != nullptr) {
+    index_key.SetFromKey(*low_key, RID());
+  }
+  auto iterator = low_key != nullptr ? container_.Begin(index_key) : container_.Begin();
 
-  container_.GetValue(index_key, result, transaction);
+  KeyType high_index_key;
+  if (high_key != nullptr) {
+    high_index_key.SetFromKey(*high_key);
+  }
+  for (; !iterator.IsEnd(); ++iterator) {
+    if (high_key != nullptr && comparator_((*iterator).first.key_, high_index_key) > 0) {
+      break;
+    }
+    result->push_back((*iterator).second);
+  }
 }
 
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE BPLUSTREE_INDEX_TYPE::GetBeginIterator() { return container_.Begin(); }
+auto BPLUSTREE_INDEX_TYPE::GetBeginIterator() -> TreeIterator { return container_.Begin(); }
 
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE BPLUSTREE_INDEX_TYPE::GetBeginIterator(const KeyType &key) { return container_.Begin(key); }
+auto BPLUSTREE_INDEX_TYPE::GetBeginIterator(const KeyType &key) -> TreeIterator {
+  TreeKeyType index_key;
+  index_key.key_ = key;
+  return container_.Begin(index_key);
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE BPLUSTREE_INDEX_TYPE::GetEndIterator() { return container_.End(); }
+auto BPLUSTREE_INDEX_TYPE::GetEndIterator() -> TreeIterator { return container_.End(); }
 
 template class BPlusTreeIndex<GenericKey<4>, RID, GenericComparator<4>>;
 template class BPlusTreeIndex<GenericKey<8>, RID, GenericComparator<8>>;
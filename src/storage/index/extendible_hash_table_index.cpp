@@ -9,10 +9,10 @@ namespace bustub {
 template <typename KeyType, typename ValueType, typename KeyComparator>
 HASH_TABLE_INDEX_TYPE::ExtendibleHashTableIndex(std::unique_ptr<IndexMetadata> &&metadata,
                                                 BufferPoolManager *buffer_pool_manager,
-                                                const HashFunction<KeyType> &hash_fn)
+                                                const HashFunction<KeyType> &hash_fn, page_id_t directory_page_id)
     : Index(std::move(metadata)),
       comparator_(GetMetadata()->GetKeySchema()),
-      container_(GetMetadata()->GetName(), buffer_pool_manager, comparator_, hash_fn) {}
+      container_(GetMetadata()->GetName(), buffer_pool_manager, comparator_, hash_fn, directory_page_id) {}
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 void HASH_TABLE_INDEX_TYPE::InsertEntry(const Tuple &key, RID rid, Transaction *transaction) {
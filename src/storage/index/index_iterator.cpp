@@ -2,29 +2,75 @@
  * index_iterator.cpp
  */
 #include <cassert>
+#include <vector>
 
 #include "storage/index/index_iterator.h"
 
 namespace bustub {
 
-/*
- * NOTE: you can change the destructor/constructor method here
- * set your own input parameters
- */
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE::IndexIterator() = default;
 
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE::IndexIterator(BufferPoolManager *buffer_pool_manager, ReaderWriterLatch *tree_latch,
+                                  LeafPage *leaf, int index)
+    : buffer_pool_manager_(buffer_pool_manager), tree_latch_(tree_latch) {
+  CopyLeaf(leaf, index);
+  SkipEmptyLeaves();
+}
+
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE::~IndexIterator() = default;
 
 INDEX_TEMPLATE_ARGUMENTS
-bool INDEXITERATOR_TYPE::IsEnd() { throw std::runtime_error("unimplemented"); }
+bool INDEXITERATOR_TYPE::IsEnd() { return page_id_ == INVALID_PAGE_ID; }
+
+INDEX_TEMPLATE_ARGUMENTS
+const MappingType &INDEXITERATOR_TYPE::operator*() {
+  assert(!IsEnd());
+  return entries_[pos_];
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE &INDEXITERATOR_TYPE::operator++() {
+  assert(!IsEnd());
+  pos_++;
+  index_++;
+  SkipEmptyLeaves();
+  return *this;
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-const MappingType &INDEXITERATOR_TYPE::operator*() { throw std::runtime_error("unimplemented"); }
+void INDEXITERATOR_TYPE::CopyLeaf(LeafPage *leaf, int index) {
+  page_id_ = leaf->GetPageId();
+  index_ = index;
+  entries_.clear();
+  for (int i = index; i < leaf->GetSize(); i++) {
+    entries_.push_back(leaf->GetItem(i));
+  }
+  pos_ = 0;
+  next_page_id_ = leaf->GetNextPageId();
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE &INDEXITERATOR_TYPE::operator++() { throw std::runtime_error("unimplemented"); }
+void INDEXITERATOR_TYPE::SkipEmptyLeaves() {
+  while (pos_ >= entries_.size()) {
+    if (next_page_id_ == INVALID_PAGE_ID) {
+      page_id_ = INVALID_PAGE_ID;
+      index_ = 0;
+      entries_.clear();
+      pos_ = 0;
+      return;
+    }
+    // Leaves are never freed, so the next page id stays valid.
+    page_id_t page_id = next_page_id_;
+    tree_latch_->RLock();
+    auto *leaf = reinterpret_cast<LeafPage *>(buffer_pool_manager_->FetchPage(page_id)->GetData());
+    CopyLeaf(leaf, 0);
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    tree_latch_->RUnlock();
+  }
+}
 
 template class IndexIterator<GenericKey<4>, RID, GenericComparator<4>>;
 
@@ -36,4 +82,14 @@ template class IndexIterator<GenericKey<32>, RID, GenericComparator<32>>;
 
 template class IndexIterator<GenericKey<64>, RID, GenericComparator<64>>;
 
+template class IndexIterator<GenericRidKey<4>, RID, GenericRidComparator<4>>;
+
+template class IndexIterator<GenericRidKey<8>, RID, GenericRidComparator<8>>;
+
+template class IndexIterator<GenericRidKey<16>, RID, GenericRidComparator<16>>;
+
+template class IndexIterator<GenericRidKey<32>, RID, GenericRidComparator<32>>;
+
+template class IndexIterator<GenericRidKey<64>, RID, GenericRidComparator<64>>;
+
 }  // namespace bustub
@@ -317,4 +317,10 @@ template class BPlusTreeInternalPage<GenericKey<8>, page_id_t, GenericComparator
 template class BPlusTreeInternalPage<GenericKey<16>, page_id_t, GenericComparator<16>>;
 template class BPlusTreeInternalPage<GenericKey<32>, page_id_t, GenericComparator<32>>;
 template class BPlusTreeInternalPage<GenericKey<64>, page_id_t, GenericComparator<64>>;
+
+template class BPlusTreeInternalPage<GenericRidKey<4>, page_id_t, GenericRidComparator<4>>;
+template class BPlusTreeInternalPage<GenericRidKey<8>, page_id_t, GenericRidComparator<8>>;
+template class BPlusTreeInternalPage<GenericRidKey<16>, page_id_t, GenericRidComparator<16>>;
+template class BPlusTreeInternalPage<GenericRidKey<32>, page_id_t, GenericRidComparator<32>>;
+template class BPlusTreeInternalPage<GenericRidKey<64>, page_id_t, GenericRidComparator<64>>;
 }  // namespace bustub
@@ -52,7 +52,8 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::SetNextPageId(page_id_t next_page_id) { next_pa
 INDEX_TEMPLATE_ARGUMENTS
 int B_PLUS_TREE_LEAF_PAGE_TYPE::KeyIndex(const KeyType &key, const KeyComparator &comparator) const {
   int index = -1;
-  if(comparator(array_[GetSize() - 1].first, key) < 0){
+  // A leaf can be empty, removed keys are not merged away.
+  if(GetSize() == 0 || comparator(array_[GetSize() - 1].first, key) < 0){
     index = GetSize();
     return index;
   }
@@ -147,7 +148,7 @@ int B_PLUS_TREE_LEAF_PAGE_TYPE::Insert(const KeyType &key, const ValueType &valu
     IncreaseSize(1);
     return 1;
   }
-  if(comparator(key, KeyAt(index)) == 0){
+  if(index < GetSize() && comparator(key, KeyAt(index)) == 0){
     return GetSize();
   }
   for(int i = GetSize(); i > index; i--){
@@ -217,7 +218,7 @@ bool B_PLUS_TREE_LEAF_PAGE_TYPE::Lookup(const KeyType &key, ValueType *value, co
 INDEX_TEMPLATE_ARGUMENTS
 int B_PLUS_TREE_LEAF_PAGE_TYPE::RemoveAndDeleteRecord(const KeyType &key, const KeyComparator &comparator) { 
   int index = KeyIndex(key, comparator);
-  if((index == -1) || (index > GetSize())){
+  if((index == -1) || (index >= GetSize())){
     return GetSize();
   }
   if(comparator(key, array_[index].first) == 0){
@@ -294,4 +295,10 @@ template class BPlusTreeLeafPage<GenericKey<8>, RID, GenericComparator<8>>;
 template class BPlusTreeLeafPage<GenericKey<16>, RID, GenericComparator<16>>;
 template class BPlusTreeLeafPage<GenericKey<32>, RID, GenericComparator<32>>;
 template class BPlusTreeLeafPage<GenericKey<64>, RID, GenericComparator<64>>;
+
+template class BPlusTreeLeafPage<GenericRidKey<4>, RID, GenericRidComparator<4>>;
+template class BPlusTreeLeafPage<GenericRidKey<8>, RID, GenericRidComparator<8>>;
+template class BPlusTreeLeafPage<GenericRidKey<16>, RID, GenericRidComparator<16>>;
+template class BPlusTreeLeafPage<GenericRidKey<32>, RID, GenericRidComparator<32>>;
+template class BPlusTreeLeafPage<GenericRidKey<64>, RID, GenericRidComparator<64>>;
 }  // namespace bustub
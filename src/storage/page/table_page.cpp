@@ -17,16 +17,14 @@
 namespace bustub {
 
 void TablePage::Init(page_id_t page_id, uint32_t page_size, page_id_t prev_page_id, LogManager *log_manager,
-                     Transaction *txn) {
+                     Transaction *txn, Page *prev_page) {
   // Set the page ID.
   memcpy(GetData(), &page_id, sizeof(page_id));
-  // Log that we are creating a new page.
+  // Log that we are creating a new page. The record also covers the link from the previous page.
   if (enable_logging) {
     LogRecord log_record =
         LogRecord(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::NEWPAGE, prev_page_id, page_id);
-    lsn_t lsn = log_manager->AppendLogRecord(&log_record);
-    SetLSN(lsn);
-    txn->SetPrevLSN(lsn);
+    log_manager->AppendLogRecord(txn, &log_record, this, prev_page);
   }
   // Set the previous and next page IDs.
   SetPrevPageId(prev_page_id);
@@ -58,6 +56,17 @@ bool TablePage::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn, Lock
     return false;
   }
 
+  // Acquire an exclusive lock on the new tuple before it is there, the lock manager is nullptr if a coarser lock
+  // already covers it. This fails if the transaction was aborted, e.g. wounded, in the meantime.
+  if (enable_logging && lock_manager != nullptr) {
+    RID new_rid(GetTablePageId(), i);
+    BUSTUB_ASSERT(!txn->IsSharedLocked(new_rid) && !txn->IsExclusiveLocked(new_rid),
+                  "A new tuple should not be locked.");
+    if (!lock_manager->LockExclusive(txn, new_rid)) {
+      return false;
+    }
+  }
+
   // Otherwise we claim available free space..
   SetFreeSpacePointer(GetFreeSpacePointer() - tuple.size_);
   memcpy(GetData() + GetFreeSpacePointer(), tuple.data_, tuple.size_);
@@ -73,19 +82,13 @@ bool TablePage::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn, Lock
 
   // Write the log record.
   if (enable_logging) {
-    BUSTUB_ASSERT(!txn->IsSharedLocked(*rid) && !txn->IsExclusiveLocked(*rid), "A new tuple should not be locked.");
-    // Acquire an exclusive lock on the new tuple.
-    bool locked = lock_manager->LockExclusive(txn, *rid);
-    BUSTUB_ASSERT(locked, "Locking a new tuple should always work.");
     LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::INSERT, *rid, tuple);
-    lsn_t lsn = log_manager->AppendLogRecord(&log_record);
-    SetLSN(lsn);
-    txn->SetPrevLSN(lsn);
+    log_manager->AppendLogRecord(txn, &log_record, this);
   }
   return true;
 }
 
-bool TablePage::MarkDelete(const RID &rid, Transaction *txn, LockManager *lock_manager, LogManager *log_manager) {
+bool TablePage::MarkDelete(const RID &rid, Transaction *txn, LogManager *log_manager) {
   uint32_t slot_num = rid.GetSlotNum();
   // If the slot number is invalid, abort the transaction.
   if (slot_num >= GetTupleCount()) {
@@ -105,19 +108,9 @@ bool TablePage::MarkDelete(const RID &rid, Transaction *txn, LockManager *lock_m
   }
 
   if (enable_logging) {
-    // Acquire an exclusive lock, upgrading from a shared lock if necessary.
-    if (txn->IsSharedLocked(rid)) {
-      if (!lock_manager->LockUpgrade(txn, rid)) {
-        return false;
-      }
-    } else if (!txn->IsExclusiveLocked(rid) && !lock_manager->LockExclusive(txn, rid)) {
-      return false;
-    }
     Tuple dummy_tuple;
     LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::MARKDELETE, rid, dummy_tuple);
-    lsn_t lsn = log_manager->AppendLogRecord(&log_record);
-    SetLSN(lsn);
-    txn->SetPrevLSN(lsn);
+    log_manager->AppendLogRecord(txn, &log_record, this);
   }
 
   // Mark the tuple as deleted.
@@ -128,7 +121,7 @@ bool TablePage::MarkDelete(const RID &rid, Transaction *txn, LockManager *lock_m
 }
 
 bool TablePage::UpdateTuple(const Tuple &new_tuple, Tuple *old_tuple, const RID &rid, Transaction *txn,
-                            LockManager *lock_manager, LogManager *log_manager) {
+                            LogManager *log_manager) {
   BUSTUB_ASSERT(new_tuple.size_ > 0, "Cannot have empty tuples.");
   uint32_t slot_num = rid.GetSlotNum();
   // If the slot number is invalid, abort the transaction.
@@ -163,18 +156,8 @@ bool TablePage::UpdateTuple(const Tuple &new_tuple, Tuple *old_tuple, const RID
   old_tuple->allocated_ = true;
 
   if (enable_logging) {
-    // Acquire an exclusive lock, upgrading from shared if necessary.
-    if (txn->IsSharedLocked(rid)) {
-      if (!lock_manager->LockUpgrade(txn, rid)) {
-        return false;
-      }
-    } else if (!txn->IsExclusiveLocked(rid) && !lock_manager->LockExclusive(txn, rid)) {
-      return false;
-    }
     LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::UPDATE, rid, *old_tuple, new_tuple);
-    lsn_t lsn = log_manager->AppendLogRecord(&log_record);
-    SetLSN(lsn);
-    txn->SetPrevLSN(lsn);
+    log_manager->AppendLogRecord(txn, &log_record, this);
   }
 
   // Perform the update.
@@ -221,9 +204,7 @@ void TablePage::ApplyDelete(const RID &rid, Transaction *txn, LogManager *log_ma
     BUSTUB_ASSERT(txn->IsExclusiveLocked(rid), "We must own the exclusive lock!");
 
     LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::APPLYDELETE, rid, delete_tuple);
-    lsn_t lsn = log_manager->AppendLogRecord(&log_record);
-    SetLSN(lsn);
-    txn->SetPrevLSN(lsn);
+    log_manager->AppendLogRecord(txn, &log_record, this);
   }
 
   uint32_t free_space_pointer = GetFreeSpacePointer();
@@ -250,9 +231,7 @@ void TablePage::RollbackDelete(const RID &rid, Transaction *txn, LogManager *log
     BUSTUB_ASSERT(txn->IsExclusiveLocked(rid), "We must own an exclusive lock on the RID.");
     Tuple dummy_tuple;
     LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::ROLLBACKDELETE, rid, dummy_tuple);
-    lsn_t lsn = log_manager->AppendLogRecord(&log_record);
-    SetLSN(lsn);
-    txn->SetPrevLSN(lsn);
+    log_manager->AppendLogRecord(txn, &log_record, this);
   }
 
   uint32_t slot_num = rid.GetSlotNum();
@@ -265,35 +244,45 @@ void TablePage::RollbackDelete(const RID &rid, Transaction *txn, LogManager *log
   }
 }
 
-bool TablePage::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, LockManager *lock_manager) {
+bool TablePage::GetTuple(const RID &rid, Tuple *tuple) {
   // Get the current slot number.
   uint32_t slot_num = rid.GetSlotNum();
-  // If somehow we have more slots than tuples, abort the transaction.
+  // If somehow we have more slots than tuples, there is nothing to read.
   if (slot_num >= GetTupleCount()) {
-    if (enable_logging) {
-      txn->SetState(TransactionState::ABORTED);
-    }
     return false;
   }
   // Otherwise get the current tuple size too.
   uint32_t tuple_size = GetTupleSize(slot_num);
-  // If the tuple is deleted, abort the transaction.
+  // If the tuple is deleted, e.g. by a writer that committed while we waited for the lock, skip it.
   if (IsDeleted(tuple_size)) {
-    if (enable_logging) {
-      txn->SetState(TransactionState::ABORTED);
-    }
     return false;
   }
 
-  // Otherwise we have a valid tuple, try to acquire at least a shared lock.
-  if (enable_logging) {
-    if (!txn->IsSharedLocked(rid) && !txn->IsExclusiveLocked(rid) && !lock_manager->LockShared(txn, rid)) {
-      return false;
-    }
+  // Otherwise we have a valid tuple, the caller holds at least a shared lock on the RID. Copy the tuple data into our
+  // result.
+  CopyTuple(rid, tuple_size, tuple);
+  return true;
+}
+
+bool TablePage::ReadTuple(const RID &rid, Tuple *tuple) {
+  uint32_t slot_num = rid.GetSlotNum();
+  if (slot_num >= GetTupleCount()) {
+    return false;
   }
+  uint32_t tuple_size = GetTupleSize(slot_num);
+  if (IsDeleted(tuple_size)) {
+    return false;
+  }
+  // Also used to check the header of a file that may not be a database, so a slot must point into the page.
+  if (GetTupleOffsetAtSlot(slot_num) > PAGE_SIZE || tuple_size > PAGE_SIZE - GetTupleOffsetAtSlot(slot_num)) {
+    return false;
+  }
+  CopyTuple(rid, tuple_size, tuple);
+  return true;
+}
 
-  // At this point, we have at least a shared lock on the RID. Copy the tuple data into our result.
-  uint32_t tuple_offset = GetTupleOffsetAtSlot(slot_num);
+void TablePage::CopyTuple(const RID &rid, uint32_t tuple_size, Tuple *tuple) {
+  uint32_t tuple_offset = GetTupleOffsetAtSlot(rid.GetSlotNum());
   tuple->size_ = tuple_size;
   if (tuple->allocated_) {
     delete[] tuple->data_;
@@ -302,13 +291,12 @@ bool TablePage::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, LockMan
   memcpy(tuple->data_, GetData() + tuple_offset, tuple->size_);
   tuple->rid_ = rid;
   tuple->allocated_ = true;
-  return true;
 }
 
-bool TablePage::GetFirstTupleRid(RID *first_rid) {
+bool TablePage::GetFirstTupleRid(RID *first_rid, bool include_deleted) {
   // Find and return the first valid tuple.
   for (uint32_t i = 0; i < GetTupleCount(); ++i) {
-    if (!IsDeleted(GetTupleSize(i))) {
+    if (include_deleted || !IsDeleted(GetTupleSize(i))) {
       first_rid->Set(GetTablePageId(), i);
       return true;
     }
@@ -317,11 +305,11 @@ bool TablePage::GetFirstTupleRid(RID *first_rid) {
   return false;
 }
 
-bool TablePage::GetNextTupleRid(const RID &cur_rid, RID *next_rid) {
+bool TablePage::GetNextTupleRid(const RID &cur_rid, RID *next_rid, bool include_deleted) {
   BUSTUB_ASSERT(cur_rid.GetPageId() == GetTablePageId(), "Wrong table!");
   // Find and return the first valid tuple after our current slot number.
   for (auto i = cur_rid.GetSlotNum() + 1; i < GetTupleCount(); ++i) {
-    if (!IsDeleted(GetTupleSize(i))) {
+    if (include_deleted || !IsDeleted(GetTupleSize(i))) {
       next_rid->Set(GetTablePageId(), i);
       return true;
     }
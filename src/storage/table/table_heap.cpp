@@ -10,10 +10,14 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <cassert>
+#include <utility>
+#include <vector>
 
 #include "common/logger.h"
 #include "storage/table/table_heap.h"
+#include "type/value_factory.h"
 
 namespace bustub {
 
@@ -37,10 +41,15 @@ TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_m
 }
 
 bool TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) {
+  CheckWritable(txn);
   if (tuple.size_ + 32 > PAGE_SIZE) {  // larger than one page size
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
+  // The new tuple is locked under the page latch, which fails right away for an aborted transaction.
+  if (txn->GetState() == TransactionState::ABORTED || !LockTableForRow(txn, true)) {
+    return false;
+  }
 
   auto cur_page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(first_page_id_));
   if (cur_page == nullptr) {
@@ -51,7 +60,13 @@ bool TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) {
   cur_page->WLatch();
   // Insert into the first page with enough space. If no such page exists, create a new page and insert into that.
   // INVARIANT: cur_page is WLatched if you leave the loop normally.
-  while (!cur_page->InsertTuple(tuple, rid, txn, lock_manager_, log_manager_)) {
+  while (!InsertIntoPage(cur_page, tuple, rid, txn)) {
+    // The new tuple could not be locked.
+    if (txn->GetState() == TransactionState::ABORTED) {
+      cur_page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), true);
+      return false;
+    }
     auto next_page_id = cur_page->GetNextPageId();
     // If the next page is a valid page,
     if (next_page_id != INVALID_PAGE_ID) {
@@ -75,23 +90,46 @@ bool TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) {
       // Otherwise we were able to create a new page. We initialize it now.
       new_page->WLatch();
       cur_page->SetNextPageId(next_page_id);
-      new_page->Init(next_page_id, PAGE_SIZE, cur_page->GetTablePageId(), log_manager_, txn);
+      new_page->Init(next_page_id, PAGE_SIZE, cur_page->GetTablePageId(), log_manager_, txn, cur_page);
       cur_page->WUnlatch();
       buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), true);
       cur_page = new_page;
     }
   }
+  version_store_->RecordWrite(*rid, txn, std::nullopt);
+  if (change_log_.IsActive()) {
+    change_log_.Append(*rid, tuple, true, txn->GetTransactionId());
+  }
   // This line has caused most of us to double-take and "whoa double unlatch".
   // We are not, in fact, double unlatching. See the invariant above.
   cur_page->WUnlatch();
   buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), true);
   // Update the transaction's write set.
   txn->GetWriteSet()->emplace_back(*rid, WType::INSERT, Tuple{}, this);
+  TrackRowLock(txn, *rid);
   return true;
 }
 
+bool TableHeap::InsertIntoPage(TablePage *page, const Tuple &tuple, RID *rid, Transaction *txn) {
+  try {
+    return page->InsertTuple(tuple, rid, txn, GetRowLockManager(page->GetTablePageId(), txn, true), log_manager_);
+  } catch (TransactionAbortException &e) {
+    // Waiting for the lock of the new tuple was aborted, do not leave the page latched and pinned.
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetTablePageId(), true);
+    throw;
+  }
+}
+
 bool TableHeap::MarkDelete(const RID &rid, Transaction *txn) {
+  CheckWritable(txn);
+  if (BuffersWrites(txn)) {
+    return BufferWrite(rid, WType::DELETE, Tuple{}, txn);
+  }
   // TODO(Amadou): remove empty page
+  if (!LockTableForRow(txn, true) || !LockRow(txn, rid, LockMode::EXCLUSIVE)) {
+    return false;
+  }
   // Find the page which contains the tuple.
   auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
   // If the page could not be found, then abort the transaction.
@@ -101,15 +139,40 @@ bool TableHeap::MarkDelete(const RID &rid, Transaction *txn) {
   }
   // Otherwise, mark the tuple as deleted.
   page->WLatch();
-  page->MarkDelete(rid, txn, lock_manager_, log_manager_);
+  if (!version_store_->CanWrite(rid, txn)) {
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetTablePageId(), false);
+    txn->SetState(TransactionState::ABORTED);
+    return false;
+  }
+  Tuple old_tuple;
+  page->ReadTuple(rid, &old_tuple);
+  bool is_deleted = page->MarkDelete(rid, txn, log_manager_);
+  if (is_deleted) {
+    version_store_->RecordWrite(rid, txn, old_tuple);
+    if (change_log_.IsActive()) {
+      change_log_.Append(rid, old_tuple, false, txn->GetTransactionId());
+    }
+  }
   page->WUnlatch();
-  buffer_pool_manager_->UnpinPage(page->GetTablePageId(), true);
-  // Update the transaction's write set.
-  txn->GetWriteSet()->emplace_back(rid, WType::DELETE, Tuple{}, this);
-  return true;
+  buffer_pool_manager_->UnpinPage(page->GetTablePageId(), is_deleted);
+  // Update the transaction's write set, a failed delete must not be rolled back.
+  if (is_deleted) {
+    txn->GetWriteSet()->emplace_back(rid, WType::DELETE, Tuple{}, this);
+    txn->GetDeltaSet()->erase(rid);
+  }
+  TrackRowLock(txn, rid);
+  return is_deleted;
 }
 
 bool TableHeap::UpdateTuple(const Tuple &tuple, const RID &rid, Transaction *txn) {
+  CheckWritable(txn);
+  if (BuffersWrites(txn)) {
+    return BufferWrite(rid, WType::UPDATE, tuple, txn);
+  }
+  if (!LockTableForRow(txn, true) || !LockRow(txn, rid, LockMode::EXCLUSIVE)) {
+    return false;
+  }
   // Find the page which contains the tuple.
   auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
   // If the page could not be found, then abort the transaction.
@@ -120,23 +183,134 @@ bool TableHeap::UpdateTuple(const Tuple &tuple, const RID &rid, Transaction *txn
   // Update the tuple; but first save the old value for rollbacks.
   Tuple old_tuple;
   page->WLatch();
-  bool is_updated = page->UpdateTuple(tuple, &old_tuple, rid, txn, lock_manager_, log_manager_);
+  // A rollback restores the transaction's own write, which is always allowed.
+  if (txn->GetState() != TransactionState::ABORTED && !version_store_->CanWrite(rid, txn)) {
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetTablePageId(), false);
+    txn->SetState(TransactionState::ABORTED);
+    return false;
+  }
+  bool is_updated = page->UpdateTuple(tuple, &old_tuple, rid, txn, log_manager_);
+  if (is_updated) {
+    version_store_->RecordWrite(rid, txn, old_tuple);
+  }
+  if (is_updated && change_log_.IsActive()) {
+    change_log_.Append(rid, old_tuple, false, txn->GetTransactionId());
+    change_log_.Append(rid, tuple, true, txn->GetTransactionId());
+  }
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetTablePageId(), is_updated);
   // Update the transaction's write set.
   if (is_updated && txn->GetState() != TransactionState::ABORTED) {
     txn->GetWriteSet()->emplace_back(rid, WType::UPDATE, old_tuple, this);
+    // The new tuple replaces the increments of the transaction that are not applied yet.
+    txn->GetDeltaSet()->erase(rid);
   }
+  TrackRowLock(txn, rid);
   return is_updated;
 }
 
+bool TableHeap::IncrementTuple(const RID &rid, const Schema &schema,
+                               const std::vector<std::pair<uint32_t, int32_t>> &deltas, Transaction *txn) {
+  CheckWritable(txn);
+  TableDeltaRecord record(this, &schema);
+  record.deltas_ = deltas;
+  // Snapshot readers validate their writes against the versions, so they read, add and write the tuple instead.
+  if (txn->ReadsSnapshot()) {
+    Tuple tuple;
+    return GetTuple(rid, &tuple, txn) && UpdateTuple(AddDeltas(tuple, record), rid, txn);
+  }
+  if (!LockTableForRow(txn, true) || !LockRow(txn, rid, LockMode::INCREMENT)) {
+    return false;
+  }
+  auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
+  if (page == nullptr) {
+    txn->SetState(TransactionState::ABORTED);
+    return false;
+  }
+  Tuple tuple;
+  page->RLatch();
+  bool exists = page->ReadTuple(rid, &tuple);
+  page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(rid.GetPageId(), false);
+  auto delta_set = txn->GetDeltaSet();
+  auto it = delta_set->find(rid);
+  if (exists && it == delta_set->end()) {
+    delta_set->emplace(rid, std::move(record));
+  } else if (exists) {
+    // Increments of the same column add up.
+    auto &column_deltas = it->second.deltas_;
+    for (const auto &[column, delta] : deltas) {
+      auto column_delta = std::find_if(column_deltas.begin(), column_deltas.end(),
+                                       [column = column](const auto &other) { return other.first == column; });
+      if (column_delta != column_deltas.end()) {
+        column_delta->second += delta;
+      } else {
+        column_deltas.emplace_back(column, delta);
+      }
+    }
+  }
+  TrackRowLock(txn, rid);
+  return exists;
+}
+
+void TableHeap::ApplyDelta(const RID &rid, const TableDeltaRecord &record, Transaction *txn) {
+  auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
+  BUSTUB_ASSERT(page != nullptr, "Couldn't find a page containing that RID.");
+  page->WLatch();
+  // The increment lock of the transaction keeps other writers away, so no row lock is needed.
+  Tuple old_tuple;
+  Tuple new_tuple;
+  bool is_updated = page->ReadTuple(rid, &old_tuple);
+  if (is_updated) {
+    new_tuple = AddDeltas(old_tuple, record);
+    is_updated = page->UpdateTuple(new_tuple, &old_tuple, rid, txn, log_manager_);
+  }
+  if (is_updated) {
+    version_store_->RecordWrite(rid, txn, old_tuple);
+    if (change_log_.IsActive()) {
+      change_log_.Append(rid, old_tuple, false, txn->GetTransactionId());
+      change_log_.Append(rid, new_tuple, true, txn->GetTransactionId());
+    }
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page->GetTablePageId(), is_updated);
+  if (is_updated) {
+    txn->GetWriteSet()->emplace_back(rid, WType::UPDATE, old_tuple, this);
+  }
+}
+
+Tuple TableHeap::AddDeltas(const Tuple &tuple, const TableDeltaRecord &record) {
+  const Schema *schema = record.schema_;
+  std::vector<Value> values;
+  values.reserve(schema->GetColumnCount());
+  for (uint32_t idx = 0; idx < schema->GetColumnCount(); idx++) {
+    values.push_back(tuple.GetValue(schema, idx));
+  }
+  for (const auto &[column, delta] : record.deltas_) {
+    values[column] = values[column].Add(ValueFactory::GetIntegerValue(delta));
+  }
+  Tuple result(values, schema);
+  result.rid_ = tuple.rid_;
+  return result;
+}
+
 void TableHeap::ApplyDelete(const RID &rid, Transaction *txn) {
   // Find the page which contains the tuple.
   auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
   BUSTUB_ASSERT(page != nullptr, "Couldn't find a page containing that RID.");
   // Delete the tuple from the page.
   page->WLatch();
+  // A tuple that is still visible is a rolled back insert, a committed delete was already recorded by MarkDelete.
+  Tuple old_tuple;
+  if (change_log_.IsActive() && page->ReadTuple(rid, &old_tuple)) {
+    change_log_.Append(rid, old_tuple, false, txn->GetTransactionId());
+  }
   page->ApplyDelete(rid, txn, log_manager_);
+  // Rolling back an insert frees the slot for other inserts, so its version must go while the page is latched.
+  if (txn->GetState() == TransactionState::ABORTED) {
+    version_store_->Abort(rid, txn);
+  }
   lock_manager_->Unlock(txn, rid);
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetTablePageId(), true);
@@ -149,11 +323,24 @@ void TableHeap::RollbackDelete(const RID &rid, Transaction *txn) {
   // Rollback the delete.
   page->WLatch();
   page->RollbackDelete(rid, txn, log_manager_);
+  Tuple tuple;
+  if (change_log_.IsActive() && page->ReadTuple(rid, &tuple)) {
+    change_log_.Append(rid, tuple, true, txn->GetTransactionId());
+  }
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetTablePageId(), true);
 }
 
-bool TableHeap::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn) {
+bool TableHeap::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, LockMode row_mode) {
+  if (txn != nullptr && BuffersWrites(txn)) {
+    return GetOptimisticTuple(rid, tuple, txn);
+  }
+  if (txn != nullptr && txn->ReadsSnapshot()) {
+    return GetSnapshotTuple(rid, tuple, txn);
+  }
+  if (!LockTableForRow(txn, row_mode != LockMode::SHARED) || !LockRow(txn, rid, row_mode)) {
+    return false;
+  }
   // Find the page which contains the tuple.
   auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
   // If the page could not be found, then abort the transaction.
@@ -163,22 +350,140 @@ bool TableHeap::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn) {
   }
   // Read the tuple from the page.
   page->RLatch();
-  bool res = page->GetTuple(rid, tuple, txn, lock_manager_);
+  bool res = page->GetTuple(rid, tuple);
+  page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(rid.GetPageId(), false);
+  TrackRowLock(txn, rid);
+  // The transaction sees its own increments.
+  if (res && txn != nullptr && txn->GetDeltaSet() != nullptr && !txn->GetDeltaSet()->empty()) {
+    auto it = txn->GetDeltaSet()->find(rid);
+    if (it != txn->GetDeltaSet()->end() && it->second.table_ == this) {
+      *tuple = AddDeltas(*tuple, it->second);
+    }
+  }
+  return res;
+}
+
+bool TableHeap::GetSnapshotTuple(const RID &rid, Tuple *tuple, Transaction *txn) {
+  auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
+  if (page == nullptr) {
+    txn->SetState(TransactionState::ABORTED);
+    return false;
+  }
+  // Writers change the page and the version store under the write latch, so the two are consistent here.
+  page->RLatch();
+  bool exists = page->ReadTuple(rid, tuple);
+  bool res = version_store_->GetVisible(rid, txn, tuple, exists);
   page->RUnlatch();
   buffer_pool_manager_->UnpinPage(rid.GetPageId(), false);
   return res;
 }
 
-TableIterator TableHeap::Begin(Transaction *txn) {
+bool TableHeap::GetOptimisticTuple(const RID &rid, Tuple *tuple, Transaction *txn) {
+  // The transaction sees its own writes, the latest first.
+  auto buffered_writes = txn->GetBufferedWriteSet();
+  for (auto it = buffered_writes->rbegin(); it != buffered_writes->rend(); ++it) {
+    if (it->table_ == this && it->rid_ == rid) {
+      if (it->wtype_ == WType::DELETE) {
+        return false;
+      }
+      *tuple = it->tuple_;
+      tuple->rid_ = rid;
+      return true;
+    }
+  }
+  (*txn->GetReadSet())[this].emplace(rid);
+  return GetSnapshotTuple(rid, tuple, txn);
+}
+
+bool TableHeap::BufferWrite(const RID &rid, WType wtype, const Tuple &tuple, Transaction *txn) {
+  // Reading the tuple first also validates the write, nobody else may have written it when the transaction commits.
+  Tuple current;
+  if (!GetOptimisticTuple(rid, &current, txn)) {
+    return false;
+  }
+  txn->GetBufferedWriteSet()->emplace_back(rid, wtype, tuple, this);
+  return true;
+}
+
+void TableHeap::CheckWritable(Transaction *txn) {
+  if (txn->IsReadOnly()) {
+    txn->SetState(TransactionState::ABORTED);
+    throw TransactionAbortException(txn->GetTransactionId(), AbortReason::WRITE_ON_READ_ONLY);
+  }
+}
+
+LockManager *TableHeap::GetRowLockManager(page_id_t page_id, Transaction *txn, LockMode row_mode) {
+  if (txn == nullptr) {
+    return lock_manager_;
+  }
+  if (table_oid_.has_value()) {
+    auto table_locks = txn->GetTableLockSet();
+    auto it = table_locks->find(*table_oid_);
+    if (it != table_locks->end() && LockManager::Covers(it->second, row_mode)) {
+      return nullptr;
+    }
+  }
+  auto page_locks = txn->GetPageLockSet();
+  auto it = page_locks->find(page_id);
+  if (it != page_locks->end() && LockManager::Covers(it->second, row_mode)) {
+    return nullptr;
+  }
+  return lock_manager_;
+}
+
+bool TableHeap::LockTableForRow(Transaction *txn, bool write) {
+  // Rows are only locked when logging is enabled, see TablePage.
+  if (!enable_logging || lock_manager_ == nullptr || txn == nullptr || !table_oid_.has_value()) {
+    return true;
+  }
+  // A rollback writes under the lock the aborted transaction already holds.
+  LockMode lock_mode = write ? LockMode::INTENTION_EXCLUSIVE : LockMode::INTENTION_SHARED;
+  auto table_locks = txn->GetTableLockSet();
+  auto it = table_locks->find(*table_oid_);
+  if (it != table_locks->end() && LockManager::Covers(it->second, lock_mode)) {
+    return true;
+  }
+  return lock_manager_->LockTable(txn, lock_mode, *table_oid_);
+}
+
+bool TableHeap::LockRow(Transaction *txn, const RID &rid, LockMode row_mode) {
+  // Rows are only locked when logging is enabled, see TablePage.
+  if (!enable_logging || txn == nullptr) {
+    return true;
+  }
+  LockManager *lock_manager = GetRowLockManager(rid.GetPageId(), txn, row_mode);
+  if (lock_manager == nullptr || txn->IsExclusiveLocked(rid)) {
+    return true;
+  }
+  if (row_mode == LockMode::SHARED) {
+    return txn->IsSharedLocked(rid) || lock_manager->LockShared(txn, rid);
+  }
+  // Incrementers do not wait for each other. An increment on top of a shared lock is exclusive.
+  if (row_mode == LockMode::INCREMENT) {
+    return lock_manager->LockIncrement(txn, rid);
+  }
+  // Acquire an exclusive lock, upgrading from a shared lock if necessary.
+  return txn->IsSharedLocked(rid) ? lock_manager->LockUpgrade(txn, rid) : lock_manager->LockExclusive(txn, rid);
+}
+
+void TableHeap::TrackRowLock(Transaction *txn, const RID &rid) {
+  if (enable_logging && lock_manager_ != nullptr && txn != nullptr && table_oid_.has_value()) {
+    lock_manager_->TrackRowLock(txn, *table_oid_, rid);
+  }
+}
+
+TableIterator TableHeap::Begin(Transaction *txn, LockMode row_mode) {
   // Start an iterator from the first page.
   // TODO(Wuwen): Hacky fix for now. Removing empty pages is a better way to handle this.
   RID rid;
   auto page_id = first_page_id_;
+  bool snapshot = txn != nullptr && txn->ReadsSnapshot();
   while (page_id != INVALID_PAGE_ID) {
     auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
     page->RLatch();
     // If this fails because there is no tuple, then RID will be the default-constructed value, which means EOF.
-    auto found_tuple = page->GetFirstTupleRid(&rid);
+    auto found_tuple = page->GetFirstTupleRid(&rid, snapshot);
     page->RUnlatch();
     buffer_pool_manager_->UnpinPage(page_id, false);
     if (found_tuple) {
@@ -186,7 +491,7 @@ TableIterator TableHeap::Begin(Transaction *txn) {
     }
     page_id = page->GetNextPageId();
   }
-  return TableIterator(this, rid, txn);
+  return TableIterator(this, rid, txn, row_mode);
 }
 
 TableIterator TableHeap::End() { return TableIterator(this, RID(INVALID_PAGE_ID, 0), nullptr); }
@@ -16,10 +16,10 @@
 
 namespace bustub {
 
-TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn)
-    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn) {
+TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn, LockMode row_mode)
+    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn), row_mode_(row_mode) {
   if (rid.GetPageId() != INVALID_PAGE_ID) {
-    table_heap_->GetTuple(tuple_->rid_, tuple_, txn_);
+    SkipUnreadable(table_heap_->GetTuple(tuple_->rid_, tuple_, txn_, row_mode_));
   }
 }
 
@@ -34,34 +34,51 @@ Tuple *TableIterator::operator->() {
 }
 
 TableIterator &TableIterator::operator++() {
+  SkipUnreadable(Advance());
+  return *this;
+}
+
+void TableIterator::SkipUnreadable(bool read) {
+  while (!read) {
+    // The row could not be locked, the transaction is aborted and the scan ends here.
+    if (txn_ != nullptr && txn_->GetState() == TransactionState::ABORTED) {
+      tuple_->rid_.Set(INVALID_PAGE_ID, 0);
+      return;
+    }
+    // Otherwise the row is not there for this transaction, e.g. it was deleted while we waited for its lock.
+    read = Advance();
+  }
+}
+
+bool TableIterator::Advance() {
   BufferPoolManager *buffer_pool_manager = table_heap_->buffer_pool_manager_;
   auto cur_page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(tuple_->rid_.GetPageId()));
   cur_page->RLatch();
   assert(cur_page != nullptr);  // all pages are pinned
 
   RID next_tuple_rid;
-  if (!cur_page->GetNextTupleRid(tuple_->rid_,
-                                 &next_tuple_rid)) {  // end of this page
+  if (!cur_page->GetNextTupleRid(tuple_->rid_, &next_tuple_rid, IsSnapshot())) {  // end of this page
     while (cur_page->GetNextPageId() != INVALID_PAGE_ID) {
       auto next_page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(cur_page->GetNextPageId()));
       cur_page->RUnlatch();
       buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
       cur_page = next_page;
       cur_page->RLatch();
-      if (cur_page->GetFirstTupleRid(&next_tuple_rid)) {
+      if (cur_page->GetFirstTupleRid(&next_tuple_rid, IsSnapshot())) {
         break;
       }
     }
   }
   tuple_->rid_ = next_tuple_rid;
+  // The read may wait for a row lock, which is never done while holding a page latch.
+  cur_page->RUnlatch();
+  buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
 
+  bool read = true;
   if (*this != table_heap_->End()) {
-    table_heap_->GetTuple(tuple_->rid_, tuple_, txn_);
+    read = table_heap_->GetTuple(tuple_->rid_, tuple_, txn_, row_mode_);
   }
-  // release until copy the tuple
-  cur_page->RUnlatch();
-  buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
-  return *this;
+  return read;
 }
 
 TableIterator TableIterator::operator++(int) {
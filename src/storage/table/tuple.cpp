@@ -87,6 +87,30 @@ Tuple &Tuple::operator=(const Tuple &other) {
   return *this;
 }
 
+Tuple::Tuple(Tuple &&other) noexcept
+    : allocated_(other.allocated_), rid_(other.rid_), size_(other.size_), data_(other.data_) {
+  other.allocated_ = false;
+  other.data_ = nullptr;
+  other.size_ = 0;
+}
+
+Tuple &Tuple::operator=(Tuple &&other) noexcept {
+  if (this == &other) {
+    return *this;
+  }
+  if (allocated_) {
+    delete[] data_;
+  }
+  allocated_ = other.allocated_;
+  rid_ = other.rid_;
+  size_ = other.size_;
+  data_ = other.data_;
+  other.allocated_ = false;
+  other.data_ = nullptr;
+  other.size_ = 0;
+  return *this;
+}
+
 Value Tuple::GetValue(const Schema *schema, const uint32_t column_idx) const {
   assert(schema);
   assert(data_);
@@ -96,7 +120,8 @@ Value Tuple::GetValue(const Schema *schema, const uint32_t column_idx) const {
   return Value::DeserializeFrom(data_ptr, column_type);
 }
 
-Tuple Tuple::KeyFromTuple(const Schema &schema, const Schema &key_schema, const std::vector<uint32_t> &key_attrs) {
+Tuple Tuple::KeyFromTuple(const Schema &schema, const Schema &key_schema,
+                          const std::vector<uint32_t> &key_attrs) const {
   std::vector<Value> values;
   values.reserve(key_attrs.size());
   for (auto idx : key_attrs) {
@@ -0,0 +1,154 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// version_store.cpp
+//
+// Identification: src/storage/table/version_store.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/table/version_store.h"
+
+#include <iterator>
+#include <utility>
+
+namespace bustub {
+
+void VersionStore::RecordWrite(const RID &rid, Transaction *txn, std::optional<Tuple> old_tuple) {
+  std::scoped_lock lock(latch_);
+  VersionChain &chain = chains_[rid];
+  // Only the first write of a transaction replaces a committed version. Without row locks, another transaction may
+  // have written the tuple and not committed yet, then its version stays the one that commits.
+  if (chain.head_txn_ != INVALID_TXN_ID) {
+    return;
+  }
+  chain.versions_.push_front({std::move(old_tuple), chain.head_ts_});
+  chain.head_txn_ = txn->GetTransactionId();
+}
+
+bool VersionStore::CanWrite(const RID &rid, Transaction *txn) {
+  return txn->GetIsolationLevel() != IsolationLevel::SNAPSHOT || IsUnchanged(rid, txn);
+}
+
+bool VersionStore::IsUnchanged(const RID &rid, Transaction *txn) {
+  std::scoped_lock lock(latch_);
+  // Chains newer than the oldest snapshot are never pruned, so without a chain the tuple is unchanged.
+  auto it = chains_.find(rid);
+  if (it == chains_.end()) {
+    return true;
+  }
+  const VersionChain &chain = it->second;
+  if (chain.head_txn_ == txn->GetTransactionId()) {
+    // The transaction's own write replaced the version it read.
+    return chain.versions_.front().begin_ts_ <= txn->GetReadTs();
+  }
+  return chain.head_txn_ == INVALID_TXN_ID && chain.head_ts_ <= txn->GetReadTs();
+}
+
+bool VersionStore::GetVisible(const RID &rid, Transaction *txn, Tuple *tuple, bool exists) {
+  std::scoped_lock lock(latch_);
+  auto it = chains_.find(rid);
+  if (it == chains_.end()) {
+    return exists;
+  }
+  const VersionChain &chain = it->second;
+  if (chain.head_txn_ == txn->GetTransactionId() ||
+      (chain.head_txn_ == INVALID_TXN_ID && chain.head_ts_ <= txn->GetReadTs())) {
+    return exists;
+  }
+  for (const Version &version : chain.versions_) {
+    if (version.begin_ts_ <= txn->GetReadTs()) {
+      if (!version.tuple_.has_value()) {
+        return false;
+      }
+      *tuple = *version.tuple_;
+      return true;
+    }
+  }
+  // The tuple was created after the snapshot.
+  return false;
+}
+
+void VersionStore::Commit(const RID &rid, Transaction *txn, timestamp_t commit_ts) {
+  std::scoped_lock lock(latch_);
+  auto it = chains_.find(rid);
+  if (it != chains_.end() && it->second.head_txn_ == txn->GetTransactionId()) {
+    it->second.head_txn_ = INVALID_TXN_ID;
+    it->second.head_ts_ = commit_ts;
+  }
+}
+
+void VersionStore::Abort(const RID &rid, Transaction *txn) {
+  std::scoped_lock lock(latch_);
+  auto it = chains_.find(rid);
+  if (it == chains_.end() || it->second.head_txn_ != txn->GetTransactionId()) {
+    return;
+  }
+  // The page holds the replaced version again.
+  VersionChain &chain = it->second;
+  chain.head_txn_ = INVALID_TXN_ID;
+  chain.head_ts_ = chain.versions_.front().begin_ts_;
+  chain.versions_.pop_front();
+  if (chain.versions_.empty()) {
+    chains_.erase(it);
+  }
+}
+
+bool VersionStore::PruneChain(VersionChain *chain, timestamp_t watermark) {
+  // Every snapshot sees a committed version on the page that is older than the watermark.
+  if (chain->head_txn_ == INVALID_TXN_ID && chain->head_ts_ <= watermark) {
+    return true;
+  }
+  // Otherwise the oldest snapshot sees the first version valid at the watermark, and nobody sees the ones before.
+  for (size_t i = 0; i < chain->versions_.size(); i++) {
+    if (chain->versions_[i].begin_ts_ <= watermark) {
+      chain->versions_.erase(chain->versions_.begin() + i + 1, chain->versions_.end());
+      break;
+    }
+  }
+  return false;
+}
+
+void VersionStore::Prune(timestamp_t watermark, std::optional<RID> rid) {
+  std::scoped_lock lock(latch_);
+  if (rid.has_value()) {
+    auto it = chains_.find(*rid);
+    if (it != chains_.end() && PruneChain(&it->second, watermark)) {
+      chains_.erase(it);
+    }
+    return;
+  }
+  for (auto it = chains_.begin(); it != chains_.end();) {
+    it = PruneChain(&it->second, watermark) ? chains_.erase(it) : std::next(it);
+  }
+}
+
+std::unordered_set<txn_id_t> VersionStore::GetUncommittedWriters() {
+  std::scoped_lock lock(latch_);
+  std::unordered_set<txn_id_t> writers;
+  for (const auto &[rid, chain] : chains_) {
+    if (chain.head_txn_ != INVALID_TXN_ID) {
+      writers.insert(chain.head_txn_);
+    }
+  }
+  return writers;
+}
+
+size_t VersionStore::GetNumChains() {
+  std::scoped_lock lock(latch_);
+  return chains_.size();
+}
+
+size_t VersionStore::GetNumVersions() {
+  std::scoped_lock lock(latch_);
+  size_t num_versions = 0;
+  for (const auto &[rid, chain] : chains_) {
+    num_versions += chain.versions_.size();
+  }
+  return num_versions;
+}
+
+}  // namespace bustub
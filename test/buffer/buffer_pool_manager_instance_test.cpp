@@ -14,8 +14,11 @@
 #include <cstdio>
 #include <random>
 #include <string>
+#include <thread>  // NOLINT
 #include "buffer/buffer_pool_manager.h"
 #include "gtest/gtest.h"
+#include "logging/common.h"
+#include "recovery/log_manager.h"
 
 namespace bustub {
 
@@ -141,4 +144,58 @@ TEST(BufferPoolManagerInstanceTest, SampleTest) {
   delete disk_manager;
 }
 
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, WalAwareEvictionTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 3;
+  auto saved_log_timeout = log_timeout;
+  log_timeout = std::chrono::seconds(60);
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *log_manager = new LogManager(disk_manager);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager, log_manager);
+  log_manager->RunFlushThread();
+
+  // Page 0 is the least recently used page, but its last change is not durable yet. Page 1's is.
+  page_id_t page_ids[buffer_pool_size];
+  Page *pages[buffer_pool_size];
+  for (size_t i = 0; i < buffer_pool_size; i++) {
+    pages[i] = bpm->NewPage(&page_ids[i]);
+    ASSERT_NE(nullptr, pages[i]);
+  }
+  LogRecord record_1(0, INVALID_LSN, LogRecordType::BEGIN);
+  pages[1]->SetLSN(log_manager->AppendLogRecord(&record_1));
+  log_manager->Flush();
+  LogRecord record_0(1, INVALID_LSN, LogRecordType::BEGIN);
+  pages[0]->SetLSN(log_manager->AppendLogRecord(&record_0));
+  for (size_t i = 0; i < buffer_pool_size; i++) {
+    EXPECT_TRUE(bpm->UnpinPage(page_ids[i], true));
+  }
+
+  // Scenario: page 1 is evicted instead of page 0, and the log is written out in the background.
+  page_id_t page_id_temp;
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+  EXPECT_EQ(1, bpm->GetNumLogForcesAvoided());
+  EXPECT_EQ(0, bpm->GetNumLogForces());
+  EXPECT_EQ(1, disk_manager->GetNumWrites());
+  while (log_manager->GetPersistentLSN() < record_0.GetLSN()) {
+    std::this_thread::yield();
+  }
+
+  // Scenario: page 0 is now covered by the durable log as well, so evicting it does not force the log.
+  ASSERT_TRUE(bpm->UnpinPage(page_id_temp, false));
+  ASSERT_NE(nullptr, bpm->FetchPage(page_ids[1]));
+  EXPECT_EQ(0, bpm->GetNumLogForces());
+
+  log_manager->StopFlushThread();
+  log_timeout = saved_log_timeout;
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+  RemoveLogSegments();
+  delete bpm;
+  delete log_manager;
+  delete disk_manager;
+}
+
 }  // namespace bustub
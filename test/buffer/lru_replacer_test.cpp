@@ -59,4 +59,24 @@ TEST(LRUReplacerTest, SampleTest) {
   EXPECT_EQ(4, value);
 }
 
+TEST(LRUReplacerTest, PreferenceTest) {
+  LRUReplacer lru_replacer(7);
+  for (int i = 1; i <= 4; i++) {
+    lru_replacer.Unpin(i);
+  }
+
+  // Scenario: the least recently used even frame is chosen over the least recently used frame.
+  auto even = [](frame_id_t frame_id) { return frame_id % 2 == 0; };
+  int value;
+  ASSERT_TRUE(lru_replacer.VictimWithPreference(&value, even));
+  EXPECT_EQ(2, value);
+  ASSERT_TRUE(lru_replacer.VictimWithPreference(&value, even));
+  EXPECT_EQ(4, value);
+
+  // Scenario: without a preferred frame left, the policy falls back to plain LRU.
+  ASSERT_TRUE(lru_replacer.VictimWithPreference(&value, even));
+  EXPECT_EQ(1, value);
+  EXPECT_EQ(1, lru_replacer.Size());
+}
+
 }  // namespace bustub
@@ -10,6 +10,10 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <iostream>
+#include <string>
 #include <thread>  // NOLINT
 #include <vector>
 
@@ -57,4 +61,72 @@ TEST(RWLatchTest, BasicTest) {
   }
   EXPECT_EQ(counter.Read(), 55);
 }
+
+// NOLINTNEXTLINE
+TEST(RWLatchTest, ScalableLatchTest) {
+  ScalableReaderWriterLatch latch;
+  int count = 0;
+  std::atomic<int> readers{0};
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < 8; tid++) {
+    threads.emplace_back([&, tid] {
+      for (int i = 0; i < 1000; i++) {
+        if (tid % 4 == 0) {
+          latch.WLock();
+          // Nobody reads while a writer holds the latch.
+          EXPECT_EQ(readers, 0);
+          count++;
+          latch.WUnlock();
+        } else {
+          latch.RLock();
+          readers++;
+          readers--;
+          latch.RUnlock();
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(count, 2000);
+
+  // A reader may release the latch on another thread, like a transaction that commits on another thread.
+  latch.RLock();
+  std::thread([&] { latch.RUnlock(); }).join();
+  latch.WLock();
+  latch.WUnlock();
+}
+
+/** Acquire and release a latch in read mode on a few threads. */
+template <typename LatchType>
+void ReadLatchBenchmark(const std::string &name, int num_threads) {
+  const int num_iterations = 200000;
+  LatchType latch;
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < num_iterations; i++) {
+        latch.RLock();
+        latch.RUnlock();
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << name << ", " << num_threads << " threads: " << static_cast<int>(num_threads * num_iterations / elapsed)
+            << " read latches/s" << std::endl;
+}
+
+// NOLINTNEXTLINE
+TEST(RWLatchTest, DISABLED_ReadLatchBenchmark) {
+  for (int num_threads : {1, 8}) {
+    ReadLatchBenchmark<ReaderWriterLatch>("mutex", num_threads);
+    ReadLatchBenchmark<ScalableReaderWriterLatch>("scalable", num_threads);
+  }
+}
+
 }  // namespace bustub
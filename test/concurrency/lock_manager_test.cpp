@@ -2,13 +2,23 @@
  * lock_manager_test.cpp
  */
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <iostream>
+#include <numeric>
 #include <random>
 #include <thread>  // NOLINT
 
+#include "catalog/catalog.h"
+#include "common/bustub_instance.h"
 #include "common/config.h"
 #include "concurrency/lock_manager.h"
 #include "concurrency/transaction_manager.h"
 #include "gtest/gtest.h"
+#include "logging/common.h"
+#include "type/value_factory.h"
 
 namespace bustub {
 
@@ -77,7 +87,7 @@ void BasicTest1() {
     delete txns[i];
   }
 }
-TEST(LockManagerTest, DISABLED_BasicTest) { BasicTest1(); }
+TEST(LockManagerTest, BasicTest) { BasicTest1(); }
 
 void TwoPLTest() {
   LockManager lock_mgr{};
@@ -123,7 +133,7 @@ void TwoPLTest() {
 
   delete txn;
 }
-TEST(LockManagerTest, DISABLED_TwoPLTest) { TwoPLTest(); }
+TEST(LockManagerTest, TwoPLTest) { TwoPLTest(); }
 
 void UpgradeTest() {
   LockManager lock_mgr{};
@@ -150,7 +160,7 @@ void UpgradeTest() {
   txn_mgr.Commit(&txn);
   CheckCommitted(&txn);
 }
-TEST(LockManagerTest, DISABLED_UpgradeLockTest) { UpgradeTest(); }
+TEST(LockManagerTest, UpgradeLockTest) { UpgradeTest(); }
 
 void WoundWaitBasicTest() {
   LockManager lock_mgr{};
@@ -202,6 +212,355 @@ void WoundWaitBasicTest() {
   txn_mgr.Commit(&txn_hold);
   CheckCommitted(&txn_hold);
 }
-TEST(LockManagerTest, DISABLED_WoundWaitBasicTest) { WoundWaitBasicTest(); }
+TEST(LockManagerTest, WoundWaitBasicTest) { WoundWaitBasicTest(); }
+
+void DeadlockDetectionTest() {
+  auto interval = cycle_detection_interval;
+  cycle_detection_interval = std::chrono::milliseconds(300);
+  LockManager lock_mgr{LockManager::DeadlockMode::DETECTION};
+  TransactionManager txn_mgr{&lock_mgr};
+  RID rid0{0, 0};
+  RID rid1{0, 1};
+
+  Transaction txn0(0);
+  Transaction txn1(1);
+  txn_mgr.Begin(&txn0);
+  txn_mgr.Begin(&txn1);
+  EXPECT_TRUE(lock_mgr.LockExclusive(&txn0, rid0));
+  EXPECT_TRUE(lock_mgr.LockExclusive(&txn1, rid1));
+
+  std::thread t1([&] {
+    // txn1 waits for txn0, and is the victim once txn0 waits for it as well.
+    EXPECT_THROW(lock_mgr.LockExclusive(&txn1, rid0), TransactionAbortException);
+    CheckAborted(&txn1);
+    txn_mgr.Abort(&txn1);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  auto edges = lock_mgr.GetEdgeList();
+  ASSERT_EQ(edges.size(), 1);
+  EXPECT_EQ(edges[0], std::make_pair(1, 0));
+  txn_id_t victim;
+  EXPECT_FALSE(lock_mgr.HasCycle(&victim));
+
+  EXPECT_TRUE(lock_mgr.LockExclusive(&txn0, rid1));
+  t1.join();
+  CheckGrowing(&txn0);
+  EXPECT_EQ(lock_mgr.GetNumDeadlocks(), 1);
+  EXPECT_TRUE(lock_mgr.GetEdgeList().empty());
+  txn_mgr.Commit(&txn0);
+  cycle_detection_interval = interval;
+}
+TEST(LockManagerTest, DeadlockDetectionTest) { DeadlockDetectionTest(); }
+
+void ReadOnlyDeadlockTest() {
+  auto interval = cycle_detection_interval;
+  cycle_detection_interval = std::chrono::milliseconds(100);
+  LockManager lock_mgr{LockManager::DeadlockMode::DETECTION};
+  TransactionManager txn_mgr{&lock_mgr};
+  RID rid0{0, 0};
+  RID rid1{0, 1};
+
+  auto *writer = txn_mgr.Begin();
+  auto *reader = txn_mgr.BeginReadOnly(IsolationLevel::REPEATABLE_READ);
+  EXPECT_TRUE(lock_mgr.LockExclusive(writer, rid0));
+  EXPECT_TRUE(lock_mgr.LockShared(reader, rid1));
+
+  std::thread t1([&] {
+    // The reader is younger, so the deadlock detector picks it as the victim.
+    EXPECT_THROW(lock_mgr.LockShared(reader, rid0), TransactionAbortException);
+    CheckAborted(reader);
+    txn_mgr.Abort(reader);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_TRUE(lock_mgr.LockExclusive(writer, rid1));
+  t1.join();
+  EXPECT_EQ(lock_mgr.GetNumDeadlocks(), 1);
+  CheckTxnLockSize(reader, 0, 0);
+  txn_mgr.Commit(writer);
+  delete reader;
+  delete writer;
+  cycle_detection_interval = interval;
+}
+TEST(LockManagerTest, ReadOnlyDeadlockTest) { ReadOnlyDeadlockTest(); }
+
+void IncrementLockTest() {
+  LockManager lock_mgr{LockManager::DeadlockMode::DETECTION};
+  TransactionManager txn_mgr{&lock_mgr};
+  RID rid{0, 0};
+  auto *txn0 = txn_mgr.Begin();
+  auto *txn1 = txn_mgr.Begin();
+  auto *reader = txn_mgr.Begin();
+
+  // Incrementers share the tuple, a reader waits for all of them.
+  EXPECT_TRUE(lock_mgr.LockIncrement(txn0, rid));
+  EXPECT_TRUE(lock_mgr.LockIncrement(txn1, rid));
+  EXPECT_TRUE(txn0->IsIncrementLocked(rid));
+  EXPECT_TRUE(txn1->IsIncrementLocked(rid));
+  std::atomic<bool> read{false};
+  std::thread t([&] {
+    EXPECT_TRUE(lock_mgr.LockShared(reader, rid));
+    read = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(read);
+  txn_mgr.Commit(txn0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(read);
+  txn_mgr.Commit(txn1);
+  t.join();
+  EXPECT_TRUE(txn0->GetIncrementLockSet()->empty());
+  CheckTxnLockSize(reader, 1, 0);
+  txn_mgr.Commit(reader);
+  delete txn0;
+  delete txn1;
+  delete reader;
+}
+TEST(LockManagerTest, IncrementLockTest) { IncrementLockTest(); }
+
+
+
+void IntentionLockTest() {
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+  const table_oid_t oid = 0;
+  const page_id_t page_id = 1;
+  auto *txn0 = txn_mgr.Begin();
+  auto *txn1 = txn_mgr.Begin();
+
+  // Writers of different rows share the table through intention locks.
+  EXPECT_TRUE(lock_mgr.LockTable(txn0, LockMode::INTENTION_EXCLUSIVE, oid));
+  EXPECT_TRUE(lock_mgr.LockTable(txn1, LockMode::INTENTION_EXCLUSIVE, oid));
+  EXPECT_TRUE(lock_mgr.LockPage(txn0, LockMode::EXCLUSIVE, oid, page_id));
+  EXPECT_TRUE(lock_mgr.LockExclusive(txn0, RID{page_id, 0}));
+  EXPECT_TRUE(lock_mgr.LockExclusive(txn1, RID{page_id + 1, 0}));
+
+  txn_mgr.Commit(txn1);
+
+  // Reading the whole table on top of an intention to write is SHARED_INTENTION_EXCLUSIVE. A younger reader can get
+  // in, a younger writer has to wait.
+  EXPECT_TRUE(lock_mgr.LockTable(txn0, LockMode::SHARED, oid));
+  EXPECT_EQ(LockMode::SHARED_INTENTION_EXCLUSIVE, txn0->GetTableLockSet()->at(oid));
+  CheckGrowing(txn0);
+
+  std::atomic<bool> granted{false};
+  std::thread reader([&] {
+    auto *txn2 = txn_mgr.Begin();
+    EXPECT_TRUE(lock_mgr.LockTable(txn2, LockMode::INTENTION_SHARED, oid));
+    EXPECT_TRUE(lock_mgr.LockTable(txn2, LockMode::INTENTION_EXCLUSIVE, oid));
+    granted = true;
+    txn_mgr.Commit(txn2);
+    delete txn2;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_FALSE(granted);
+  txn_mgr.Commit(txn0);
+  reader.join();
+  EXPECT_TRUE(granted);
+  CheckTxnLockSize(txn0, 0, 0);
+  EXPECT_TRUE(txn0->GetTableLockSet()->empty());
+  EXPECT_TRUE(txn0->GetPageLockSet()->empty());
+
+  // A page lock needs a matching intention lock on the table.
+  auto *txn3 = txn_mgr.Begin();
+  EXPECT_TRUE(lock_mgr.LockTable(txn3, LockMode::INTENTION_SHARED, oid));
+  EXPECT_THROW(lock_mgr.LockPage(txn3, LockMode::EXCLUSIVE, oid, page_id), TransactionAbortException);
+  CheckAborted(txn3);
+  txn_mgr.Abort(txn3);
+
+  delete txn0;
+  delete txn1;
+  delete txn3;
+}
+TEST(LockManagerTest, IntentionLockTest) { IntentionLockTest(); }
+
+
+void LockEscalationTest() {
+  remove("lock_manager_test.db");
+  remove("lock_manager_test.log");
+  RemoveLogSegments("lock_manager_test.log");
+  auto *bustub_instance = new BustubInstance("lock_manager_test.db");
+  LockManager *lock_mgr = bustub_instance->lock_manager_;
+  TransactionManager *txn_mgr = bustub_instance->transaction_manager_;
+  lock_mgr->SetEscalationThreshold(10);
+  Schema schema{std::vector<Column>{Column{"A", TypeId::INTEGER}}};
+  Transaction *txn = txn_mgr->Begin();
+  auto *table_info = bustub_instance->catalog_->CreateTable(txn, "foobar", schema);
+  txn_mgr->Commit(txn);
+  delete txn;
+  // Rows are only locked with logging enabled.
+  bustub_instance->log_manager_->RunFlushThread();
+
+  // The 11th row lock of the writer turns its intention lock into an exclusive table lock.
+  txn = txn_mgr->Begin();
+  std::vector<RID> rids(50);
+  for (int i = 0; i < 50; i++) {
+    Tuple tuple(std::vector<Value>{ValueFactory::GetIntegerValue(i)}, &schema);
+    ASSERT_TRUE(table_info->table_->InsertTuple(tuple, &rids[i], txn));
+  }
+  EXPECT_EQ(1, lock_mgr->GetNumEscalations());
+  EXPECT_EQ(LockMode::EXCLUSIVE, txn->GetTableLockSet()->at(table_info->oid_));
+  CheckTxnLockSize(txn, 0, 0);
+  CheckGrowing(txn);
+  EXPECT_GT(lock_mgr->GetLockTableMemory(), 0);
+  txn_mgr->Commit(txn);
+  delete txn;
+
+  // The same for a reader, which ends up with a shared table lock.
+  txn = txn_mgr->Begin();
+  for (const RID &rid : rids) {
+    Tuple tuple;
+    ASSERT_TRUE(table_info->table_->GetTuple(rid, &tuple, txn));
+  }
+  EXPECT_EQ(2, lock_mgr->GetNumEscalations());
+  EXPECT_EQ(LockMode::SHARED, txn->GetTableLockSet()->at(table_info->oid_));
+  CheckTxnLockSize(txn, 0, 0);
+  txn_mgr->Commit(txn);
+  delete txn;
+
+  delete bustub_instance;
+  remove("lock_manager_test.db");
+  remove("lock_manager_test.log");
+  RemoveLogSegments("lock_manager_test.log");
+}
+TEST(LockManagerTest, LockEscalationTest) { LockEscalationTest(); }
+
+// Transactions lock a few records each, drawn uniformly or from a Zipfian distribution, and update the records
+// they lock exclusively. Wound-wait aborts some of them, the committed updates must all be there.
+void ContentionBenchmark(bool zipfian) {
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+  const int num_rids = 10000;
+  const int num_threads = 8;
+  const int txns_per_thread = 2000;
+  const int locks_per_txn = 4;
+
+  std::vector<double> weights(num_rids, 1.0);
+  if (zipfian) {
+    for (int i = 0; i < num_rids; i++) {
+      weights[i] = 1.0 / std::pow(i + 1, 0.99);
+    }
+  }
+  std::vector<int64_t> counters(num_rids, 0);
+  std::atomic<int64_t> expected_updates{0};
+  std::atomic<int> aborts{0};
+
+  auto task = [&](int thread_id) {
+    std::mt19937 gen(thread_id);
+    std::discrete_distribution<int> rid_dist(weights.begin(), weights.end());
+    std::bernoulli_distribution exclusive_dist(0.2);
+    for (int i = 0; i < txns_per_thread; i++) {
+      std::vector<std::pair<int, bool>> locks;
+      while (static_cast<int>(locks.size()) < locks_per_txn) {
+        int slot = rid_dist(gen);
+        if (std::none_of(locks.begin(), locks.end(), [&](const auto &lock) { return lock.first == slot; })) {
+          locks.emplace_back(slot, exclusive_dist(gen));
+        }
+      }
+      Transaction *txn = txn_mgr.Begin();
+      try {
+        for (const auto &[slot, exclusive] : locks) {
+          RID rid{0, static_cast<uint32_t>(slot)};
+          bool res = exclusive ? lock_mgr.LockExclusive(txn, rid) : lock_mgr.LockShared(txn, rid);
+          if (!res) {
+            throw TransactionAbortException(txn->GetTransactionId(), AbortReason::DEADLOCK);
+          }
+        }
+        for (const auto &[slot, exclusive] : locks) {
+          if (exclusive) {
+            counters[slot]++;
+            expected_updates++;
+          }
+        }
+        txn_mgr.Commit(txn);
+      } catch (TransactionAbortException &e) {
+        txn_mgr.Abort(txn);
+        aborts++;
+      }
+      delete txn;
+    }
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads);
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back(task, i);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  int64_t updates = 0;
+  for (int64_t counter : counters) {
+    updates += counter;
+  }
+  EXPECT_EQ(expected_updates, updates);
+  std::cout << (zipfian ? "zipfian: " : "uniform: ")
+            << static_cast<int>((num_threads * txns_per_thread - aborts) / elapsed) << " txns/s, " << aborts
+            << " aborts" << std::endl;
+}
+TEST(LockManagerTest, DISABLED_UniformContentionBenchmark) { ContentionBenchmark(false); }
+TEST(LockManagerTest, DISABLED_ZipfianContentionBenchmark) { ContentionBenchmark(true); }
+
+// Transactions lock a few of a handful of records exclusively in random order, so they deadlock all the time. With
+// PREVENTION wound-wait aborts every possible deadlock up front, with DETECTION only the real ones are aborted, once
+// the detector finds them.
+void DeadlockStormBenchmark(LockManager::DeadlockMode deadlock_mode) {
+  auto interval = cycle_detection_interval;
+  cycle_detection_interval = std::chrono::milliseconds(5);
+  LockManager lock_mgr{deadlock_mode};
+  TransactionManager txn_mgr{&lock_mgr};
+  const int num_rids = 16;
+  const int num_threads = 8;
+  const int txns_per_thread = 200;
+  std::atomic<int> aborts{0};
+
+  auto task = [&](int thread_id) {
+    std::mt19937 gen(thread_id);
+    std::uniform_int_distribution<int> count_dist(2, 4);
+    std::vector<int> slots(num_rids);
+    std::iota(slots.begin(), slots.end(), 0);
+    for (int i = 0; i < txns_per_thread; i++) {
+      std::shuffle(slots.begin(), slots.end(), gen);
+      int count = count_dist(gen);
+      Transaction *txn = txn_mgr.Begin();
+      try {
+        for (int j = 0; j < count; j++) {
+          if (!lock_mgr.LockExclusive(txn, RID{0, static_cast<uint32_t>(slots[j])})) {
+            throw TransactionAbortException(txn->GetTransactionId(), AbortReason::DEADLOCK);
+          }
+        }
+        txn_mgr.Commit(txn);
+      } catch (TransactionAbortException &e) {
+        txn_mgr.Abort(txn);
+        aborts++;
+      }
+      delete txn;
+    }
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads);
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back(task, i);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  EXPECT_TRUE(lock_mgr.GetEdgeList().empty());
+  std::cout << (deadlock_mode == LockManager::DeadlockMode::DETECTION ? "detection: " : "prevention: ")
+            << static_cast<int>((num_threads * txns_per_thread - aborts) / elapsed) << " txns/s, " << aborts
+            << " aborts" << std::endl;
+  cycle_detection_interval = interval;
+}
+TEST(LockManagerTest, DISABLED_PreventionDeadlockStormBenchmark) {
+  DeadlockStormBenchmark(LockManager::DeadlockMode::PREVENTION);
+}
+TEST(LockManagerTest, DISABLED_DetectionDeadlockStormBenchmark) {
+  DeadlockStormBenchmark(LockManager::DeadlockMode::DETECTION);
+}
 
 }  // namespace bustub
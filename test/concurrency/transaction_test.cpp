@@ -10,16 +10,23 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>  // NOLINT
 #include <cstdio>
+#include <cstdlib>
+#include <iostream>
 #include <memory>
+#include <new>
 #include <random>
 #include <string>
+#include <thread>  // NOLINT
 #include <utility>
 #include <vector>
 
 #include "buffer/buffer_pool_manager_instance.h"
 #include "catalog/table_generator.h"
+#include "common/bustub_instance.h"
 #include "concurrency/transaction.h"
 #include "concurrency/transaction_manager.h"
 #include "execution/execution_engine.h"
@@ -32,6 +39,7 @@
 #include "execution/plans/limit_plan.h"
 #include "execution/plans/nested_index_join_plan.h"
 #include "execution/plans/seq_scan_plan.h"
+#include "execution/plans/update_plan.h"
 #include "gtest/gtest.h"
 #include "test_util.h"  // NOLINT
 #include "type/value_factory.h"
@@ -46,6 +54,22 @@
   EXPECT_TRUE(futureResult.wait_for(std::chrono::milliseconds(X)) != std::future_status::timeout) \
       << "Test Failed Due to Time Out";
 
+/** The number of heap allocations so far, counted to check that pooled transactions begin and commit without any. */
+static std::atomic<size_t> num_allocations{0};
+
+void *operator new(size_t size) {
+  num_allocations++;
+  void *ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+void operator delete(void *ptr, size_t size) noexcept { std::free(ptr); }
+
 namespace bustub {
 
 class TransactionTest : public ::testing::Test {
@@ -55,6 +79,7 @@ class TransactionTest : public ::testing::Test {
     ::testing::Test::SetUp();
     // For each test, we create a new DiskManager, BufferPoolManager, TransactionManager, and Catalog.
     disk_manager_ = std::make_unique<DiskManager>("executor_test.db");
+    log_manager_ = std::make_unique<LogManager>(disk_manager_.get());
     bpm_ = std::make_unique<BufferPoolManagerInstance>(2560, disk_manager_.get());
     page_id_t page_id;
     bpm_->NewPage(&page_id);
@@ -79,6 +104,8 @@ class TransactionTest : public ::testing::Test {
     // Shut down the disk manager and clean up the transaction.
     disk_manager_->ShutDown();
     remove("executor_test.db");
+    remove("executor_test.log");
+    remove("executor_test.log.0");
     delete txn_;
   };
 
@@ -90,6 +117,7 @@ class TransactionTest : public ::testing::Test {
   Catalog *GetCatalog() { return catalog_.get(); }
   BufferPoolManager *GetBPM() { return bpm_.get(); }
   LockManager *GetLockManager() { return lock_manager_.get(); }
+  LogManager *GetLogManager() { return log_manager_.get(); }
 
   // The below helper functions are useful for testing.
 
@@ -136,7 +164,7 @@ class TransactionTest : public ::testing::Test {
   std::unique_ptr<TransactionManager> txn_mgr_;
   Transaction *txn_{nullptr};
   std::unique_ptr<DiskManager> disk_manager_;
-  std::unique_ptr<LogManager> log_manager_ = nullptr;
+  std::unique_ptr<LogManager> log_manager_;
   std::unique_ptr<LockManager> lock_manager_;
   std::unique_ptr<BufferPoolManager> bpm_;
   std::unique_ptr<Catalog> catalog_;
@@ -253,4 +281,790 @@ TEST_F(TransactionTest, DISABLED_DirtyReadsTest) {
   delete txn2;
 }
 
+// NOLINTNEXTLINE
+TEST_F(TransactionTest, SnapshotIsolationTest) {
+  // txn0: INSERT INTO empty_table2 VALUES (0, 0), ..., (9, 0); commit
+  // reader: begin (SNAPSHOT)
+  // writer: UPDATE row 0 to (0, 1), DELETE row 1, INSERT (10, 0); commit
+  // reader: SELECT * FROM empty_table2, sees the rows as of its beginning; UPDATE row 0 aborts
+  auto table_info = GetCatalog()->GetTable("empty_table2");
+  auto table = table_info->table_.get();
+  auto &schema = table_info->schema_;
+  auto make_tuple = [&](int a, int b) {
+    return Tuple({ValueFactory::GetIntegerValue(a), ValueFactory::GetIntegerValue(b)}, &schema);
+  };
+  auto txn0 = GetTxnManager()->Begin();
+  std::vector<RID> rids(10);
+  for (int i = 0; i < 10; i++) {
+    ASSERT_TRUE(table->InsertTuple(make_tuple(i, 0), &rids[i], txn0));
+  }
+  GetTxnManager()->Commit(txn0);
+  delete txn0;
+
+  auto col_a = MakeColumnValueExpression(schema, 0, "colA");
+  auto col_b = MakeColumnValueExpression(schema, 0, "colB");
+  auto out_schema = MakeOutputSchema({{"colA", col_a}, {"colB", col_b}});
+  SeqScanPlanNode scan_plan{out_schema, nullptr, table_info->oid_};
+  auto scan = [&](Transaction *txn) {
+    auto exec_ctx = std::make_unique<ExecutorContext>(txn, GetCatalog(), GetBPM(), GetTxnManager(), GetLockManager());
+    std::vector<Tuple> result_set;
+    GetExecutionEngine()->Execute(&scan_plan, &result_set, txn, exec_ctx.get());
+    std::vector<std::pair<int32_t, int32_t>> rows;
+    for (const auto &tuple : result_set) {
+      rows.emplace_back(tuple.GetValue(out_schema, 0).GetAs<int32_t>(), tuple.GetValue(out_schema, 1).GetAs<int32_t>());
+    }
+    std::sort(rows.begin(), rows.end());
+    return rows;
+  };
+  std::vector<std::pair<int32_t, int32_t>> before;
+  for (int i = 0; i < 10; i++) {
+    before.emplace_back(i, 0);
+  }
+
+  auto reader = GetTxnManager()->Begin(nullptr, IsolationLevel::SNAPSHOT);
+  auto writer = GetTxnManager()->Begin();
+  RID new_rid;
+  ASSERT_TRUE(table->UpdateTuple(make_tuple(0, 1), rids[0], writer));
+  ASSERT_TRUE(table->MarkDelete(rids[1], writer));
+  ASSERT_TRUE(table->InsertTuple(make_tuple(10, 0), &new_rid, writer));
+  EXPECT_EQ(scan(reader), before);
+  GetTxnManager()->Commit(writer);
+  delete writer;
+  EXPECT_EQ(scan(reader), before);
+  Tuple tuple;
+  ASSERT_TRUE(table->GetTuple(rids[1], &tuple, reader));
+  EXPECT_EQ(tuple.GetValue(&schema, 0).GetAs<int32_t>(), 1);
+  EXPECT_FALSE(table->GetTuple(new_rid, &tuple, reader));
+
+  // A snapshot that begins now sees the writes.
+  auto late_reader = GetTxnManager()->Begin(nullptr, IsolationLevel::SNAPSHOT);
+  std::vector<std::pair<int32_t, int32_t>> after = before;
+  after[0].second = 1;
+  after.erase(after.begin() + 1);
+  after.emplace_back(10, 0);
+  EXPECT_EQ(scan(late_reader), after);
+  GetTxnManager()->Commit(late_reader);
+  delete late_reader;
+
+  // The first updater wins.
+  EXPECT_FALSE(table->UpdateTuple(make_tuple(0, 2), rids[0], reader));
+  CheckAborted(reader);
+  GetTxnManager()->Abort(reader);
+  delete reader;
+}
+
+// NOLINTNEXTLINE
+TEST_F(TransactionTest, VersionGarbageCollectionTest) {
+  auto table_info = GetCatalog()->GetTable("empty_table2");
+  auto table = table_info->table_.get();
+  auto &schema = table_info->schema_;
+  auto make_tuple = [&](int a, int b) {
+    return Tuple({ValueFactory::GetIntegerValue(a), ValueFactory::GetIntegerValue(b)}, &schema);
+  };
+  auto version_store = table->GetVersionStore();
+  auto txn0 = GetTxnManager()->Begin();
+  RID rid;
+  ASSERT_TRUE(table->InsertTuple(make_tuple(0, 0), &rid, txn0));
+  GetTxnManager()->Commit(txn0);
+  delete txn0;
+  // Nobody can see the version before the insert, the commit pruned it.
+  EXPECT_EQ(version_store->GetNumChains(), 0);
+
+  auto reader = GetTxnManager()->Begin(nullptr, IsolationLevel::SNAPSHOT);
+  for (int i = 1; i <= 5; i++) {
+    auto writer = GetTxnManager()->Begin();
+    ASSERT_TRUE(table->UpdateTuple(make_tuple(0, i), rid, writer));
+    GetTxnManager()->Commit(writer);
+    delete writer;
+  }
+  // The reader holds back the watermark, so the versions in between stay until it finishes.
+  EXPECT_EQ(version_store->GetNumVersions(), 5);
+  Tuple tuple;
+  ASSERT_TRUE(table->GetTuple(rid, &tuple, reader));
+  EXPECT_EQ(tuple.GetValue(&schema, 1).GetAs<int32_t>(), 0);
+
+  auto interval = version_gc_interval;
+  version_gc_interval = std::chrono::milliseconds(10);
+  GetTxnManager()->StartGarbageCollection();
+  GetTxnManager()->Commit(reader);
+  delete reader;
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_EQ(version_store->GetNumChains(), 0);
+  GetTxnManager()->StopGarbageCollection();
+  version_gc_interval = interval;
+}
+
+// NOLINTNEXTLINE
+TEST_F(TransactionTest, OptimisticTransactionTest) {
+  auto table_info = GetCatalog()->GetTable("empty_table2");
+  auto table = table_info->table_.get();
+  auto &schema = table_info->schema_;
+  auto make_tuple = [&](int a, int b) {
+    return Tuple({ValueFactory::GetIntegerValue(a), ValueFactory::GetIntegerValue(b)}, &schema);
+  };
+  auto value = [&](const RID &rid, Transaction *txn) {
+    Tuple tuple;
+    EXPECT_TRUE(table->GetTuple(rid, &tuple, txn));
+    return tuple.GetValue(&schema, 1).GetAs<int32_t>();
+  };
+  auto txn0 = GetTxnManager()->Begin();
+  RID rid0;
+  RID rid1;
+  ASSERT_TRUE(table->InsertTuple(make_tuple(0, 0), &rid0, txn0));
+  ASSERT_TRUE(table->InsertTuple(make_tuple(1, 0), &rid1, txn0));
+  GetTxnManager()->Commit(txn0);
+  delete txn0;
+
+  // The writes are buffered until the commit, only the transaction itself sees them.
+  GetTxnManager()->SetOptimistic(true);
+  auto txn1 = GetTxnManager()->Begin();
+  ASSERT_TRUE(txn1->IsOptimistic());
+  ASSERT_TRUE(table->UpdateTuple(make_tuple(1, 1), rid1, txn1));
+  EXPECT_EQ(value(rid1, txn1), 1);
+  auto txn2 = GetTxnManager()->Begin();
+  EXPECT_EQ(value(rid1, txn2), 0);
+  GetTxnManager()->Commit(txn2);
+  delete txn2;
+  GetTxnManager()->Commit(txn1);
+  delete txn1;
+  GetTxnManager()->SetOptimistic(false);
+  auto txn3 = GetTxnManager()->Begin();
+  EXPECT_EQ(value(rid1, txn3), 1);
+  GetTxnManager()->Commit(txn3);
+  delete txn3;
+
+  // A transaction that read a tuple somebody changed since fails validation, and its writes never happen.
+  GetTxnManager()->SetOptimistic(true);
+  auto txn4 = GetTxnManager()->Begin();
+  EXPECT_EQ(value(rid0, txn4), 0);
+  ASSERT_TRUE(table->UpdateTuple(make_tuple(1, 2), rid1, txn4));
+  ASSERT_TRUE(table->MarkDelete(rid0, txn4));
+  Tuple deleted;
+  EXPECT_FALSE(table->GetTuple(rid0, &deleted, txn4));
+  GetTxnManager()->SetOptimistic(false);
+  auto txn5 = GetTxnManager()->Begin();
+  ASSERT_TRUE(table->UpdateTuple(make_tuple(0, 5), rid0, txn5));
+  GetTxnManager()->Commit(txn5);
+  delete txn5;
+  EXPECT_THROW(GetTxnManager()->Commit(txn4), TransactionAbortException);
+  CheckAborted(txn4);
+  GetTxnManager()->Abort(txn4);
+  delete txn4;
+  auto txn6 = GetTxnManager()->Begin();
+  EXPECT_EQ(value(rid0, txn6), 5);
+  EXPECT_EQ(value(rid1, txn6), 1);
+  GetTxnManager()->Commit(txn6);
+  delete txn6;
+}
+
+// NOLINTNEXTLINE
+TEST_F(TransactionTest, OptimisticWoundTest) {
+  auto table_info = GetCatalog()->GetTable("empty_table2");
+  auto table = table_info->table_.get();
+  auto &schema = table_info->schema_;
+  auto make_tuple = [&](int a, int b) {
+    return Tuple({ValueFactory::GetIntegerValue(a), ValueFactory::GetIntegerValue(b)}, &schema);
+  };
+  auto txn0 = GetTxnManager()->Begin();
+  RID rid0;
+  RID rid1;
+  ASSERT_TRUE(table->InsertTuple(make_tuple(0, 0), &rid0, txn0));
+  ASSERT_TRUE(table->InsertTuple(make_tuple(1, 0), &rid1, txn0));
+  ASSERT_LT(rid0.Get(), rid1.Get());
+  GetTxnManager()->Commit(txn0);
+  delete txn0;
+
+  // The younger optimistic transaction locks rid0 at commit and waits for rid1, which the older two-phase locking
+  // transaction holds. When the older one asks for rid0, it wounds the committing one instead of waiting forever.
+  auto older = GetTxnManager()->Begin();
+  GetTxnManager()->SetOptimistic(true);
+  auto younger = GetTxnManager()->Begin();
+  GetTxnManager()->SetOptimistic(false);
+  ASSERT_TRUE(table->UpdateTuple(make_tuple(0, 1), rid0, younger));
+  ASSERT_TRUE(table->UpdateTuple(make_tuple(1, 1), rid1, younger));
+  ASSERT_TRUE(GetLockManager()->LockExclusive(older, rid1));
+  std::thread commit_thread([&] {
+    EXPECT_THROW(GetTxnManager()->Commit(younger), TransactionAbortException);
+    CheckAborted(younger);
+    GetTxnManager()->Abort(younger);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_TRUE(younger->IsExclusiveLocked(rid0));
+  ASSERT_TRUE(GetLockManager()->LockExclusive(older, rid0));
+  commit_thread.join();
+  ASSERT_TRUE(table->UpdateTuple(make_tuple(0, 2), rid0, older));
+  GetTxnManager()->Commit(older);
+  delete older;
+  delete younger;
+
+  auto txn1 = GetTxnManager()->Begin();
+  Tuple tuple;
+  ASSERT_TRUE(table->GetTuple(rid0, &tuple, txn1));
+  EXPECT_EQ(tuple.GetValue(&schema, 1).GetAs<int32_t>(), 2);
+  ASSERT_TRUE(table->GetTuple(rid1, &tuple, txn1));
+  EXPECT_EQ(tuple.GetValue(&schema, 1).GetAs<int32_t>(), 0);
+  GetTxnManager()->Commit(txn1);
+  delete txn1;
+}
+
+// NOLINTNEXTLINE
+TEST_F(TransactionTest, ReadOnlyTransactionTest) {
+  auto table_info = GetCatalog()->GetTable("empty_table2");
+  auto table = table_info->table_.get();
+  auto &schema = table_info->schema_;
+  auto make_tuple = [&](int a, int b) {
+    return Tuple({ValueFactory::GetIntegerValue(a), ValueFactory::GetIntegerValue(b)}, &schema);
+  };
+  auto txn0 = GetTxnManager()->Begin();
+  RID rid;
+  ASSERT_TRUE(table->InsertTuple(make_tuple(0, 0), &rid, txn0));
+  GetTxnManager()->Commit(txn0);
+  delete txn0;
+
+  // A snapshot reader has no write sets and does not see a later write.
+  auto reader = GetTxnManager()->BeginReadOnly();
+  EXPECT_TRUE(reader->IsReadOnly());
+  EXPECT_EQ(reader->GetWriteSet(), nullptr);
+  auto writer = GetTxnManager()->Begin();
+  ASSERT_TRUE(table->UpdateTuple(make_tuple(0, 1), rid, writer));
+  GetTxnManager()->Commit(writer);
+  delete writer;
+  Tuple tuple;
+  ASSERT_TRUE(table->GetTuple(rid, &tuple, reader));
+  EXPECT_EQ(tuple.GetValue(&schema, 1).GetAs<int32_t>(), 0);
+  GetTxnManager()->Commit(reader);
+  CheckCommitted(reader);
+  delete reader;
+
+  // A locking reader is visible to the lock manager, reads the latest version, and aborts when it tries to write.
+  auto locking_reader = GetTxnManager()->BeginReadOnly(IsolationLevel::REPEATABLE_READ);
+  EXPECT_EQ(TransactionManager::GetTransaction(locking_reader->GetTransactionId()), locking_reader);
+  ASSERT_TRUE(table->GetTuple(rid, &tuple, locking_reader));
+  EXPECT_EQ(tuple.GetValue(&schema, 1).GetAs<int32_t>(), 1);
+  try {
+    table->MarkDelete(rid, locking_reader);
+    FAIL();
+  } catch (TransactionAbortException &e) {
+    EXPECT_EQ(e.GetAbortReason(), AbortReason::WRITE_ON_READ_ONLY);
+  }
+  CheckAborted(locking_reader);
+  GetTxnManager()->Abort(locking_reader);
+  CheckTxnLockSize(locking_reader, 0, 0);
+  delete locking_reader;
+}
+
+// NOLINTNEXTLINE
+TEST(TransactionManagerTest, RowLockOutsidePageLatchTest) {
+  auto *bustub_instance = new BustubInstance("row_lock_test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+  ASSERT_TRUE(enable_logging);
+  auto txn_mgr = bustub_instance->transaction_manager_;
+  Schema schema{std::vector<Column>{Column{"a", TypeId::INTEGER}}};
+
+  auto txn0 = txn_mgr->Begin();
+  TableHeap table(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                  bustub_instance->log_manager_, txn0);
+  RID first_rid;
+  RID rid;
+  RID deleted_rid;
+  ASSERT_TRUE(table.InsertTuple(Tuple({ValueFactory::GetIntegerValue(0)}, &schema), &first_rid, txn0));
+  ASSERT_TRUE(table.InsertTuple(Tuple({ValueFactory::GetIntegerValue(0)}, &schema), &rid, txn0));
+  ASSERT_TRUE(table.InsertTuple(Tuple({ValueFactory::GetIntegerValue(0)}, &schema), &deleted_rid, txn0));
+  ASSERT_EQ(rid.GetPageId(), deleted_rid.GetPageId());
+  txn_mgr->Commit(txn0);
+  delete txn0;
+
+  // The younger reader and scanner wait for the row lock of the older writer. The writer's commit applies its delete
+  // of another row under the latch of the same page, so they must not be holding the latch while they wait.
+  auto writer = txn_mgr->Begin();
+  auto reader = txn_mgr->Begin();
+  auto scanner = txn_mgr->Begin();
+  ASSERT_TRUE(table.UpdateTuple(Tuple({ValueFactory::GetIntegerValue(1)}, &schema), rid, writer));
+  ASSERT_TRUE(table.MarkDelete(deleted_rid, writer));
+  std::atomic<int> reads_done{0};
+  Tuple tuple;
+  bool found = false;
+  std::thread read_thread([&] {
+    found = table.GetTuple(rid, &tuple, reader);
+    reads_done++;
+  });
+  Tuple scanned;
+  std::thread scan_thread([&] {
+    auto it = table.Begin(scanner);
+    scanned = *++it;
+    reads_done++;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(reads_done, 0);
+  txn_mgr->Commit(writer);
+  read_thread.join();
+  scan_thread.join();
+  ASSERT_TRUE(found);
+  EXPECT_EQ(tuple.GetValue(&schema, 0).GetAs<int32_t>(), 1);
+  EXPECT_EQ(scanned.GetRid(), rid);
+  EXPECT_EQ(scanned.GetValue(&schema, 0).GetAs<int32_t>(), 1);
+  txn_mgr->Commit(reader);
+  txn_mgr->Commit(scanner);
+  delete writer;
+  delete reader;
+  delete scanner;
+
+  delete bustub_instance;
+  EXPECT_FALSE(enable_logging);
+  remove("row_lock_test.db");
+  remove("row_lock_test.log");
+  remove("row_lock_test.log.0");
+}
+
+// NOLINTNEXTLINE
+TEST(TransactionManagerTest, DeletedWhileWaitingTest) {
+  auto *bustub_instance = new BustubInstance("row_lock_test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+  auto txn_mgr = bustub_instance->transaction_manager_;
+  Schema schema{std::vector<Column>{Column{"a", TypeId::INTEGER}}};
+
+  auto txn0 = txn_mgr->Begin();
+  TableHeap table(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                  bustub_instance->log_manager_, txn0);
+  std::vector<RID> rids(3);
+  for (int i = 0; i < 3; i++) {
+    ASSERT_TRUE(table.InsertTuple(Tuple({ValueFactory::GetIntegerValue(i)}, &schema), &rids[i], txn0));
+  }
+  txn_mgr->Commit(txn0);
+  delete txn0;
+
+  // The younger reader and scanner wait for the row the older writer updates, which it then deletes and commits.
+  auto writer = txn_mgr->Begin();
+  auto reader = txn_mgr->Begin();
+  auto scanner = txn_mgr->Begin(nullptr, IsolationLevel::READ_COMMITTED);
+  ASSERT_TRUE(table.UpdateTuple(Tuple({ValueFactory::GetIntegerValue(10)}, &schema), rids[1], writer));
+  bool found = true;
+  std::thread read_thread([&] {
+    Tuple tuple;
+    found = table.GetTuple(rids[1], &tuple, reader);
+  });
+  std::vector<int32_t> scanned;
+  std::thread scan_thread([&] {
+    for (auto it = table.Begin(scanner); it != table.End(); ++it) {
+      scanned.push_back(it->GetValue(&schema, 0).GetAs<int32_t>());
+    }
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_TRUE(table.MarkDelete(rids[1], writer));
+  txn_mgr->Commit(writer);
+  read_thread.join();
+  scan_thread.join();
+
+  // The deleted row is skipped, neither its bytes nor an abort leak into the readers.
+  EXPECT_FALSE(found);
+  EXPECT_EQ(reader->GetState(), TransactionState::GROWING);
+  EXPECT_EQ(scanned, (std::vector<int32_t>{0, 2}));
+  EXPECT_EQ(scanner->GetState(), TransactionState::GROWING);
+  txn_mgr->Commit(reader);
+  txn_mgr->Commit(scanner);
+  delete writer;
+  delete reader;
+  delete scanner;
+
+  delete bustub_instance;
+  remove("row_lock_test.db");
+  remove("row_lock_test.log");
+  remove("row_lock_test.log.0");
+}
+
+// NOLINTNEXTLINE
+TEST(TransactionManagerTest, AbortedInsertTest) {
+  auto *bustub_instance = new BustubInstance("row_lock_test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+  auto txn_mgr = bustub_instance->transaction_manager_;
+  Schema schema{std::vector<Column>{Column{"a", TypeId::INTEGER}}};
+  Tuple tuple({ValueFactory::GetIntegerValue(0)}, &schema);
+
+  auto txn0 = txn_mgr->Begin();
+  TableHeap table(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                  bustub_instance->log_manager_, txn0);
+  txn_mgr->Commit(txn0);
+  delete txn0;
+
+  // A wounded transaction cannot lock its new tuple, so the insert fails.
+  RID rid;
+  auto wounded = txn_mgr->Begin();
+  wounded->SetState(TransactionState::ABORTED);
+  EXPECT_FALSE(table.InsertTuple(tuple, &rid, wounded));
+  txn_mgr->Abort(wounded);
+  delete wounded;
+
+  // Locking the new tuple throws for a shrinking transaction, which leaves the page unlatched.
+  auto shrinking = txn_mgr->Begin();
+  shrinking->SetState(TransactionState::SHRINKING);
+  EXPECT_THROW(table.InsertTuple(tuple, &rid, shrinking), TransactionAbortException);
+  txn_mgr->Abort(shrinking);
+  delete shrinking;
+
+  auto txn1 = txn_mgr->Begin();
+  EXPECT_TRUE(table.InsertTuple(tuple, &rid, txn1));
+  txn_mgr->Commit(txn1);
+  delete txn1;
+
+  delete bustub_instance;
+  remove("row_lock_test.db");
+  remove("row_lock_test.log");
+  remove("row_lock_test.log.0");
+}
+
+// Transactions increment two counters out of num_rows, under two-phase locking or optimistically. Two-phase locking
+// takes the exclusive locks before reading, in the order of the rows, under deadlock detection so that nobody is
+// wounded in the middle of a write. Every committed increment must be in the table. With report, print the throughput.
+void OptimisticWorkload(TransactionTest *test, bool optimistic, int num_rows, int txns_per_thread, bool report) {
+  auto table_info = test->GetCatalog()->GetTable("empty_table2");
+  auto table = table_info->table_.get();
+  auto &schema = table_info->schema_;
+  LockManager lock_mgr{LockManager::DeadlockMode::DETECTION};
+  TransactionManager txn_mgr{&lock_mgr};
+  const int num_threads = 8;
+
+  auto txn0 = txn_mgr.Begin();
+  std::vector<RID> rids(num_rows);
+  for (int i = 0; i < num_rows; i++) {
+    Tuple tuple({ValueFactory::GetIntegerValue(i), ValueFactory::GetIntegerValue(0)}, &schema);
+    ASSERT_TRUE(table->InsertTuple(tuple, &rids[i], txn0));
+  }
+  txn_mgr.Commit(txn0);
+  delete txn0;
+
+  txn_mgr.SetOptimistic(optimistic);
+  std::atomic<int> commits{0};
+  std::atomic<int> aborts{0};
+  auto task = [&](int thread_id) {
+    std::mt19937 gen(thread_id);
+    std::uniform_int_distribution<int> row_dist(0, num_rows - 1);
+    for (int i = 0; i < txns_per_thread; i++) {
+      int first = row_dist(gen);
+      int second = row_dist(gen);
+      while (second == first) {
+        second = row_dist(gen);
+      }
+      Transaction *txn = txn_mgr.Begin();
+      try {
+        if (!optimistic) {
+          lock_mgr.LockExclusive(txn, rids[std::min(first, second)]);
+          lock_mgr.LockExclusive(txn, rids[std::max(first, second)]);
+        }
+        for (int row : {first, second}) {
+          Tuple tuple;
+          if (!table->GetTuple(rids[row], &tuple, txn)) {
+            throw TransactionAbortException(txn->GetTransactionId(), AbortReason::DEADLOCK);
+          }
+          Tuple updated({ValueFactory::GetIntegerValue(row),
+                         ValueFactory::GetIntegerValue(tuple.GetValue(&schema, 1).GetAs<int32_t>() + 1)},
+                        &schema);
+          if (!table->UpdateTuple(updated, rids[row], txn)) {
+            throw TransactionAbortException(txn->GetTransactionId(), AbortReason::DEADLOCK);
+          }
+        }
+        txn_mgr.Commit(txn);
+        commits++;
+      } catch (TransactionAbortException &e) {
+        txn_mgr.Abort(txn);
+        aborts++;
+      }
+      delete txn;
+    }
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads);
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back(task, i);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  auto txn = txn_mgr.Begin();
+  int64_t increments = 0;
+  for (const RID &rid : rids) {
+    Tuple tuple;
+    ASSERT_TRUE(table->GetTuple(rid, &tuple, txn));
+    increments += tuple.GetValue(&schema, 1).GetAs<int32_t>();
+  }
+  txn_mgr.Commit(txn);
+  delete txn;
+  EXPECT_EQ(increments, 2 * commits);
+  if (report) {
+    std::cout << (optimistic ? "occ, " : "2pl, ") << num_rows << " rows: " << static_cast<int>(commits / elapsed)
+              << " txns/s, " << aborts << " aborts" << std::endl;
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_F(TransactionTest, ConcurrentOptimisticTest) {
+  OptimisticWorkload(this, false, 10, 50, false);
+  OptimisticWorkload(this, true, 10, 50, false);
+}
+
+// NOLINTNEXTLINE
+TEST_F(TransactionTest, DISABLED_LowContentionBenchmark) {
+  OptimisticWorkload(this, false, 1000, 500, true);
+  OptimisticWorkload(this, true, 1000, 500, true);
+}
+
+// NOLINTNEXTLINE
+TEST_F(TransactionTest, DISABLED_HighContentionBenchmark) {
+  OptimisticWorkload(this, false, 10, 500, true);
+  OptimisticWorkload(this, true, 10, 500, true);
+}
+
+// NOLINTNEXTLINE
+TEST_F(TransactionTest, EscrowUpdateTest) {
+  auto table_info = GetCatalog()->GetTable("empty_table2");
+  auto table = table_info->table_.get();
+  auto &schema = table_info->schema_;
+  auto txn0 = GetTxnManager()->Begin();
+  RID rid0;
+  RID rid1;
+  ASSERT_TRUE(table->InsertTuple(
+      Tuple({ValueFactory::GetIntegerValue(0), ValueFactory::GetIntegerValue(0)}, &schema), &rid0, txn0));
+  ASSERT_TRUE(table->InsertTuple(
+      Tuple({ValueFactory::GetIntegerValue(1), ValueFactory::GetIntegerValue(0)}, &schema), &rid1, txn0));
+  GetTxnManager()->Commit(txn0);
+  delete txn0;
+
+  // UPDATE empty_table2 SET colB = colB + val WHERE colA = 1
+  auto *col_a = MakeColumnValueExpression(schema, 0, "colA");
+  auto *col_b = MakeColumnValueExpression(schema, 0, "colB");
+  auto *one = MakeConstantValueExpression(ValueFactory::GetIntegerValue(1));
+  auto *predicate = MakeComparisonExpression(col_a, one, ComparisonType::Equal);
+  auto *scan_schema = MakeOutputSchema({{"colA", col_a}, {"colB", col_b}});
+  SeqScanPlanNode scan_plan{scan_schema, predicate, table_info->oid_};
+  auto update = [&](Transaction *txn, UpdateType type, int val) {
+    UpdatePlanNode update_plan{&scan_plan, table_info->oid_, {{1, UpdateInfo(type, val)}}};
+    ExecutorContext exec_ctx{txn, GetCatalog(), GetBPM(), GetTxnManager(), GetLockManager()};
+    GetExecutionEngine()->Execute(&update_plan, nullptr, txn, &exec_ctx);
+  };
+  auto value = [&](const RID &rid, Transaction *txn, LockMode row_mode) {
+    Tuple tuple;
+    EXPECT_TRUE(table->GetTuple(rid, &tuple, txn, row_mode));
+    return tuple.GetValue(&schema, 1).GetAs<int32_t>();
+  };
+
+  // Rows are only locked when logging is enabled.
+  GetLogManager()->RunFlushThread();
+  ASSERT_TRUE(enable_logging);
+
+  // Both transactions increment the tuple at the same time under increment locks, each sees its own increment until
+  // it commits. The scan under READ_COMMITTED lets go of the row that does not match.
+  auto txn1 = GetTxnManager()->Begin();
+  auto txn2 = GetTxnManager()->Begin(nullptr, IsolationLevel::READ_COMMITTED);
+  update(txn1, UpdateType::Add, 5);
+  update(txn2, UpdateType::Add, 3);
+  update(txn2, UpdateType::Add, 4);
+  CheckGrowing(txn1);
+  CheckGrowing(txn2);
+  EXPECT_EQ(txn1->GetDeltaSet()->size(), 1);
+  EXPECT_TRUE(txn1->IsIncrementLocked(rid1));
+  EXPECT_TRUE(txn2->IsIncrementLocked(rid1));
+  EXPECT_TRUE(txn1->IsIncrementLocked(rid0));
+  EXPECT_FALSE(txn2->IsIncrementLocked(rid0));
+  EXPECT_EQ(LockMode::INTENTION_EXCLUSIVE, txn1->GetTableLockSet()->at(table_info->oid_));
+  EXPECT_EQ(value(rid1, txn1, LockMode::INCREMENT), 5);
+  EXPECT_EQ(value(rid1, txn2, LockMode::INCREMENT), 7);
+  GetTxnManager()->Commit(txn1);
+  delete txn1;
+  // An abort drops the increments.
+  GetTxnManager()->Abort(txn2);
+  delete txn2;
+
+  // A SET is not an increment, it updates the tuple in place.
+  auto txn3 = GetTxnManager()->Begin(nullptr, IsolationLevel::READ_COMMITTED);
+  EXPECT_EQ(value(rid1, txn3, LockMode::SHARED), 5);
+  update(txn3, UpdateType::Set, 10);
+  EXPECT_TRUE(txn3->GetDeltaSet()->empty());
+  EXPECT_TRUE(txn3->IsExclusiveLocked(rid1));
+  update(txn3, UpdateType::Add, 1);
+  CheckGrowing(txn3);
+  GetTxnManager()->Commit(txn3);
+  delete txn3;
+  auto txn4 = GetTxnManager()->Begin(nullptr, IsolationLevel::READ_COMMITTED);
+  EXPECT_EQ(value(rid0, txn4, LockMode::SHARED), 0);
+  EXPECT_EQ(value(rid1, txn4, LockMode::SHARED), 11);
+  GetTxnManager()->Commit(txn4);
+  delete txn4;
+
+  GetLogManager()->StopFlushThread();
+  EXPECT_FALSE(enable_logging);
+}
+
+/**
+ * Increment one hot tuple on a few threads with UPDATE hot_counter SET colB = colB + 1. An index on the counter keeps
+ * the update from being applied as escrow increments, so it reads and writes the tuple under an exclusive lock. With
+ * report, print the throughput.
+ */
+void HotCounterWorkload(TransactionTest *test, bool escrow, int txns_per_thread, bool report) {
+  const std::string table_name = escrow ? "hot_counter_escrow" : "hot_counter";
+  const int num_threads = 8;
+  TransactionManager *txn_mgr = test->GetTxnManager();
+  Catalog *catalog = test->GetCatalog();
+
+  // The index build waits for the writers older than its transaction, like the one of the test.
+  Schema schema{std::vector<Column>{Column{"colA", TypeId::INTEGER}, Column{"colB", TypeId::INTEGER}}};
+  TableInfo *table_info = catalog->CreateTable(test->GetTxn(), table_name, schema);
+  if (!escrow) {
+    Schema key_schema{std::vector<Column>{schema.GetColumn(1)}};
+    catalog->CreateIndex<GenericKey<8>, RID, GenericComparator<8>>(test->GetTxn(), table_name + "_colB", table_name,
+                                                                   schema, key_schema, {1}, 8,
+                                                                   HashFunction<GenericKey<8>>{});
+  }
+  auto txn0 = txn_mgr->Begin();
+  RID rid;
+  ASSERT_TRUE(table_info->table_->InsertTuple(
+      Tuple({ValueFactory::GetIntegerValue(0), ValueFactory::GetIntegerValue(0)}, &schema), &rid, txn0));
+  txn_mgr->Commit(txn0);
+  delete txn0;
+
+  auto *col_a = test->MakeColumnValueExpression(schema, 0, "colA");
+  auto *col_b = test->MakeColumnValueExpression(schema, 0, "colB");
+  SeqScanPlanNode scan_plan{test->MakeOutputSchema({{"colA", col_a}, {"colB", col_b}}), nullptr, table_info->oid_};
+  UpdatePlanNode update_plan{&scan_plan, table_info->oid_, {{1, UpdateInfo(UpdateType::Add, 1)}}};
+
+  std::atomic<int> commits{0};
+  std::atomic<int> aborts{0};
+  auto task = [&] {
+    for (int i = 0; i < txns_per_thread; i++) {
+      Transaction *txn = txn_mgr->Begin(nullptr, IsolationLevel::READ_COMMITTED);
+      ExecutorContext exec_ctx{txn, catalog, test->GetBPM(), txn_mgr, test->GetLockManager()};
+      try {
+        test->GetExecutionEngine()->Execute(&update_plan, nullptr, txn, &exec_ctx);
+        // The rest of the transaction, with the lock held.
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        // An older transaction may have wounded this one in the meantime.
+        if (txn->GetState() == TransactionState::ABORTED) {
+          throw TransactionAbortException(txn->GetTransactionId(), AbortReason::DEADLOCK);
+        }
+        txn_mgr->Commit(txn);
+        commits++;
+      } catch (TransactionAbortException &e) {
+        txn_mgr->Abort(txn);
+        aborts++;
+      }
+      delete txn;
+    }
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads);
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back(task);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  auto txn = txn_mgr->Begin();
+  Tuple tuple;
+  ASSERT_TRUE(table_info->table_->GetTuple(rid, &tuple, txn));
+  txn_mgr->Commit(txn);
+  delete txn;
+  EXPECT_EQ(tuple.GetValue(&schema, 1).GetAs<int32_t>(), commits);
+  if (escrow) {
+    EXPECT_EQ(aborts, 0);
+  }
+  if (report) {
+    std::cout << (escrow ? "escrow: " : "exclusive: ") << static_cast<int>(commits / elapsed) << " txns/s, "
+              << aborts << " aborts" << std::endl;
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_F(TransactionTest, ConcurrentEscrowUpdateTest) {
+  GetLogManager()->RunFlushThread();
+  HotCounterWorkload(this, true, 20, false);
+  GetLogManager()->StopFlushThread();
+}
+
+// NOLINTNEXTLINE
+TEST_F(TransactionTest, DISABLED_HotCounterBenchmark) {
+  GetLogManager()->RunFlushThread();
+  HotCounterWorkload(this, false, 100, true);
+  HotCounterWorkload(this, true, 100, true);
+  GetLogManager()->StopFlushThread();
+}
+
+/** Begin and commit empty transactions on a few threads, returning them to the pool or deleting them. */
+void BeginCommitBenchmark(bool pooled, int num_threads) {
+  const int num_txns = 20000;
+  LockManager lock_mgr;
+  TransactionManager txn_mgr(&lock_mgr);
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back([&] {
+      for (int j = 0; j < num_txns; j++) {
+        auto txn = txn_mgr.Begin();
+        txn_mgr.Commit(txn);
+        if (pooled) {
+          txn_mgr.Recycle(txn);
+        } else {
+          delete txn;
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << (pooled ? "pooled, " : "new/delete, ") << num_threads << " threads: "
+            << static_cast<int>(num_threads * num_txns / elapsed) << " txns/s" << std::endl;
+}
+
+// NOLINTNEXTLINE
+TEST(TransactionManagerTest, PooledTransactionTest) {
+  LockManager lock_mgr;
+  TransactionManager txn_mgr(&lock_mgr);
+  auto txn = txn_mgr.Begin(nullptr, IsolationLevel::READ_COMMITTED);
+  RID rid{0, 0};
+  lock_mgr.LockExclusive(txn, rid);
+  txn->SetAsyncCommit(true);
+  txn_mgr.Commit(txn);
+  txn_mgr.Recycle(txn);
+
+  // The pooled object comes back as a fresh transaction.
+  auto reused = txn_mgr.Begin();
+  EXPECT_EQ(reused, txn);
+  EXPECT_EQ(reused->GetTransactionId(), 1);
+  EXPECT_EQ(reused->GetState(), TransactionState::GROWING);
+  EXPECT_EQ(reused->GetIsolationLevel(), IsolationLevel::REPEATABLE_READ);
+  EXPECT_FALSE(reused->IsAsyncCommit());
+  EXPECT_TRUE(reused->GetExclusiveLockSet()->empty());
+  EXPECT_EQ(TransactionManager::GetTransaction(1), reused);
+
+  // Once the containers and every shard of the transaction map have their memory, an empty transaction does not
+  // allocate anymore.
+  txn_mgr.Commit(reused);
+  txn_mgr.Recycle(reused);
+  size_t allocations = 0;
+  for (size_t i = 0; i < 1000 + TransactionManager::TXN_MAP_SHARDS; i++) {
+    if (i == TransactionManager::TXN_MAP_SHARDS) {
+      allocations = num_allocations;
+    }
+    auto next = txn_mgr.Begin();
+    txn_mgr.Commit(next);
+    txn_mgr.Recycle(next);
+  }
+  EXPECT_EQ(num_allocations - allocations, 0);
+}
+
+// NOLINTNEXTLINE
+TEST(TransactionManagerTest, DISABLED_BeginCommitBenchmark) {
+  for (int num_threads : {1, 4}) {
+    BeginCommitBenchmark(false, num_threads);
+    BeginCommitBenchmark(true, num_threads);
+  }
+}
+
 }  // namespace bustub
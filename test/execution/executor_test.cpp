@@ -31,7 +31,9 @@
 #include "execution/plans/delete_plan.h"
 #include "execution/plans/distinct_plan.h"
 #include "execution/plans/hash_join_plan.h"
+#include "execution/plans/index_scan_plan.h"
 #include "execution/plans/limit_plan.h"
+#include "execution/plans/nested_index_join_plan.h"
 #include "execution/plans/seq_scan_plan.h"
 #include "execution/plans/update_plan.h"
 #include "executor_test_util.h"  // NOLINT
@@ -50,7 +52,9 @@
  * - Insert (Select)
  * - Update
  * - Delete
+ * - Index Scan
  * - Nested Loop Join
+ * - Nested Index Join
  * - Hash Join
  * - Aggregation
  * - Limit
@@ -87,7 +91,7 @@ using ComparatorType = GenericComparator<8>;
 using HashFunctionType = HashFunction<KeyType>;
 
 // SELECT col_a, col_b FROM test_1 WHERE col_a < 500
-TEST_F(ExecutorTest, DISABLED_SimpleSeqScanTest) {
+TEST_F(ExecutorTest, SimpleSeqScanTest) {
   // Construct query plan
   TableInfo *table_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
   const Schema &schema = table_info->schema_;
@@ -110,6 +114,37 @@ TEST_F(ExecutorTest, DISABLED_SimpleSeqScanTest) {
   }
 }
 
+// SELECT colA FROM test_1, under a single table lock
+TEST_F(ExecutorTest, SeqScanTableLockTest) {
+  TableInfo *table_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
+  auto *col_a = MakeColumnValueExpression(table_info->schema_, 0, "colA");
+  auto *out_schema = MakeOutputSchema({{"colA", col_a}});
+  SeqScanPlanNode plan{out_schema, nullptr, table_info->oid_};
+
+  std::vector<Tuple> result_set{};
+  GetExecutionEngine()->Execute(&plan, &result_set, GetTxn(), GetExecutorContext());
+  ASSERT_EQ(result_set.size(), TEST1_SIZE);
+
+  // REPEATABLE_READ reads the table under a SHARED table lock, which covers the rows
+  ASSERT_EQ(1, GetTxn()->GetTableLockSet()->size());
+  ASSERT_EQ(LockMode::SHARED, GetTxn()->GetTableLockSet()->at(table_info->oid_));
+  ASSERT_TRUE(GetTxn()->GetSharedLockSet()->empty());
+
+  // READ_COMMITTED locks each row while it reads it, rows are only locked when logging is enabled
+  auto *txn = GetTxnManager()->Begin(nullptr, IsolationLevel::READ_COMMITTED);
+  ExecutorContext exec_ctx{txn, GetCatalog(), GetBPM(), GetTxnManager(), GetLockManager()};
+  enable_logging = true;
+  result_set.clear();
+  GetExecutionEngine()->Execute(&plan, &result_set, txn, &exec_ctx);
+  enable_logging = false;
+  ASSERT_EQ(result_set.size(), TEST1_SIZE);
+  ASSERT_EQ(LockMode::INTENTION_SHARED, txn->GetTableLockSet()->at(table_info->oid_));
+  ASSERT_TRUE(txn->GetSharedLockSet()->empty());
+  ASSERT_EQ(TransactionState::GROWING, txn->GetState());
+  GetTxnManager()->Commit(txn);
+  delete txn;
+}
+
 // INSERT INTO empty_table2 VALUES (100, 10), (101, 11), (102, 12)
 TEST_F(ExecutorTest, DISABLED_SimpleRawInsertTest) {
   // Create Values to insert
@@ -653,4 +688,129 @@ TEST_F(ExecutorTest, DISABLED_SimpleDistinctTest) {
   ASSERT_TRUE(std::equal(results.cbegin(), results.cend(), expected.cbegin()));
 }
 
+// SELECT colA, colB FROM test_1 WHERE colA < 500, through a B+ tree index on colA
+TEST_F(ExecutorTest, SimpleIndexScanTest) {
+  Catalog *catalog = GetExecutorContext()->GetCatalog();
+  TableInfo *table_info = catalog->GetTable("test_1");
+  const Schema &schema = table_info->schema_;
+  Schema key_schema{std::vector<Column>{schema.GetColumn(0)}};
+  IndexInfo *index_info = catalog->CreateIndex<KeyType, ValueType, ComparatorType>(
+      GetTxn(), "index_colA", "test_1", schema, key_schema, {0}, 8, HashFunctionType{}, IndexType::BPlusTreeIndex);
+  ASSERT_EQ(IndexType::BPlusTreeIndex, index_info->index_type_);
+
+  auto *col_a = MakeColumnValueExpression(schema, 0, "colA");
+  auto *col_b = MakeColumnValueExpression(schema, 0, "colB");
+  auto *const500 = MakeConstantValueExpression(ValueFactory::GetIntegerValue(500));
+  auto *predicate = MakeComparisonExpression(col_a, const500, ComparisonType::LessThan);
+  auto *out_schema = MakeOutputSchema({{"colA", col_a}, {"colB", col_b}});
+  IndexScanPlanNode plan{out_schema, predicate, index_info->index_oid_};
+
+  std::vector<Tuple> result_set{};
+  GetExecutionEngine()->Execute(&plan, &result_set, GetTxn(), GetExecutorContext());
+
+  // The tuples come back in key order
+  ASSERT_EQ(result_set.size(), 500);
+  for (size_t i = 0; i < result_set.size(); i++) {
+    ASSERT_EQ(static_cast<int32_t>(i),
+              result_set[i].GetValue(out_schema, out_schema->GetColIdx("colA")).GetAs<int32_t>());
+    ASSERT_TRUE(result_set[i].GetValue(out_schema, out_schema->GetColIdx("colB")).GetAs<int32_t>() < 10);
+  }
+}
+
+// SELECT colA, colB FROM test_1 WHERE colB BETWEEN 3 AND 5, through a B+ tree index on colB with duplicate keys
+TEST_F(ExecutorTest, IndexScanRangeTest) {
+  Catalog *catalog = GetExecutorContext()->GetCatalog();
+  TableInfo *table_info = catalog->GetTable("test_1");
+  const Schema &schema = table_info->schema_;
+  Schema key_schema{std::vector<Column>{schema.GetColumn(1)}};
+  IndexInfo *index_info = catalog->CreateIndex<KeyType, ValueType, ComparatorType>(
+      GetTxn(), "index_colB", "test_1", schema, key_schema, {1}, 8, HashFunctionType{}, IndexType::BPlusTreeIndex);
+
+  std::vector<RID> rids_of_3;
+  size_t expected = 0;
+  for (auto it = table_info->table_->Begin(GetTxn()); it != table_info->table_->End(); ++it) {
+    int32_t col_b = it->GetValue(&schema, 1).GetAs<int32_t>();
+    expected += static_cast<size_t>(col_b >= 3 && col_b <= 5);
+    if (col_b == 3) {
+      rids_of_3.push_back(it->GetRid());
+    }
+  }
+  ASSERT_GT(rids_of_3.size(), 1);
+
+  auto *col_a = MakeColumnValueExpression(schema, 0, "colA");
+  auto *col_b = MakeColumnValueExpression(schema, 0, "colB");
+  auto *const3 = MakeConstantValueExpression(ValueFactory::GetIntegerValue(3));
+  auto *const5 = MakeConstantValueExpression(ValueFactory::GetIntegerValue(5));
+  auto *out_schema = MakeOutputSchema({{"colA", col_a}, {"colB", col_b}});
+  IndexScanPlanNode plan{out_schema, nullptr, index_info->index_oid_, {const3}, {const5}};
+
+  // Every tuple in the range comes back, also those that share a key, and in key order.
+  std::vector<Tuple> result_set{};
+  GetExecutionEngine()->Execute(&plan, &result_set, GetTxn(), GetExecutorContext());
+  ASSERT_EQ(expected, result_set.size());
+  int32_t prev = 3;
+  for (const auto &tuple : result_set) {
+    int32_t value = tuple.GetValue(out_schema, out_schema->GetColIdx("colB")).GetAs<int32_t>();
+    ASSERT_LE(prev, value);
+    ASSERT_LE(value, 5);
+    prev = value;
+  }
+
+  // Deleting an entry removes only the entry of its RID.
+  Tuple key(std::vector<Value>{ValueFactory::GetIntegerValue(3)}, &key_schema);
+  index_info->index_->DeleteEntry(key, rids_of_3[0], GetTxn());
+  std::vector<RID> result;
+  index_info->index_->ScanKey(key, &result, GetTxn());
+  ASSERT_EQ(rids_of_3.size() - 1, result.size());
+  ASSERT_EQ(result.end(), std::find(result.begin(), result.end(), rids_of_3[0]));
+}
+
+// SELECT test_4.colA, test_4.colB, test_6.colA, test_6.colB FROM test_4 JOIN test_6 ON test_4.colA = test_6.colA,
+// with B+ tree indexes on both colA columns
+TEST_F(ExecutorTest, SimpleNestedIndexJoinTest) {
+  Catalog *catalog = GetExecutorContext()->GetCatalog();
+  TableInfo *outer_info = catalog->GetTable("test_4");
+  TableInfo *inner_info = catalog->GetTable("test_6");
+  Schema key_schema{std::vector<Column>{outer_info->schema_.GetColumn(0)}};
+  IndexInfo *outer_index = catalog->CreateIndex<KeyType, ValueType, ComparatorType>(
+      GetTxn(), "index_4", "test_4", outer_info->schema_, key_schema, {0}, 8, HashFunctionType{},
+      IndexType::BPlusTreeIndex);
+  catalog->CreateIndex<KeyType, ValueType, ComparatorType>(GetTxn(), "index_6", "test_6", inner_info->schema_,
+                                                           key_schema, {0}, 8, HashFunctionType{},
+                                                           IndexType::BPlusTreeIndex);
+
+  const Schema *out_schema1;
+  std::unique_ptr<AbstractPlanNode> scan_plan;
+  {
+    auto col_a = MakeColumnValueExpression(outer_info->schema_, 0, "colA");
+    auto col_b = MakeColumnValueExpression(outer_info->schema_, 0, "colB");
+    out_schema1 = MakeOutputSchema({{"colA", col_a}, {"colB", col_b}});
+    scan_plan = std::make_unique<IndexScanPlanNode>(out_schema1, nullptr, outer_index->index_oid_);
+  }
+
+  const Schema *out_final;
+  std::unique_ptr<NestedIndexJoinPlanNode> join_plan;
+  {
+    auto outer_col_a = MakeColumnValueExpression(*out_schema1, 0, "colA");
+    auto outer_col_b = MakeColumnValueExpression(*out_schema1, 0, "colB");
+    auto inner_col_a = MakeColumnValueExpression(inner_info->schema_, 1, "colA");
+    auto inner_col_b = MakeColumnValueExpression(inner_info->schema_, 1, "colB");
+    auto predicate = MakeComparisonExpression(outer_col_a, inner_col_a, ComparisonType::Equal);
+    out_final = MakeOutputSchema(
+        {{"colA", outer_col_a}, {"colB", outer_col_b}, {"colA2", inner_col_a}, {"colB2", inner_col_b}});
+    join_plan = std::make_unique<NestedIndexJoinPlanNode>(
+        out_final, std::vector<const AbstractPlanNode *>{scan_plan.get()}, predicate, inner_info->oid_, "index_6",
+        out_schema1, &inner_info->schema_);
+  }
+
+  std::vector<Tuple> result_set{};
+  GetExecutionEngine()->Execute(join_plan.get(), &result_set, GetTxn(), GetExecutorContext());
+  ASSERT_EQ(result_set.size(), TEST6_SIZE);
+  for (size_t i = 0; i < result_set.size(); i++) {
+    ASSERT_EQ(static_cast<int64_t>(i), result_set[i].GetValue(out_final, 0).GetAs<int64_t>());
+    ASSERT_EQ(result_set[i].GetValue(out_final, 0).GetAs<int64_t>(),
+              result_set[i].GetValue(out_final, 2).GetAs<int64_t>());
+  }
+}
+
 }  // namespace bustub
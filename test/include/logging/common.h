@@ -16,12 +16,20 @@
 #include <cstdio>
 #include <cstdlib>
 #include <random>
+#include <string>
 #include <vector>
 
 #include "storage/table/tuple.h"
 
 namespace bustub {
 
+// remove the segment files of a log, by default "test.log", the log of a DiskManager on "test.db"
+inline void RemoveLogSegments(const std::string &log_name = "test.log") {
+  for (int segment = 0; segment < 64; segment++) {
+    remove((log_name + "." + std::to_string(segment)).c_str());
+  }
+}
+
 // use a fixed schema to construct a random tuple
 Tuple ConstructTuple(Schema *schema) {
   std::vector<Value> values;
@@ -0,0 +1,435 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// log_manager_test.cpp
+//
+// Identification: test/recovery/log_manager_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <iostream>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "common/bustub_instance.h"
+#include "common/config.h"
+#include "concurrency/transaction_manager.h"
+#include "gtest/gtest.h"
+#include "logging/common.h"
+#include "recovery/log_manager.h"
+#include "storage/table/table_heap.h"
+#include "storage/table/tuple.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+class LogManagerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    remove("test.db");
+    remove("test.log");
+    RemoveLogSegments();
+  }
+
+  void TearDown() override {
+    remove("test.db");
+    remove("test.log");
+    RemoveLogSegments();
+  }
+};
+
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, FlushMakesRecordsPersistent) {
+  auto *bustub_instance = new BustubInstance("test.db");
+  LogManager *log_manager = bustub_instance->log_manager_;
+  log_manager->RunFlushThread();
+  ASSERT_TRUE(enable_logging);
+
+  lsn_t last_lsn = INVALID_LSN;
+  for (txn_id_t txn_id = 0; txn_id < 100; txn_id++) {
+    LogRecord record(txn_id, INVALID_LSN, LogRecordType::BEGIN);
+    last_lsn = log_manager->AppendLogRecord(&record);
+  }
+  log_manager->Flush();
+  EXPECT_EQ(last_lsn, log_manager->GetPersistentLSN());
+
+  // Every record is a bare header, so the log is a sequence of 20 byte records with increasing LSNs.
+  char buf[LOG_BUFFER_SIZE];
+  ASSERT_TRUE(bustub_instance->disk_manager_->ReadLog(buf, LOG_BUFFER_SIZE, 0));
+  for (int i = 0; i < 100; i++) {
+    auto *header = reinterpret_cast<int32_t *>(buf + i * 20);
+    EXPECT_EQ(20, header[0]);
+    EXPECT_EQ(i, header[1]);
+    EXPECT_EQ(i, header[2]);
+  }
+
+  log_manager->StopFlushThread();
+  ASSERT_FALSE(enable_logging);
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, FlushWithoutFlushThread) {
+  auto *bustub_instance = new BustubInstance("test.db");
+  LogManager *log_manager = bustub_instance->log_manager_;
+
+  // Without the flush thread, the waiter writes the log itself.
+  LogRecord record(0, INVALID_LSN, LogRecordType::BEGIN);
+  lsn_t lsn = log_manager->AppendLogRecord(&record);
+  log_manager->WaitForPersistentLSN(lsn);
+  EXPECT_EQ(lsn, log_manager->GetPersistentLSN());
+
+  // A record that can never fit into the log buffer is rejected instead of waiting for space forever.
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_pages(LOG_BUFFER_SIZE / (sizeof(page_id_t) + sizeof(lsn_t)));
+  LogRecord checkpoint(LogRecordType::CHECKPOINT_END, 0, {}, dirty_pages);
+  EXPECT_THROW(log_manager->AppendLogRecord(&checkpoint), Exception);
+  EXPECT_EQ(lsn + 1, log_manager->GetNextLSN());
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, GroupCommit) {
+  auto *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+
+  const int num_threads = 8;
+  const int txns_per_thread = 50;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back([&] {
+      for (int j = 0; j < txns_per_thread; j++) {
+        Transaction *txn = bustub_instance->transaction_manager_->Begin();
+        bustub_instance->transaction_manager_->Commit(txn);
+        EXPECT_LE(txn->GetPrevLSN(), bustub_instance->log_manager_->GetPersistentLSN());
+        delete txn;
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // Concurrent committers share flushes, so there are fewer log writes than commits.
+  EXPECT_LT(bustub_instance->disk_manager_->GetNumFlushes(), num_threads * txns_per_thread);
+
+  bustub_instance->log_manager_->StopFlushThread();
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, DISABLED_CommitThroughputBenchmark) {
+  std::vector<std::pair<int, bool>> configurations{{1, false}, {2, false}, {4, false}, {8, false}, {8, true}};
+  for (auto [num_threads, async_commit] : configurations) {
+    auto *bustub_instance = new BustubInstance("test.db");
+    bustub_instance->log_manager_->RunFlushThread();
+    bustub_instance->transaction_manager_->SetAsyncCommit(async_commit);
+
+    const int txns_per_thread = 100;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; i++) {
+      threads.emplace_back([&] {
+        for (int j = 0; j < txns_per_thread; j++) {
+          Transaction *txn = bustub_instance->transaction_manager_->Begin();
+          bustub_instance->transaction_manager_->Commit(txn);
+          delete txn;
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << num_threads << " thread(s)" << (async_commit ? ", async" : "") << ": "
+              << static_cast<int>(num_threads * txns_per_thread / elapsed) << " commits/s, "
+              << bustub_instance->disk_manager_->GetNumFlushes() << " log flushes for " << num_threads * txns_per_thread
+              << " commits" << std::endl;
+
+    bustub_instance->log_manager_->StopFlushThread();
+    delete bustub_instance;
+    remove("test.db");
+    remove("test.log");
+    RemoveLogSegments();
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, AsyncCommit) {
+  auto saved_log_timeout = log_timeout;
+  auto saved_async_commit_window = async_commit_window;
+  log_timeout = std::chrono::seconds(60);
+  async_commit_window = std::chrono::milliseconds(200);
+  auto *bustub_instance = new BustubInstance("test.db");
+  LogManager *log_manager = bustub_instance->log_manager_;
+  log_manager->RunFlushThread();
+
+  // Scenario: an asynchronous commit returns before its COMMIT record is durable.
+  bustub_instance->transaction_manager_->SetAsyncCommit(true);
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  ASSERT_TRUE(txn->IsAsyncCommit());
+  auto start = std::chrono::steady_clock::now();
+  bustub_instance->transaction_manager_->Commit(txn);
+  EXPECT_LT(log_manager->GetPersistentLSN(), txn->GetPrevLSN());
+  EXPECT_EQ(2, log_manager->GetUnflushedLSNLag());
+
+  // Scenario: the flush thread makes it durable within the window instead of waiting for the log timeout.
+  while (log_manager->GetPersistentLSN() < txn->GetPrevLSN()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(30));
+  EXPECT_EQ(0, log_manager->GetUnflushedLSNLag());
+  delete txn;
+
+  // Scenario: a synchronous transaction still waits for durability.
+  txn = bustub_instance->transaction_manager_->Begin();
+  txn->SetAsyncCommit(false);
+  bustub_instance->transaction_manager_->Commit(txn);
+  EXPECT_LE(txn->GetPrevLSN(), log_manager->GetPersistentLSN());
+  delete txn;
+
+  log_manager->StopFlushThread();
+  delete bustub_instance;
+  log_timeout = saved_log_timeout;
+  async_commit_window = saved_async_commit_window;
+}
+
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, ConcurrentAppend) {
+  auto *bustub_instance = new BustubInstance("test.db");
+  LogManager *log_manager = bustub_instance->log_manager_;
+  log_manager->RunFlushThread();
+
+  // Enough records to wrap around the log buffers many times while appenders race with the flush thread.
+  const int num_threads = 8;
+  const int records_per_thread = 2000;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back([&, i] {
+      for (int j = 0; j < records_per_thread; j++) {
+        LogRecord record(i, INVALID_LSN, LogRecordType::COMMIT);
+        log_manager->AppendLogRecord(&record);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  log_manager->Flush();
+  ASSERT_EQ(num_threads * records_per_thread - 1, log_manager->GetPersistentLSN());
+
+  // The log on disk holds every LSN exactly once and in order, without holes.
+  std::vector<char> buf(num_threads * records_per_thread * 20);
+  ASSERT_TRUE(bustub_instance->disk_manager_->ReadLog(buf.data(), buf.size(), 0));
+  for (int i = 0; i < num_threads * records_per_thread; i++) {
+    auto *header = reinterpret_cast<int32_t *>(buf.data() + i * 20);
+    ASSERT_EQ(20, header[0]);
+    ASSERT_EQ(i, header[1]);
+  }
+
+  log_manager->StopFlushThread();
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, DISABLED_AppendThroughputBenchmark) {
+  Column col{"a", TypeId::VARCHAR, 128};
+  Schema schema{std::vector<Column>{col}};
+  Tuple tuple(std::vector<Value>{ValueFactory::GetVarcharValue(std::string(100, 'x'))}, &schema);
+
+  for (int num_threads : {1, 2, 4, 8}) {
+    auto *bustub_instance = new BustubInstance("test.db");
+    bustub_instance->log_manager_->RunFlushThread();
+
+    const int records_per_thread = 20000;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; i++) {
+      threads.emplace_back([&, i] {
+        for (int j = 0; j < records_per_thread; j++) {
+          LogRecord record(i, INVALID_LSN, LogRecordType::INSERT, RID(i, j), tuple);
+          bustub_instance->log_manager_->AppendLogRecord(&record);
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << num_threads << " thread(s): " << static_cast<int>(num_threads * records_per_thread / elapsed)
+              << " appends/s" << std::endl;
+
+    bustub_instance->log_manager_->StopFlushThread();
+    delete bustub_instance;
+    remove("test.db");
+    remove("test.log");
+    RemoveLogSegments();
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, CompactEncodingSize) {
+  Schema schema{std::vector<Column>{Column{"a", TypeId::VARCHAR, 128}, Column{"b", TypeId::INTEGER},
+                                    Column{"c", TypeId::BIGINT}}};
+  auto make_tuple = [&](int32_t b) {
+    return Tuple(std::vector<Value>{ValueFactory::GetVarcharValue(std::string(100, 'x')),
+                                    ValueFactory::GetIntegerValue(b), ValueFactory::GetBigIntValue(42)},
+                 &schema);
+  };
+
+  // An update-heavy workload: every transaction changes a single integer column of one tuple.
+  const int num_txns = 1000;
+  int log_size[2];
+  for (bool compact : {false, true}) {
+    enable_compact_log = compact;
+    auto *bustub_instance = new BustubInstance("test.db");
+    LogManager *log_manager = bustub_instance->log_manager_;
+    log_manager->RunFlushThread();
+
+    for (int i = 0; i < num_txns; i++) {
+      LogRecord begin(i, INVALID_LSN, LogRecordType::BEGIN);
+      lsn_t prev_lsn = log_manager->AppendLogRecord(&begin);
+      LogRecord update(i, prev_lsn, LogRecordType::UPDATE, RID(i / 20, i % 20), make_tuple(i), make_tuple(i + 1));
+      prev_lsn = log_manager->AppendLogRecord(&update);
+      LogRecord commit(i, prev_lsn, LogRecordType::COMMIT);
+      log_manager->AppendLogRecord(&commit);
+    }
+    log_manager->Flush();
+    log_size[compact] = bustub_instance->disk_manager_->GetLogFileSize();
+
+    log_manager->StopFlushThread();
+    delete bustub_instance;
+    remove("test.db");
+    remove("test.log");
+    RemoveLogSegments();
+  }
+  enable_compact_log = false;
+
+  EXPECT_LT(log_size[1] * 4, log_size[0]);
+}
+
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, LogStaging) {
+  auto *bustub_instance = new BustubInstance("test.db");
+  LogManager *log_manager = bustub_instance->log_manager_;
+  TransactionManager *txn_manager = bustub_instance->transaction_manager_;
+  log_manager->RunFlushThread();
+  txn_manager->SetLogStaging(true);
+
+  Column col{"a", TypeId::INTEGER};
+  Schema schema{std::vector<Column>{col}};
+  Transaction *txn = txn_manager->Begin();
+  ASSERT_TRUE(txn->IsLogStaging());
+  auto *table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_, log_manager, txn);
+  RID rid;
+  int first_page_rows = 0;
+  for (int i = 0; i < 500; i++) {
+    ASSERT_TRUE(table->InsertTuple(Tuple(std::vector<Value>{ValueFactory::GetIntegerValue(i)}, &schema), &rid, txn));
+    first_page_rows += rid.GetPageId() == table->GetFirstPageId() ? 1 : 0;
+  }
+  ASSERT_LT(first_page_rows, 500);
+
+  // Scenario: the records are appended in batches that exceed the staging limit, not one by one.
+  lsn_t next_lsn = log_manager->GetNextLSN();
+  EXPECT_GT(next_lsn, 0);
+  EXPECT_LT(next_lsn, 500);
+
+  // Scenario: at commit, the rest is appended as one batch with consecutive LSNs and made durable.
+  txn_manager->Commit(txn);
+  EXPECT_EQ(0, txn->GetBeginLSN());
+  EXPECT_EQ(log_manager->GetNextLSN() - 1, txn->GetPrevLSN());
+  EXPECT_LE(txn->GetPrevLSN(), log_manager->GetPersistentLSN());
+  delete txn;
+
+  // Scenario: the NEWPAGE record that links the second page into the first one is covered by the first page's LSN.
+  // The log is BEGIN, NEWPAGE of the first page, its inserts and the NEWPAGE of the second page.
+  Page *first_page = bustub_instance->buffer_pool_manager_->FetchPage(table->GetFirstPageId());
+  EXPECT_EQ(first_page_rows + 2, first_page->GetLSN());
+  bustub_instance->buffer_pool_manager_->UnpinPage(table->GetFirstPageId(), false);
+
+  // Scenario: read-only transactions never touch the log, whether they commit or abort.
+  next_lsn = log_manager->GetNextLSN();
+  txn = txn_manager->Begin();
+  Tuple tuple;
+  ASSERT_TRUE(table->GetTuple(rid, &tuple, txn));
+  txn_manager->Commit(txn);
+  EXPECT_EQ(INVALID_LSN, txn->GetPrevLSN());
+  delete txn;
+  txn = txn_manager->Begin();
+  txn_manager->Abort(txn);
+  delete txn;
+  EXPECT_EQ(next_lsn, log_manager->GetNextLSN());
+
+  // Scenario: writing back a page appends the records staged for it first.
+  txn = txn_manager->Begin();
+  ASSERT_TRUE(table->MarkDelete(rid, txn));
+  EXPECT_EQ(next_lsn, log_manager->GetNextLSN());
+  bustub_instance->buffer_pool_manager_->FlushPage(rid.GetPageId());
+  EXPECT_EQ(next_lsn + 2, log_manager->GetNextLSN());
+  EXPECT_LE(next_lsn + 1, log_manager->GetPersistentLSN());
+  txn_manager->Abort(txn);
+  delete txn;
+
+  log_manager->StopFlushThread();
+  delete table;
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, DISABLED_LogStagingBenchmark) {
+  Column col{"a", TypeId::VARCHAR, 128};
+  Schema schema{std::vector<Column>{col}};
+  Tuple tuple(std::vector<Value>{ValueFactory::GetVarcharValue(std::string(100, 'x'))}, &schema);
+
+  for (bool log_staging : {false, true}) {
+    auto *bustub_instance = new BustubInstance("test.db");
+    bustub_instance->log_manager_->RunFlushThread();
+    bustub_instance->transaction_manager_->SetAsyncCommit(true);
+    bustub_instance->transaction_manager_->SetLogStaging(log_staging);
+
+    // Every thread updates a tuple of its own table, so the shared log is the only point of contention.
+    const int num_threads = 8;
+    const int txns_per_thread = 200;
+    const int updates_per_txn = 10;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; i++) {
+      threads.emplace_back([&] {
+        Transaction *txn = bustub_instance->transaction_manager_->Begin();
+        TableHeap table(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                        bustub_instance->log_manager_, txn);
+        RID rid;
+        table.InsertTuple(tuple, &rid, txn);
+        bustub_instance->transaction_manager_->Commit(txn);
+        delete txn;
+        for (int j = 0; j < txns_per_thread; j++) {
+          txn = bustub_instance->transaction_manager_->Begin();
+          for (int k = 0; k < updates_per_txn; k++) {
+            table.UpdateTuple(tuple, rid, txn);
+          }
+          bustub_instance->transaction_manager_->Commit(txn);
+          delete txn;
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << (log_staging ? "staged" : "direct") << " logging: "
+              << static_cast<int>(num_threads * txns_per_thread / elapsed) << " txns/s" << std::endl;
+
+    bustub_instance->log_manager_->StopFlushThread();
+    delete bustub_instance;
+    remove("test.db");
+    remove("test.log");
+    RemoveLogSegments();
+  }
+}
+
+}  // namespace bustub
@@ -14,6 +14,7 @@
 
 #include "common/exception.h"
 #include "gtest/gtest.h"
+#include "logging/common.h"
 #include "storage/disk/disk_manager.h"
 
 namespace bustub {
@@ -24,12 +25,14 @@ class DiskManagerTest : public ::testing::Test {
   void SetUp() override {
     remove("test.db");
     remove("test.log");
+    RemoveLogSegments();
   }
 
   // This function is called after every test.
   void TearDown() override {
     remove("test.db");
     remove("test.log");
+    RemoveLogSegments();
   };
 };
 
@@ -73,6 +76,48 @@ TEST_F(DiskManagerTest, ReadWriteLogTest) {
 }
 
 // NOLINTNEXTLINE
+TEST_F(DiskManagerTest, LogSegmentTest) {
+  const int segment_size = 1024;
+  // WriteLog insists on alternating between two buffers.
+  char data[2][700];
+  char buf[3000];
+  std::string db_file("test.db");
+  {
+    DiskManager dm(db_file, segment_size);
+    for (int i = 0; i < 4; i++) {
+      std::memset(data[i % 2], 'a' + i, sizeof(data[i % 2]));
+      dm.WriteLog(data[i % 2], sizeof(data[i % 2]));
+    }
+    EXPECT_EQ(4 * 700, dm.GetLogFileSize());
+    EXPECT_EQ(3, dm.GetNumLogSegments());
+
+    // Reads span segment boundaries.
+    ASSERT_TRUE(dm.ReadLog(buf, sizeof(buf), 0));
+    for (int i = 0; i < 4 * 700; i++) {
+      ASSERT_EQ('a' + i / 700, buf[i]);
+    }
+    EXPECT_EQ(0, buf[4 * 700]);
+
+    // Only whole segments before the offset go away.
+    dm.TruncateLog(1500);
+    EXPECT_EQ(2, dm.GetNumLogSegments());
+    EXPECT_FALSE(dm.ReadLog(buf, 100, 0));
+    ASSERT_TRUE(dm.ReadLog(buf, 100, 1024));
+    EXPECT_EQ('b', buf[0]);
+    dm.ShutDown();
+  }
+
+  // The log is still there after reopening, and continues where it ended.
+  DiskManager dm(db_file, segment_size);
+  EXPECT_EQ(4 * 700, dm.GetLogFileSize());
+  EXPECT_EQ(2, dm.GetNumLogSegments());
+  ASSERT_TRUE(dm.ReadLog(buf, 100, 2000));
+  EXPECT_EQ('c', buf[0]);
+  dm.WriteLog(data[0], sizeof(data[0]));
+  EXPECT_EQ(5 * 700, dm.GetLogFileSize());
+  dm.ShutDown();
+}
+
 TEST_F(DiskManagerTest, ThrowBadFileTest) { EXPECT_THROW(DiskManager("dev/null\\/foo/bar/baz/test.db"), Exception); }
 
 }  // namespace bustub